@@ -0,0 +1,9 @@
+# Benchmarks for the library. Build with "qmake bench.pro && make" from this directory.
+
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    microbench \
+    mockbackend \
+    loadbench \
+    nfctap
@@ -0,0 +1,672 @@
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QPointer>
+#include <QRandomGenerator>
+
+#include "compression.h"
+#include "mockbackend.h"
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+MockBackend::MockBackend( QObject * pParent ) : QTcpServer( pParent )
+{
+    iLatencyMs = 0;
+    iJitterMs = 0;
+    bCompressionEnabled = true;
+    bOffsetSupported = true;
+    bLimitSupported = true;
+    ulRequests = 0;
+    ulNextId = 0;
+    ulNextEventId = 1;
+
+    Collections[ "games" ].sSingular = "game";
+    Collections[ "games" ].sIdField = "_id";
+    Collections[ "players" ].sSingular = "player";
+    Collections[ "players" ].sIdField = "playerId";
+    Collections[ "prizes" ].sSingular = "prize";
+    Collections[ "prizes" ].sIdField = "_id";
+
+    setDatasetSize( MOCK_DEFAULT_GAMES, MOCK_DEFAULT_PLAYERS, MOCK_DEFAULT_PRIZES );
+
+    connect( this, SIGNAL( newConnection() ), this, SLOT( handleNewConnection() ) );
+
+    pHeartbeatTimer = new QTimer( this );
+    connect( pHeartbeatTimer, SIGNAL( timeout() ), this, SLOT( handleHeartbeat() ) );
+    pHeartbeatTimer->start( MOCK_HEARTBEAT_MS );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+QString MockBackend::gameId( const int & iIndex )
+{
+    /* Shaped like the 24 hex digit identifiers the real backend generates. */
+    return QString( "6a%1" ).arg( iIndex, 22, 16, QChar( '0' ) );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+QString MockBackend::playerId( const int & iIndex )
+{
+    /* Shaped like the card UIDs published by the NFC manager. */
+    return QString::number( 0x04000000u + static_cast<unsigned int>( iIndex ), 16 );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+QString MockBackend::prizeId( const int & iIndex )
+{
+    return QString( "7b%1" ).arg( iIndex, 22, 16, QChar( '0' ) );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void MockBackend::setDatasetSize( const int & iGames, const int & iPlayers, const int & iPrizes )
+{
+    Collection & Games = Collections[ "games" ];
+    Collection & Players = Collections[ "players" ];
+    Collection & Prizes = Collections[ "prizes" ];
+
+    Games.Items.clear();
+    for ( int i = 0; i < iGames; i++ )
+    {
+        Games.Items.append( QJsonObject
+        {
+            { "_id", gameId( i ) },
+            { "name", QString( "Game %1" ).arg( i ) },
+            { "tokenCost", 1 + ( i % 4 ) },
+            { "topPlayer", playerId( ( i * 7 ) % qMax( 1, iPlayers ) ) }
+        } );
+    }
+
+    Players.Items.clear();
+    for ( int i = 0; i < iPlayers; i++ )
+    {
+        QJsonArray Stats;
+
+        for ( int j = 0; ( j < 3 ) && ( j < iGames ); j++ )
+        {
+            Stats.append( QJsonObject
+            {
+                { "gameId", gameId( ( i + j ) % iGames ) },
+                { "highScore", ( i * 131 + j * 17 ) % 100000 },
+                { "ticketsEarned", ( i * 13 + j ) % 500 }
+            } );
+        }
+
+        Players.Items.append( QJsonObject
+        {
+            { "playerId", playerId( i ) },
+            { "firstName", "Player" },
+            { "lastName", QString::number( i ) },
+            { "screenName", QString( "player%1" ).arg( i ) },
+            { "tokens", i % 50 },
+            { "tickets", ( i * 37 ) % 10000 },
+            { "stats", Stats }
+        } );
+    }
+
+    Prizes.Items.clear();
+    for ( int i = 0; i < iPrizes; i++ )
+    {
+        Prizes.Items.append( QJsonObject
+        {
+            { "_id", prizeId( i ) },
+            { "name", QString( "Prize %1" ).arg( i ) },
+            { "description", QString( "A generated prize worth %1 tickets." ).arg( 10 + ( i * 25 ) % 5000 ) },
+            { "ticketCost", 10 + ( i * 25 ) % 5000 },
+            { "availableQuantity", 1 + ( i % 20 ) }
+        } );
+    }
+
+    rebuildIndex( Games );
+    rebuildIndex( Players );
+    rebuildIndex( Prizes );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void MockBackend::setLatency( const int & iLatencyMs, const int & iJitterMs )
+{
+    this->iLatencyMs = qMax( 0, iLatencyMs );
+    this->iJitterMs = qMax( 0, iJitterMs );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void MockBackend::setCompressionEnabled( const bool & bEnabled )
+{
+    bCompressionEnabled = bEnabled;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void MockBackend::setPagingSupport( const bool & bOffset, const bool & bLimit )
+{
+    /* Simulates servers that ignore either paging parameter, or both. */
+    bOffsetSupported = bOffset;
+    bLimitSupported = bLimit;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+quint64 MockBackend::getRequestCount() const
+{
+    return ulRequests;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+quint16 MockBackend::start( const quint16 & uiPort )
+{
+    /* Only listen locally; a port of zero picks any free one. */
+    return listen( QHostAddress::LocalHost, uiPort ) ? serverPort() : 0;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void MockBackend::dropEventStreams()
+{
+    /* Simulates the server or network going away, so clients have to reconnect and resync. */
+    for ( QHash<QTcpSocket *, Connection>::const_iterator Iterator = Connections.begin();
+          Iterator != Connections.end();
+          ++Iterator )
+    {
+        if ( Iterator.value().bEventStream )
+        {
+            QMetaObject::invokeMethod( Iterator.key(), "abort", Qt::QueuedConnection );
+        }
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void MockBackend::stop()
+{
+    /* Simulates the server going down for good: new connections are refused and open ones are cut. */
+    close();
+    for ( QHash<QTcpSocket *, Connection>::const_iterator Iterator = Connections.begin();
+          Iterator != Connections.end();
+          ++Iterator )
+    {
+        QMetaObject::invokeMethod( Iterator.key(), "abort", Qt::QueuedConnection );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void MockBackend::handleHeartbeat()
+{
+    for ( QHash<QTcpSocket *, Connection>::const_iterator Iterator = Connections.begin();
+          Iterator != Connections.end();
+          ++Iterator )
+    {
+        if ( Iterator.value().bEventStream )
+        {
+            writeChunk( Iterator.key(), ": heartbeat\n\n" );
+        }
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void MockBackend::handleNewConnection()
+{
+    QTcpSocket *pSocket = nullptr;
+
+    while ( nullptr != ( pSocket = nextPendingConnection() ) )
+    {
+        Connections.insert( pSocket, Connection() );
+        connect( pSocket, SIGNAL( readyRead() ), this, SLOT( handleReadyRead() ) );
+        connect( pSocket, SIGNAL( disconnected() ), this, SLOT( handleDisconnected() ) );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void MockBackend::handleReadyRead()
+{
+    QTcpSocket *pSocket = qobject_cast<QTcpSocket *>( sender() );
+
+    if ( Connections.contains( pSocket ) )
+    {
+        Connections[ pSocket ].Buffer.append( pSocket->readAll() );
+        processBuffer( pSocket );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void MockBackend::handleDisconnected()
+{
+    QTcpSocket *pSocket = qobject_cast<QTcpSocket *>( sender() );
+
+    Connections.remove( pSocket );
+    pSocket->deleteLater();
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void MockBackend::processBuffer( QTcpSocket * pSocket )
+{
+    Connection & State = Connections[ pSocket ];
+    int iHeaderEnd = 0;
+    int iContentLength = 0;
+    bool bGzipReply = false;
+    bool bGzipBody = false;
+    bool bClose = false;
+    int iStatus = 200;
+    int iDelayMs = 0;
+    QByteArray Reply;
+    QByteArray RawBody;
+    QByteArray Decoded;
+    QList<QByteArray> Lines;
+    QList<QByteArray> RequestLine;
+    QJsonObject Body;
+    QUrl Target;
+    QPointer<QTcpSocket> Socket( pSocket );
+
+    /* Requests on a connection are answered strictly in order, one at a time. */
+    if ( State.bBusy )
+    {
+        return;
+    }
+
+    iHeaderEnd = State.Buffer.indexOf( "\r\n\r\n" );
+    if ( 0 > iHeaderEnd )
+    {
+        return;
+    }
+
+    Lines = State.Buffer.left( iHeaderEnd ).split( '\n' );
+    RequestLine = Lines.takeFirst().trimmed().split( ' ' );
+
+    for ( const QByteArray & Line : Lines )
+    {
+        const int iColon = Line.indexOf( ':' );
+        const QByteArray Name = Line.left( iColon ).trimmed().toLower();
+        const QByteArray Value = Line.mid( iColon + 1 ).trimmed().toLower();
+
+        if ( "content-length" == Name )
+        {
+            iContentLength = Value.toInt();
+        }
+        else if ( "accept-encoding" == Name )
+        {
+            bGzipReply = bCompressionEnabled && Value.contains( "gzip" );
+        }
+        else if ( "content-encoding" == Name )
+        {
+            bGzipBody = ( "gzip" == Value ) || ( "deflate" == Value );
+        }
+        else if ( "connection" == Name )
+        {
+            bClose = ( "close" == Value );
+        }
+    }
+
+    /* Wait for the whole body. */
+    if ( State.Buffer.size() < ( iHeaderEnd + 4 + iContentLength ) )
+    {
+        return;
+    }
+
+    RawBody = State.Buffer.mid( iHeaderEnd + 4, iContentLength );
+    State.Buffer.remove( 0, iHeaderEnd + 4 + iContentLength );
+    State.bBusy = true;
+    ulRequests++;
+
+    if ( bGzipBody )
+    {
+        StreamDecoder Decoder;
+
+        if ( Decoder.decode( RawBody, Decoded ) )
+        {
+            RawBody = Decoded;
+        }
+    }
+
+    Body = QJsonDocument::fromJson( RawBody ).object();
+
+    if ( 3 > RequestLine.size() )
+    {
+        iStatus = 400;
+        Reply = errorReply( "Malformed request" );
+    }
+    else
+    {
+        Target = QUrl::fromEncoded( RequestLine[ 1 ] );
+        if ( ( "GET" == RequestLine[ 0 ] ) && ( "/events" == Target.path() ) )
+        {
+            /* The connection stays busy for good, streaming events instead of answering more requests. */
+            openEventStream( pSocket, QUrlQuery( Target ) );
+            return;
+        }
+
+        route( RequestLine[ 0 ], Target.path(), QUrlQuery( Target ), Body, iStatus, Reply );
+    }
+
+    /* Simulate the server and network delay before answering. */
+    iDelayMs = iLatencyMs + ( ( 0 < iJitterMs ) ? static_cast<int>( QRandomGenerator::global()->bounded( iJitterMs + 1 ) ) : 0 );
+    if ( 0 < iDelayMs )
+    {
+        QTimer::singleShot( iDelayMs, this, [ this, Socket, iStatus, Reply, bGzipReply, bClose ]()
+        {
+            if ( !Socket.isNull() )
+            {
+                respond( Socket.data(), iStatus, Reply, bGzipReply, bClose );
+            }
+        } );
+    }
+    else
+    {
+        respond( pSocket, iStatus, Reply, bGzipReply, bClose );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void MockBackend::respond( QTcpSocket * pSocket, const int & iStatus, const QByteArray & Reply,
+                           const bool & bGzip, const bool & bClose )
+{
+    QByteArray Body = Reply;
+    QByteArray Compressed;
+    QByteArray Header;
+
+    if ( ( bGzip ) && ( MOCK_COMPRESSION_MIN_BYTES <= Body.size() )
+         && ( StreamDecoder::gzipCompress( Body, Compressed ) ) )
+    {
+        Body = Compressed;
+    }
+    else
+    {
+        Compressed.clear();
+    }
+
+    Header = "HTTP/1.1 " + QByteArray::number( iStatus )
+            + ( ( 200 == iStatus ) ? " OK" : ( ( 404 == iStatus ) ? " Not Found" : " Bad Request" ) ) + "\r\n"
+            + "Content-Type: application/json; charset=utf-8\r\n"
+            + "Content-Length: " + QByteArray::number( Body.size() ) + "\r\n"
+            + ( Compressed.isEmpty() ? QByteArray() : QByteArray( "Content-Encoding: gzip\r\n" ) )
+            + ( bClose ? "Connection: close\r\n" : "Connection: keep-alive\r\n" )
+            + "\r\n";
+
+    pSocket->write( Header );
+    pSocket->write( Body );
+
+    if ( bClose )
+    {
+        pSocket->disconnectFromHost();
+    }
+    else if ( Connections.contains( pSocket ) )
+    {
+        /* Move on to any request that queued up behind this one. */
+        Connections[ pSocket ].bBusy = false;
+        processBuffer( pSocket );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void MockBackend::route( const QByteArray & Method, const QString & sPath, const QUrlQuery & Query,
+                         const QJsonObject & Body, int & iStatus, QByteArray & Reply )
+{
+    const QStringList Segments = sPath.split( '/', QString::SkipEmptyParts );
+    const QString sName = Segments.value( 0 );
+    int iIndex = -1;
+
+    iStatus = 200;
+
+    if ( !Collections.contains( sName ) )
+    {
+        iStatus = 404;
+        Reply = errorReply( "Not found" );
+        return;
+    }
+
+    Collection & Items = Collections[ sName ];
+
+    /* Whole collection. */
+    if ( ( 1 == Segments.size() ) && ( "GET" == Method ) )
+    {
+        Reply = listReply( sName, Query );
+        return;
+    }
+
+    /* Creation. */
+    if ( ( 2 == Segments.size() ) && ( "create" == Segments[ 1 ] ) && ( "POST" == Method ) )
+    {
+        Reply = entityReply( sName, createEntity( sName, Body ) );
+        return;
+    }
+
+    /* Everything else addresses a single entity. */
+    iIndex = Items.Index.value( Segments.value( 1 ), -1 );
+    if ( 0 > iIndex )
+    {
+        iStatus = 404;
+        Reply = errorReply( "No " + Items.sSingular + " with that ID" );
+        return;
+    }
+
+    if ( ( 2 == Segments.size() ) && ( "GET" == Method ) )
+    {
+        Reply = entityReply( sName, Items.Items[ iIndex ] );
+    }
+    else if ( ( 3 == Segments.size() ) && ( "update" == Segments[ 2 ] ) && ( "PUT" == Method ) )
+    {
+        Reply = entityReply( sName, updateEntity( sName, iIndex, Body ) );
+    }
+    else if ( ( 3 == Segments.size() ) && ( "delete" == Segments[ 2 ] ) && ( "DELETE" == Method ) )
+    {
+        broadcast( sName, "delete", iIndex, Items.Items[ iIndex ] );
+        Items.Items.remove( iIndex );
+        rebuildIndex( Items );
+        Reply = QJsonDocument( QJsonObject { { "message", Items.sSingular + " deleted" } } ).toJson( QJsonDocument::Compact );
+    }
+    else if ( ( "players" == sName ) && ( 3 == Segments.size() ) && ( "publishstats" == Segments[ 2 ] )
+              && ( "POST" == Method ) )
+    {
+        QJsonObject Player = Items.Items[ iIndex ];
+        QJsonArray Stats = Player.value( "stats" ).toArray();
+        bool bFound = false;
+
+        /* Credit the tickets and keep the best score per game. */
+        Player[ "tickets" ] = Player.value( "tickets" ).toInt() + Body.value( "ticketsEarned" ).toInt();
+        for ( int i = 0; i < Stats.size(); i++ )
+        {
+            QJsonObject Entry = Stats[ i ].toObject();
+
+            if ( Entry.value( "gameId" ) == Body.value( "gameId" ) )
+            {
+                Entry[ "highScore" ] = qMax( Entry.value( "highScore" ).toInt(), Body.value( "highScore" ).toInt() );
+                Entry[ "ticketsEarned" ] = Entry.value( "ticketsEarned" ).toInt() + Body.value( "ticketsEarned" ).toInt();
+                Stats[ i ] = Entry;
+                bFound = true;
+            }
+        }
+
+        if ( !bFound )
+        {
+            Stats.append( QJsonObject
+            {
+                { "gameId", Body.value( "gameId" ) },
+                { "highScore", Body.value( "highScore" ) },
+                { "ticketsEarned", Body.value( "ticketsEarned" ) }
+            } );
+        }
+
+        Player[ "stats" ] = Stats;
+        Reply = entityReply( sName, updateEntity( sName, iIndex, Player ) );
+    }
+    else if ( ( "prizes" == sName ) && ( 3 == Segments.size() ) && ( "redeem" == Segments[ 2 ] ) && ( "POST" == Method ) )
+    {
+        Collection & Players = Collections[ "players" ];
+        const int iPlayer = Players.Index.value( Body.value( "playerId" ).toString(), -1 );
+        QJsonObject Prize = Items.Items[ iIndex ];
+
+        if ( ( 0 > iPlayer )
+             || ( 0 >= Prize.value( "availableQuantity" ).toInt() )
+             || ( Players.Items[ iPlayer ].value( "tickets" ).toInt() < Prize.value( "ticketCost" ).toInt() ) )
+        {
+            iStatus = 400;
+            Reply = errorReply( "Unable to redeem prize" );
+        }
+        else
+        {
+            QJsonObject Player = Players.Items[ iPlayer ];
+
+            Player[ "tickets" ] = Player.value( "tickets" ).toInt() - Prize.value( "ticketCost" ).toInt();
+            Prize[ "availableQuantity" ] = Prize.value( "availableQuantity" ).toInt() - 1;
+
+            Reply = QJsonDocument( QJsonObject
+            {
+                { "prize", updateEntity( "prizes", iIndex, Prize ) },
+                { "player", updateEntity( "players", iPlayer, Player ) }
+            } ).toJson( QJsonDocument::Compact );
+        }
+    }
+    else
+    {
+        iStatus = 404;
+        Reply = errorReply( "Not found" );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void MockBackend::openEventStream( QTcpSocket * pSocket, const QUrlQuery & Query )
+{
+    Connection & State = Connections[ pSocket ];
+
+    State.bEventStream = true;
+    State.EventCollections = Query.queryItemValue( "collections" ).split( ',', QString::SkipEmptyParts );
+
+    /* Chunked, so the client reads each event as it is written. */
+    pSocket->write( "HTTP/1.1 200 OK\r\n"
+                    "Content-Type: text/event-stream\r\n"
+                    "Cache-Control: no-cache\r\n"
+                    "Transfer-Encoding: chunked\r\n"
+                    "Connection: keep-alive\r\n"
+                    "\r\n" );
+    writeChunk( pSocket, "retry: " + QByteArray::number( MOCK_EVENT_RETRY_MS ) + "\n\n" );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void MockBackend::broadcast( const QString & sName, const QString & sOperation, const int & iIndex,
+                             const QJsonObject & Entity )
+{
+    const Collection & Items = Collections[ sName ];
+    QByteArray Event;
+
+    Event = "id: " + QByteArray::number( ulNextEventId++ ) + "\nevent: change\ndata: "
+            + QJsonDocument( QJsonObject
+            {
+                { "collection", sName },
+                { "operation", sOperation },
+                { "id", Entity.value( Items.sIdField ) },
+                { "index", iIndex },
+                { "singular", Items.sSingular },
+                { Items.sSingular, Entity }
+            } ).toJson( QJsonDocument::Compact ) + "\n\n";
+
+    for ( QHash<QTcpSocket *, Connection>::const_iterator Iterator = Connections.begin();
+          Iterator != Connections.end();
+          ++Iterator )
+    {
+        if ( ( Iterator.value().bEventStream )
+             && ( ( Iterator.value().EventCollections.isEmpty() ) || ( Iterator.value().EventCollections.contains( sName ) ) ) )
+        {
+            writeChunk( Iterator.key(), Event );
+        }
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void MockBackend::writeChunk( QTcpSocket * pSocket, const QByteArray & Data )
+{
+    pSocket->write( QByteArray::number( Data.size(), 16 ) + "\r\n" + Data + "\r\n" );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void MockBackend::rebuildIndex( Collection & Items )
+{
+    Items.Index.clear();
+    Items.CachedList.clear();
+
+    for ( int i = 0; i < Items.Items.size(); i++ )
+    {
+        Items.Index.insert( Items.Items[ i ].value( Items.sIdField ).toString(), i );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+QByteArray MockBackend::listReply( const QString & sName, const QUrlQuery & Query )
+{
+    Collection & Items = Collections[ sName ];
+    QJsonArray Page;
+    int iOffset = 0;
+    int iLimit = 0;
+
+    if ( ( !Query.hasQueryItem( "limit" ) ) || ( !bLimitSupported ) )
+    {
+        /* Whole collections are cached until the next change. */
+        if ( Items.CachedList.isEmpty() )
+        {
+            for ( const QJsonObject & Item : Items.Items )
+            {
+                Page.append( Item );
+            }
+            Items.CachedList = QJsonDocument( QJsonObject { { sName, Page } } ).toJson( QJsonDocument::Compact );
+        }
+
+        return Items.CachedList;
+    }
+
+    iOffset = bOffsetSupported ? qBound( 0, Query.queryItemValue( "offset" ).toInt(), Items.Items.size() ) : 0;
+    iLimit = qMax( 0, Query.queryItemValue( "limit" ).toInt() );
+
+    for ( int i = iOffset; ( i < Items.Items.size() ) && ( i < ( iOffset + iLimit ) ); i++ )
+    {
+        Page.append( Items.Items[ i ] );
+    }
+
+    return QJsonDocument( QJsonObject { { sName, Page } } ).toJson( QJsonDocument::Compact );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+QByteArray MockBackend::entityReply( const QString & sName, const QJsonObject & Entity ) const
+{
+    return QJsonDocument( QJsonObject { { Collections[ sName ].sSingular, Entity } } ).toJson( QJsonDocument::Compact );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+QJsonObject MockBackend::createEntity( const QString & sName, const QJsonObject & Body )
+{
+    Collection & Items = Collections[ sName ];
+    QJsonObject Entity = Body;
+
+    /* Players bring their card UID as the identifier; everything else gets a generated one. */
+    if ( !Entity.contains( Items.sIdField ) )
+    {
+        Entity[ Items.sIdField ] = QString( "5c%1" ).arg( ulNextId++, 22, 16, QChar( '0' ) );
+    }
+
+    Items.Items.append( Entity );
+    rebuildIndex( Items );
+    broadcast( sName, "create", Items.Items.size() - 1, Entity );
+
+    return Entity;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+QJsonObject MockBackend::updateEntity( const QString & sName, const int & iIndex, const QJsonObject & Body )
+{
+    Collection & Items = Collections[ sName ];
+    QJsonObject & Entity = Items.Items[ iIndex ];
+
+    for ( QJsonObject::const_iterator Iterator = Body.begin(); Iterator != Body.end(); ++Iterator )
+    {
+        Entity[ Iterator.key() ] = Iterator.value();
+    }
+
+    /* Only a changed identifier needs the index rebuilt; the cached list is stale either way. */
+    if ( Body.contains( Items.sIdField ) )
+    {
+        rebuildIndex( Items );
+    }
+    else
+    {
+        Items.CachedList.clear();
+    }
+
+    broadcast( sName, "update", iIndex, Entity );
+
+    return Entity;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+QByteArray MockBackend::errorReply( const QString & sMessage )
+{
+    return QJsonDocument( QJsonObject { { "error", sMessage } } ).toJson( QJsonDocument::Compact );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
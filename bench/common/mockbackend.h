@@ -0,0 +1,101 @@
+#ifndef MOCKBACKEND_H
+#define MOCKBACKEND_H
+
+#include <QHash>
+#include <QJsonObject>
+#include <QTcpServer>
+#include <QStringList>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QUrlQuery>
+#include <QVector>
+
+#define MOCK_DEFAULT_PORT           3000
+#define MOCK_DEFAULT_GAMES          20
+#define MOCK_DEFAULT_PLAYERS        1000
+#define MOCK_DEFAULT_PRIZES         100
+#define MOCK_COMPRESSION_MIN_BYTES  1024
+#define MOCK_HEARTBEAT_MS           15000
+#define MOCK_EVENT_RETRY_MS         1000
+
+class MockBackend : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    explicit MockBackend( QObject * pParent = nullptr );
+
+    void setDatasetSize( const int & iGames, const int & iPlayers, const int & iPrizes );
+    void setLatency( const int & iLatencyMs, const int & iJitterMs );
+    void setCompressionEnabled( const bool & bEnabled );
+    void setPagingSupport( const bool & bOffset, const bool & bLimit );
+
+    quint64 getRequestCount() const;
+
+    static QString gameId( const int & iIndex );
+    static QString playerId( const int & iIndex );
+    static QString prizeId( const int & iIndex );
+
+public slots:
+    quint16 start( const quint16 & uiPort = MOCK_DEFAULT_PORT );
+    void dropEventStreams();
+    void stop();
+
+private slots:
+    void handleNewConnection();
+    void handleReadyRead();
+    void handleDisconnected();
+    void handleHeartbeat();
+
+private:
+    class Connection
+    {
+    public:
+        QByteArray Buffer;
+        bool bBusy = false;
+        bool bEventStream = false;      // Dedicated to pushing change events once opened
+        QStringList EventCollections;   // Empty for every collection
+    };
+
+    class Collection
+    {
+    public:
+        QString sSingular;
+        QString sIdField;
+        QVector<QJsonObject> Items;
+        QHash<QString, int> Index;
+        QByteArray CachedList;
+    };
+
+    QHash<QTcpSocket *, Connection> Connections;
+    QHash<QString, Collection> Collections;
+    int iLatencyMs;
+    int iJitterMs;
+    bool bCompressionEnabled;
+    bool bOffsetSupported;
+    bool bLimitSupported;
+    quint64 ulRequests;
+    quint64 ulNextId;
+    quint64 ulNextEventId;
+    QTimer *pHeartbeatTimer;
+
+    void processBuffer( QTcpSocket * pSocket );
+    void route( const QByteArray & Method, const QString & sPath, const QUrlQuery & Query, const QJsonObject & Body,
+                int & iStatus, QByteArray & Reply );
+    void respond( QTcpSocket * pSocket, const int & iStatus, const QByteArray & Reply,
+                  const bool & bGzip, const bool & bClose );
+
+    void openEventStream( QTcpSocket * pSocket, const QUrlQuery & Query );
+    void broadcast( const QString & sName, const QString & sOperation, const int & iIndex, const QJsonObject & Entity );
+    void writeChunk( QTcpSocket * pSocket, const QByteArray & Data );
+
+    void rebuildIndex( Collection & Items );
+    QByteArray listReply( const QString & sName, const QUrlQuery & Query );
+    QByteArray entityReply( const QString & sName, const QJsonObject & Entity ) const;
+    QJsonObject createEntity( const QString & sName, const QJsonObject & Body );
+    QJsonObject updateEntity( const QString & sName, const int & iIndex, const QJsonObject & Body );
+
+    static QByteArray errorReply( const QString & sMessage );
+};
+
+#endif // MOCKBACKEND_H
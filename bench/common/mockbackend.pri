@@ -0,0 +1,10 @@
+# Local stand-in for the BCON backend, shared by the standalone server and the benchmark drivers.
+# Projects including this file must also build src/compression.cpp, either directly or through libBCONNetwork.pri.
+
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/mockbackend.cpp
+
+HEADERS += \
+    $$PWD/mockbackend.h
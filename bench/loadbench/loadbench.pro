@@ -0,0 +1,20 @@
+QT -= gui
+QT += network
+
+CONFIG += console
+CONFIG -= app_bundle
+
+TARGET = loadbench
+TEMPLATE = app
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+SOURCES += \
+    main.cpp \
+    loaddriver.cpp
+
+HEADERS += \
+    loaddriver.h
+
+include( ../../libBCONNetwork.pri )
+include( ../common/mockbackend.pri )
@@ -0,0 +1,389 @@
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QRandomGenerator>
+#include <QTextStream>
+#include <QTimer>
+#include <algorithm>
+
+#include "loaddriver.h"
+#include "mockbackend.h"
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+LoadDriver::LoadDriver( const LoadSettings & Settings, QObject * pParent ) : QObject( pParent )
+{
+    const int iPlayers = qMax( 1, Settings.iPlayers );
+    const int iGames = qMax( 1, Settings.iGames );
+    const int iPrizes = qMax( 1, Settings.iPrizes );
+    QHash<QString, std::function<void( BCONNetwork *, int )>> Known;
+
+    this->Settings = Settings;
+    pStore = nullptr;
+    pNFCManager = nullptr;
+    pNetwork = nullptr;
+    ePhase = Phase::ColdStart;
+    iTotalWeight = 0;
+    iIssued = 0;
+    iCompleted = 0;
+    iErrors = 0;
+    iColdStart = 0;
+    ulAllocationBaseline = 0;
+    ulResidentBaseline = 0;
+
+    /* Every operation goes through the public slots, picking entities from the generated dataset. */
+    Known.insert( "getPlayer", [ iPlayers ]( BCONNetwork * pNetwork, int iRandom )
+    {
+        pNetwork->getPlayer( MockBackend::playerId( iRandom % iPlayers ) );
+    } );
+    Known.insert( "getGame", [ iGames ]( BCONNetwork * pNetwork, int iRandom )
+    {
+        pNetwork->getGame( MockBackend::gameId( iRandom % iGames ) );
+    } );
+    Known.insert( "getPrize", [ iPrizes ]( BCONNetwork * pNetwork, int iRandom )
+    {
+        pNetwork->getPrize( MockBackend::prizeId( iRandom % iPrizes ) );
+    } );
+    Known.insert( "getAllGames", []( BCONNetwork * pNetwork, int ) { pNetwork->getAllGames(); } );
+    Known.insert( "getAllPlayers", []( BCONNetwork * pNetwork, int ) { pNetwork->getAllPlayers(); } );
+    Known.insert( "getAllPrizes", []( BCONNetwork * pNetwork, int ) { pNetwork->getAllPrizes(); } );
+    Known.insert( "updatePlayerTickets", [ iPlayers ]( BCONNetwork * pNetwork, int iRandom )
+    {
+        pNetwork->updatePlayerTickets( MockBackend::playerId( iRandom % iPlayers ), iRandom % 10000 );
+    } );
+    Known.insert( "publishPlayerStats", [ iPlayers, iGames ]( BCONNetwork * pNetwork, int iRandom )
+    {
+        pNetwork->publishPlayerStats( MockBackend::playerId( iRandom % iPlayers ),
+                                      MockBackend::gameId( iRandom % iGames ), iRandom % 100, iRandom % 100000 );
+    } );
+    Known.insert( "redeemPrize", [ iPlayers, iPrizes ]( BCONNetwork * pNetwork, int iRandom )
+    {
+        pNetwork->redeemPrize( MockBackend::prizeId( iRandom % iPrizes ), MockBackend::playerId( iRandom % iPlayers ) );
+    } );
+
+    /* Parse the weighted mix, i.e. "getPlayer:60,getAllPlayers:5". */
+    for ( const QString & sEntry : Settings.sMix.split( ',', QString::SkipEmptyParts ) )
+    {
+        Operation Entry;
+
+        Entry.sName = sEntry.section( ':', 0, 0 ).trimmed();
+        Entry.iWeight = qMax( 0, sEntry.section( ':', 1, 1 ).toInt() );
+        Entry.Invoke = Known.value( Entry.sName );
+
+        if ( ( Entry.Invoke ) && ( 0 < Entry.iWeight ) )
+        {
+            Operations.append( Entry );
+            iTotalWeight += Entry.iWeight;
+        }
+        else
+        {
+            QTextStream( stderr ) << "Ignoring unknown or unweighted operation: " << sEntry << endl;
+        }
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+LoadDriver::~LoadDriver()
+{
+    delete pNetwork;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void LoadDriver::createNetwork( const bool & bPrewarm )
+{
+    delete pNetwork;
+
+    pNetwork = new BCONNetwork( Settings.Servers.value( 0 ), false, bPrewarm, Settings.bWorkerThread, pStore, pNFCManager );
+    if ( 1 < Settings.Servers.size() )
+    {
+        pNetwork->setReplicas( Settings.Servers );
+    }
+    pNetwork->setHttp2Allowed( Settings.bHttp2 );
+    pNetwork->setRequestCompressionThreshold( Settings.bCompression ? COMPRESSION_THRESHOLD_BYTES : 0 );
+    pNetwork->setListPaging( Settings.iPageSize );
+    if ( !bPrewarm )
+    {
+        pNetwork->setKeepAlivePolicy( 0, 0 );
+    }
+
+    connect( pNetwork, SIGNAL( requestFinished( const QString &, const int &, const qint64 & ) ),
+             this, SLOT( handleRequestFinished( const QString &, const int &, const qint64 & ) ) );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void LoadDriver::start()
+{
+    /* Each driver is a context of its own, sharing no data with drivers running beside it. These are created here so
+     * they belong to the thread the driver runs on. */
+    pStore = new DataStore( this );
+    pNFCManager = new NFCManager( pStore, this );
+    pStore->setCapacity( Settings.iModelEntries, Settings.iModelBytes );
+    pStore->setTimeToLive( QString(), Settings.iModelTimeToLiveMs );
+
+    if ( 0 < Settings.iColdStarts )
+    {
+        ePhase = Phase::ColdStart;
+        startColdStart();
+    }
+    else
+    {
+        startLoad();
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void LoadDriver::startColdStart()
+{
+    /* Alternate between pre-warmed and cold clients so both see the same server conditions. */
+    const bool bPrewarm = ( 0 == ( iColdStart % 2 ) );
+
+    createNetwork( bPrewarm );
+
+    /* Give the pre-warmed connection time to open, as it would between boot and the first tap. */
+    QTimer::singleShot( LOAD_SETTLE_MS, this, [ this ]()
+    {
+        pNetwork->getPlayer( MockBackend::playerId( 0 ) );
+    } );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void LoadDriver::startLoad()
+{
+    createNetwork( Settings.bPrewarm );
+
+    ePhase = ( 0 < Settings.iWarmup ) ? Phase::Warmup : Phase::Measure;
+    iIssued = 0;
+    iCompleted = 0;
+
+    if ( Operations.isEmpty() )
+    {
+        finish();
+        return;
+    }
+
+    QTimer::singleShot( LOAD_SETTLE_MS, this, [ this ]()
+    {
+        ulAllocationBaseline = allocationCount();
+        ulResidentBaseline = MemoryStats::residentBytes();
+        Elapsed.start();
+
+        for ( int i = 0; i < Settings.iConcurrency; i++ )
+        {
+            issueRequest();
+        }
+    } );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void LoadDriver::issueRequest()
+{
+    const int iTarget = ( Phase::Warmup == ePhase ) ? Settings.iWarmup : Settings.iRequests;
+    const int iRandom = static_cast<int>( QRandomGenerator::global()->bounded( 1 << 30 ) );
+    int iPick = iRandom % iTotalWeight;
+
+    if ( iIssued >= iTarget )
+    {
+        return;
+    }
+
+    /* Pick an operation according to its weight. */
+    for ( const Operation & Entry : Operations )
+    {
+        if ( iPick < Entry.iWeight )
+        {
+            iIssued++;
+            Entry.Invoke( pNetwork, iRandom );
+            break;
+        }
+
+        iPick -= Entry.iWeight;
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void LoadDriver::handleRequestFinished( const QString & sEndpoint, const int & iStatusCode, const qint64 & iElapsedNs )
+{
+    switch ( ePhase )
+    {
+    case Phase::ColdStart:
+        ColdLatencies[ iColdStart % 2 ].append( iElapsedNs );
+        iColdStart++;
+
+        /* Each client is torn down after its first request so the next one starts cold. */
+        if ( iColdStart < ( 2 * Settings.iColdStarts ) )
+        {
+            QTimer::singleShot( 0, this, SLOT( startColdStart() ) );
+        }
+        else
+        {
+            QTimer::singleShot( 0, this, SLOT( startLoad() ) );
+        }
+        break;
+
+    case Phase::Warmup:
+        iCompleted++;
+        if ( iCompleted >= Settings.iWarmup )
+        {
+            /* Start measuring; requests still in flight from the warm-up are counted towards it. */
+            ePhase = Phase::Measure;
+            iIssued = iIssued - iCompleted;
+            iCompleted = 0;
+            ulAllocationBaseline = allocationCount();
+            ulResidentBaseline = MemoryStats::residentBytes();
+            Elapsed.restart();
+        }
+        issueRequest();
+        break;
+
+    case Phase::Measure:
+        iCompleted++;
+        Latencies.append( iElapsedNs );
+        EndpointLatencies[ sEndpoint ].append( iElapsedNs );
+        if ( ( 200 > iStatusCode ) || ( 300 <= iStatusCode ) )
+        {
+            iErrors++;
+        }
+
+        if ( iCompleted == Settings.iFailPrimaryAfter )
+        {
+            emit primaryFailureDue();
+        }
+
+        if ( ( 0 < Settings.iSoakInterval ) && ( 0 == ( iCompleted % Settings.iSoakInterval ) ) )
+        {
+            reportSoak();
+        }
+
+        if ( iCompleted >= Settings.iRequests )
+        {
+            finish();
+        }
+        else
+        {
+            issueRequest();
+        }
+        break;
+
+    case Phase::Finished:
+        break;
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void LoadDriver::reportSoak()
+{
+    const MemoryStats Stats = pNetwork->getMemoryStats();
+    QJsonObject Sample
+    {
+        { "completed", iCompleted },
+        { "residentBytes", static_cast<qint64>( Stats.ulResidentBytes ) },
+        { "repliesInFlight", static_cast<qint64>( Stats.ulRepliesInFlight ) },
+        { "repliesReleased", static_cast<qint64>( Stats.ulRepliesReleased ) },
+        { "poolHits", static_cast<qint64>( Stats.ulPoolHits ) },
+        { "poolMisses", static_cast<qint64>( Stats.ulPoolMisses ) },
+        { "poolRetainedBytes", static_cast<qint64>( Stats.ulPoolRetainedBytes ) },
+        { "modelEntries", static_cast<qint64>( Stats.ulModelEntries ) },
+        { "modelBytes", static_cast<qint64>( Stats.ulModelBytes ) },
+        { "modelEvicted", static_cast<qint64>( Stats.ulModelEvicted ) }
+    };
+
+    /* One line per sample so long runs can be plotted as they go. */
+    QTextStream( stdout ) << "soak " << QJsonDocument( Sample ).toJson( QJsonDocument::Compact ) << endl;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+QJsonObject LoadDriver::summarize( QVector<qint64> Samples )
+{
+    QJsonObject Summary;
+
+    if ( Samples.isEmpty() )
+    {
+        return Summary;
+    }
+
+    std::sort( Samples.begin(), Samples.end() );
+    Summary.insert( "count", Samples.size() );
+    Summary.insert( "p50Us", Samples[ ( Samples.size() - 1 ) / 2 ] / 1000.0 );
+    Summary.insert( "p99Us", Samples[ qMin( Samples.size() - 1, ( Samples.size() * 99 ) / 100 ) ] / 1000.0 );
+    Summary.insert( "maxUs", Samples.last() / 1000.0 );
+
+    return Summary;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void LoadDriver::finish()
+{
+    const double dSeconds = Elapsed.nsecsElapsed() / 1e9;
+    const CompressionStats Compression = pNetwork->getCompressionStats();
+    const MemoryStats Memory = pNetwork->getMemoryStats();
+    const QVector<ReplicaStats> ReplicaList = pNetwork->getReplicaStats();
+    QJsonObject Endpoints;
+    QJsonArray Replicas;
+    QTextStream Out( stdout );
+
+    ePhase = Phase::Finished;
+
+    for ( QHash<QString, QVector<qint64>>::const_iterator Iterator = EndpointLatencies.begin();
+          Iterator != EndpointLatencies.end();
+          ++Iterator )
+    {
+        Endpoints.insert( Iterator.key(), summarize( Iterator.value() ) );
+    }
+
+    if ( 1 < Settings.iContexts )
+    {
+        Results.insert( "context", Settings.iContext );
+    }
+    Results.insert( "requests", iCompleted );
+    Results.insert( "errors", iErrors );
+    Results.insert( "concurrency", Settings.iConcurrency );
+    Results.insert( "seconds", dSeconds );
+    Results.insert( "requestsPerSecond", ( 0.0 < dSeconds ) ? iCompleted / dSeconds : 0.0 );
+    Results.insert( "latency", summarize( Latencies ) );
+    Results.insert( "endpoints", Endpoints );
+    Results.insert( "allocationsPerRequest",
+                    ( 0 < iCompleted ) ? static_cast<double>( allocationCount() - ulAllocationBaseline ) / iCompleted : 0.0 );
+    Results.insert( "allocationsCounted", QString::fromLatin1( allocationCounter() ) );
+    Results.insert( "residentGrowthBytes",
+                    static_cast<qint64>( Memory.ulResidentBytes ) - static_cast<qint64>( ulResidentBaseline ) );
+    Results.insert( "modelEntries", static_cast<qint64>( Memory.ulModelEntries ) );
+    Results.insert( "modelBytes", static_cast<qint64>( Memory.ulModelBytes ) );
+    Results.insert( "modelEvicted", static_cast<qint64>( Memory.ulModelEvicted ) );
+    Results.insert( "responseCompressionRatio", Compression.responseRatio() );
+    Results.insert( "decodeNsPerResponse", static_cast<qint64>( Compression.decodeNsPerResponse() ) );
+
+    if ( 1 < ReplicaList.size() )
+    {
+        for ( const ReplicaStats & Replica : ReplicaList )
+        {
+            Replicas.append( QJsonObject
+            {
+                { "address", Replica.sAddress },
+                { "primary", Replica.bPrimary },
+                { "healthy", Replica.bHealthy },
+                { "latencyMs", Replica.dLatencyMs },
+                { "health", Replica.dHealth },
+                { "requests", static_cast<qint64>( Replica.ulRequests ) },
+                { "failures", static_cast<qint64>( Replica.ulFailures ) },
+                { "failovers", static_cast<qint64>( Replica.ulFailovers ) }
+            } );
+        }
+        Results.insert( "replicas", Replicas );
+    }
+
+    if ( !ColdLatencies[ 0 ].isEmpty() )
+    {
+        Results.insert( "coldStartPrewarmed", summarize( ColdLatencies[ 0 ] ) );
+        Results.insert( "coldStartUnwarmed", summarize( ColdLatencies[ 1 ] ) );
+    }
+
+    if ( Settings.bJson )
+    {
+        Out << QJsonDocument( Results ).toJson( QJsonDocument::Compact ) << endl;
+    }
+    else
+    {
+        Out << QJsonDocument( Results ).toJson( QJsonDocument::Indented );
+    }
+
+    emit done();
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
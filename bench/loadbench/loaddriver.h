@@ -0,0 +1,111 @@
+#ifndef LOADDRIVER_H
+#define LOADDRIVER_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonObject>
+#include <QObject>
+#include <QStringList>
+#include <QVector>
+#include <functional>
+
+#include "bconnetwork.h"
+
+#define LOAD_DEFAULT_MIX    "getPlayer:60,getGame:10,getAllPlayers:5,getAllPrizes:5,updatePlayerTickets:10,publishPlayerStats:10"
+#define LOAD_SETTLE_MS      250
+
+quint64 allocationCount();
+const char * allocationCounter();
+
+class LoadSettings
+{
+public:
+    QStringList Servers;                // The first is the primary
+    QString sMix = LOAD_DEFAULT_MIX;
+    int iRequests = 10000;
+    int iWarmup = 500;
+    int iConcurrency = 8;
+    int iColdStarts = 0;
+    int iSoakInterval = 0;
+    int iPageSize = 0;
+    int iGames = 20;
+    int iPlayers = 1000;
+    int iPrizes = 100;
+    int iFailPrimaryAfter = 0;
+    int iModelEntries = 0;
+    qint64 iModelBytes = 0;
+    int iModelTimeToLiveMs = 0;
+    int iContext = 0;                   // Which of the contexts running side by side this is
+    int iContexts = 1;
+    bool bPrewarm = true;
+    bool bCompression = true;
+    bool bHttp2 = true;
+    bool bWorkerThread = false;
+    bool bJson = false;
+};
+
+class LoadDriver : public QObject
+{
+    Q_OBJECT
+
+public:
+    LoadDriver( const LoadSettings & Settings, QObject * pParent = nullptr );
+    ~LoadDriver();
+
+public slots:
+    void start();
+
+signals:
+    void done();
+    void primaryFailureDue();
+
+private slots:
+    void handleRequestFinished( const QString & sEndpoint, const int & iStatusCode, const qint64 & iElapsedNs );
+    void startColdStart();
+    void startLoad();
+
+private:
+    enum class Phase
+    {
+        ColdStart,
+        Warmup,
+        Measure,
+        Finished
+    };
+
+    class Operation
+    {
+    public:
+        QString sName;
+        int iWeight;
+        std::function<void( BCONNetwork *, int )> Invoke;
+    };
+
+    LoadSettings Settings;
+    DataStore *pStore;
+    NFCManager *pNFCManager;
+    BCONNetwork *pNetwork;
+    Phase ePhase;
+    QVector<Operation> Operations;
+    int iTotalWeight;
+    int iIssued;
+    int iCompleted;
+    int iErrors;
+    int iColdStart;
+    quint64 ulAllocationBaseline;
+    quint64 ulResidentBaseline;
+    QElapsedTimer Elapsed;
+    QVector<qint64> Latencies;
+    QHash<QString, QVector<qint64>> EndpointLatencies;
+    QVector<qint64> ColdLatencies[ 2 ];
+    QJsonObject Results;
+
+    void createNetwork( const bool & bPrewarm );
+    void issueRequest();
+    void reportSoak();
+    void finish();
+
+    static QJsonObject summarize( QVector<qint64> Samples );
+};
+
+#endif // LOADDRIVER_H
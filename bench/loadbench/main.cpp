@@ -0,0 +1,264 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QThread>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "loaddriver.h"
+#include "mockbackend.h"
+#include "tracer.h"
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/* Count every heap allocation in the process. With the in-process server these include the server's own work, so
+ * point --server at a separately running mockbackend for numbers that cover only the library. */
+static std::atomic<quint64> ulAllocations( 0 );
+
+#if defined( __GLIBC__ )
+/* Qt's containers (QByteArray, QString, QVector...) allocate with malloc() and realloc() rather than operator new, so
+ * count at that level. operator new ends up in malloc() too, and glibc lets the executable stand in for the allocator
+ * of every library it loads. */
+extern "C"
+{
+void * __libc_malloc( std::size_t uiSize );
+void * __libc_calloc( std::size_t uiCount, std::size_t uiSize );
+void * __libc_realloc( void * pMemory, std::size_t uiSize );
+
+void * malloc( std::size_t uiSize )
+{
+    ulAllocations.fetch_add( 1, std::memory_order_relaxed );
+    return __libc_malloc( uiSize );
+}
+
+void * calloc( std::size_t uiCount, std::size_t uiSize )
+{
+    ulAllocations.fetch_add( 1, std::memory_order_relaxed );
+    return __libc_calloc( uiCount, uiSize );
+}
+
+void * realloc( void * pMemory, std::size_t uiSize )
+{
+    /* Growing or shrinking a block counts as well, since it may move; only a realloc() that frees does not. */
+    if ( 0 < uiSize )
+    {
+        ulAllocations.fetch_add( 1, std::memory_order_relaxed );
+    }
+    return __libc_realloc( pMemory, uiSize );
+}
+}
+
+const char * allocationCounter()
+{
+    return "malloc";
+}
+#else
+/* Elsewhere only operator new can be replaced portably, which misses Qt's containers; the results say so. */
+void * operator new( std::size_t uiSize )
+{
+    void *pMemory = std::malloc( ( 0 < uiSize ) ? uiSize : 1 );
+
+    ulAllocations.fetch_add( 1, std::memory_order_relaxed );
+    if ( nullptr == pMemory )
+    {
+        throw std::bad_alloc();
+    }
+
+    return pMemory;
+}
+
+void operator delete( void * pMemory ) noexcept
+{
+    std::free( pMemory );
+}
+
+void operator delete( void * pMemory, std::size_t ) noexcept
+{
+    std::free( pMemory );
+}
+
+const char * allocationCounter()
+{
+    return "operator new";
+}
+#endif
+
+quint64 allocationCount()
+{
+    return ulAllocations.load( std::memory_order_relaxed );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+int main( int argc, char *argv[] )
+{
+    QCoreApplication Application( argc, argv );
+    QCommandLineParser Parser;
+    LoadSettings Settings;
+    QThread ServerThread;
+    QList<QThread *> DriverThreads;
+    QList<LoadDriver *> Drivers;
+    LoadDriver *pDriver = nullptr;
+    QThread *pDriverThread = nullptr;
+    int iRunning = 0;
+    QList<MockBackend *> Backends;
+    MockBackend *pBackend = nullptr;
+    QStringList ReplicaLatencies;
+    quint16 uiPort = 0;
+    int iReturn = 0;
+
+    QCommandLineOption ServerOption( "server", "Use already running servers instead of in-process ones; the first is the primary.", "url[,url...]" );
+    QCommandLineOption RequestsOption( "requests", "Requests to measure.", "count", QString::number( Settings.iRequests ) );
+    QCommandLineOption WarmupOption( "warmup", "Requests to run before measuring.", "count", QString::number( Settings.iWarmup ) );
+    QCommandLineOption ConcurrencyOption( "concurrency", "Requests kept in flight.", "count", QString::number( Settings.iConcurrency ) );
+    QCommandLineOption MixOption( "mix", "Weighted operations, i.e. getPlayer:60,getAllPlayers:5.", "mix", Settings.sMix );
+    QCommandLineOption ColdOption( "cold-starts", "First-request latency samples with and without pre-warming.", "count", "0" );
+    QCommandLineOption SoakOption( "soak-interval", "Print memory statistics every this many requests.", "count", "0" );
+    QCommandLineOption PageOption( "page-size", "Fetch lists in pages of this size.", "count", "0" );
+    QCommandLineOption GamesOption( "games", "Generated games (in-process server).", "count", QString::number( Settings.iGames ) );
+    QCommandLineOption PlayersOption( "players", "Generated players (in-process server).", "count", QString::number( Settings.iPlayers ) );
+    QCommandLineOption PrizesOption( "prizes", "Generated prizes (in-process server).", "count", QString::number( Settings.iPrizes ) );
+    QCommandLineOption LatencyOption( "latency", "Injected reply delay (in-process server).", "ms", "0" );
+    QCommandLineOption JitterOption( "jitter", "Injected random extra delay (in-process server).", "ms", "0" );
+    QCommandLineOption ReplicasOption( "replicas", "Start one in-process server per listed reply delay, i.e. 0,5,20; the first is the primary.", "ms[,ms...]" );
+    QCommandLineOption ContextsOption( "contexts", "Independent clients, each with its own store, run side by side on threads of their own.", "count", "1" );
+    QCommandLineOption ModelEntriesOption( "model-entries", "Bound each store to this many tags.", "count", "0" );
+    QCommandLineOption ModelBytesOption( "model-bytes", "Bound each store to this much estimated memory.", "bytes", "0" );
+    QCommandLineOption ModelTtlOption( "model-ttl", "Drop tags not updated for this long.", "ms", "0" );
+    QCommandLineOption FailPrimaryOption( "fail-primary-after", "Stop the primary in-process server after this many measured requests.", "count", "0" );
+    QCommandLineOption NoPrewarmOption( "no-prewarm", "Do not pre-warm or keep the connection alive." );
+    QCommandLineOption NoCompressionOption( "no-compression", "Disable compression in both directions." );
+    QCommandLineOption NoHttp2Option( "no-http2", "Do not allow HTTP/2." );
+    QCommandLineOption WorkerOption( "worker-thread", "Run the network stack on a worker thread." );
+    QCommandLineOption JsonOption( "json", "Print the results as a single line of JSON." );
+    QCommandLineOption TraceOption( "trace", "Write a Chrome trace of the run to this file.", "file" );
+
+    Application.setApplicationName( "loadbench" );
+    Parser.setApplicationDescription( "Drives mixed workloads through the BCONNetwork slots and reports throughput, "
+                                      "request-to-publish latency and allocations." );
+    Parser.addHelpOption();
+    Parser.addOptions( { ServerOption, RequestsOption, WarmupOption, ConcurrencyOption, MixOption, ColdOption, SoakOption,
+                         PageOption, GamesOption, PlayersOption, PrizesOption, LatencyOption, JitterOption,
+                         ReplicasOption, FailPrimaryOption, ContextsOption, ModelEntriesOption, ModelBytesOption,
+                         ModelTtlOption,
+                         NoPrewarmOption, NoCompressionOption, NoHttp2Option, WorkerOption, JsonOption, TraceOption } );
+    Parser.process( Application );
+
+    Settings.iRequests = Parser.value( RequestsOption ).toInt();
+    Settings.iWarmup = Parser.value( WarmupOption ).toInt();
+    Settings.iConcurrency = qMax( 1, Parser.value( ConcurrencyOption ).toInt() );
+    Settings.sMix = Parser.value( MixOption );
+    Settings.iColdStarts = Parser.value( ColdOption ).toInt();
+    Settings.iSoakInterval = Parser.value( SoakOption ).toInt();
+    Settings.iPageSize = Parser.value( PageOption ).toInt();
+    Settings.iGames = Parser.value( GamesOption ).toInt();
+    Settings.iPlayers = Parser.value( PlayersOption ).toInt();
+    Settings.iPrizes = Parser.value( PrizesOption ).toInt();
+    Settings.iFailPrimaryAfter = Parser.value( FailPrimaryOption ).toInt();
+    Settings.iContexts = qMax( 1, Parser.value( ContextsOption ).toInt() );
+    Settings.iModelEntries = Parser.value( ModelEntriesOption ).toInt();
+    Settings.iModelBytes = Parser.value( ModelBytesOption ).toLongLong();
+    Settings.iModelTimeToLiveMs = Parser.value( ModelTtlOption ).toInt();
+    Settings.bPrewarm = !Parser.isSet( NoPrewarmOption );
+    Settings.bCompression = !Parser.isSet( NoCompressionOption );
+    Settings.bHttp2 = !Parser.isSet( NoHttp2Option );
+    Settings.bWorkerThread = Parser.isSet( WorkerOption );
+    Settings.bJson = Parser.isSet( JsonOption );
+
+    if ( Parser.isSet( ServerOption ) )
+    {
+        Settings.Servers = Parser.value( ServerOption ).split( ',', QString::SkipEmptyParts );
+    }
+    else
+    {
+        /* Each replica is its own server with its own reply delay; without --replicas there is just one. */
+        ReplicaLatencies = Parser.value( ReplicasOption ).split( ',', QString::SkipEmptyParts );
+        if ( ReplicaLatencies.isEmpty() )
+        {
+            ReplicaLatencies.append( Parser.value( LatencyOption ) );
+        }
+
+        /* Serve from a separate thread so the servers do not share the client's event loop. */
+        ServerThread.start();
+        for ( const QString & sLatency : ReplicaLatencies )
+        {
+            pBackend = new MockBackend();
+            pBackend->setDatasetSize( Settings.iGames, Settings.iPlayers, Settings.iPrizes );
+            pBackend->setLatency( sLatency.toInt(), Parser.value( JitterOption ).toInt() );
+            pBackend->setCompressionEnabled( Settings.bCompression );
+            pBackend->moveToThread( &ServerThread );
+            QObject::connect( &ServerThread, SIGNAL( finished() ), pBackend, SLOT( deleteLater() ) );
+            Backends.append( pBackend );
+
+            QMetaObject::invokeMethod( pBackend, "start", Qt::BlockingQueuedConnection,
+                                       Q_RETURN_ARG( quint16, uiPort ), Q_ARG( quint16, 0 ) );
+            if ( 0 == uiPort )
+            {
+                qCritical( "Failed to start the in-process server." );
+                ServerThread.quit();
+                ServerThread.wait();
+                return 1;
+            }
+
+            Settings.Servers.append( QString( "http://127.0.0.1:%1" ).arg( uiPort ) );
+        }
+    }
+
+    /* A single context runs on the main thread; several each get a thread, so they scale across cores. */
+    for ( int i = 0; i < Settings.iContexts; i++ )
+    {
+        Settings.iContext = i;
+        pDriver = new LoadDriver( Settings );
+        if ( 1 < Settings.iContexts )
+        {
+            pDriverThread = new QThread();
+            pDriverThread->setObjectName( QString( "LoadDriver %1" ).arg( i ) );
+            pDriver->moveToThread( pDriverThread );
+            QObject::connect( pDriverThread, SIGNAL( finished() ), pDriver, SLOT( deleteLater() ) );
+            pDriverThread->start();
+            DriverThreads.append( pDriverThread );
+        }
+        else
+        {
+            Drivers.append( pDriver );
+        }
+        iRunning++;
+
+        QObject::connect( pDriver, &LoadDriver::done, &Application, [ &iRunning, &Application ]()
+        {
+            if ( 0 == --iRunning )
+            {
+                Application.quit();
+            }
+        } );
+        if ( !Backends.isEmpty() )
+        {
+            QObject::connect( pDriver, SIGNAL( primaryFailureDue() ), Backends.first(), SLOT( stop() ) );
+        }
+        QMetaObject::invokeMethod( pDriver, "start", Qt::QueuedConnection );
+    }
+
+    if ( ( Parser.isSet( TraceOption ) ) && ( !Tracer::start( Parser.value( TraceOption ) ) ) )
+    {
+        qWarning( "Failed to start tracing." );
+    }
+
+    iReturn = Application.exec();
+
+    if ( Tracer::isEnabled() )
+    {
+        ( void )Tracer::stop();
+    }
+
+    for ( QThread * pThread : DriverThreads )
+    {
+        pThread->quit();
+        pThread->wait();
+    }
+    qDeleteAll( Drivers );
+    qDeleteAll( DriverThreads );
+
+    ServerThread.quit();
+    ServerThread.wait();
+
+    return iReturn;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
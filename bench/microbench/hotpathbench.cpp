@@ -0,0 +1,345 @@
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QtTest>
+
+#include "jsonflattener.h"
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+class CountingSubscriber : public DataSubscriber
+{
+public:
+    int iReceived = 0;
+
+    void handleData( const DataPoint & ) override
+    {
+        iReceived++;
+    }
+};
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+class HotPathBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void flattenDeepObject_data();
+    void flattenDeepObject();
+    void flattenArray_data();
+    void flattenArray();
+    void parseAndPublish_data();
+    void parseAndPublish();
+
+    void publishFanOut_data();
+    void publishFanOut();
+    void getDataPoint_data();
+    void getDataPoint();
+    void unsubscribeAll_data();
+    void unsubscribeAll();
+    void leaderboardUpdate_data();
+    void leaderboardUpdate();
+
+private:
+    static QJsonObject player( const int & iIndex );
+    static QJsonObject deepObject( const int & iDepth );
+    static QJsonObject playerList( const int & iPlayers );
+
+    QDateTime Timestamp;
+    int iModelSize = 0;
+};
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+QJsonObject HotPathBenchmark::player( const int & iIndex )
+{
+    QJsonArray Stats;
+
+    /* Same shape as the players served by the mock backend. */
+    for ( int i = 0; i < 3; i++ )
+    {
+        Stats.append( QJsonObject
+        {
+            { "gameId", QString( "6a%1" ).arg( i, 22, 16, QChar( '0' ) ) },
+            { "highScore", ( iIndex * 131 + i * 17 ) % 100000 },
+            { "ticketsEarned", ( iIndex * 13 + i ) % 500 }
+        } );
+    }
+
+    return QJsonObject
+    {
+        { "playerId", QString::number( 0x04000000u + static_cast<unsigned int>( iIndex ), 16 ) },
+        { "firstName", "Player" },
+        { "lastName", QString::number( iIndex ) },
+        { "screenName", QString( "player%1" ).arg( iIndex ) },
+        { "tokens", iIndex % 50 },
+        { "tickets", ( iIndex * 37 ) % 10000 },
+        { "stats", Stats }
+    };
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+QJsonObject HotPathBenchmark::deepObject( const int & iDepth )
+{
+    QJsonObject Object
+    {
+        { "name", QString( "level%1" ).arg( iDepth ) },
+        { "count", iDepth },
+        { "ratio", iDepth + 0.5 },
+        { "enabled", 0 == ( iDepth % 2 ) }
+    };
+
+    if ( 0 < iDepth )
+    {
+        Object.insert( "child", deepObject( iDepth - 1 ) );
+    }
+
+    return Object;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+QJsonObject HotPathBenchmark::playerList( const int & iPlayers )
+{
+    QJsonArray Players;
+
+    for ( int i = 0; i < iPlayers; i++ )
+    {
+        Players.append( player( i ) );
+    }
+
+    return QJsonObject { { "players", Players } };
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void HotPathBenchmark::initTestCase()
+{
+    DataStore::instance();
+    Timestamp = QDateTime::currentDateTimeUtc();
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void HotPathBenchmark::flattenDeepObject_data()
+{
+    QTest::addColumn<int>( "iDepth" );
+
+    QTest::newRow( "depth 4" ) << 4;
+    QTest::newRow( "depth 16" ) << 16;
+    QTest::newRow( "depth 64" ) << 64;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void HotPathBenchmark::flattenDeepObject()
+{
+    QFETCH( int, iDepth );
+    QJsonObject Object { { "config", deepObject( iDepth ) } };
+    QList<DataPoint> Points;
+
+    QBENCHMARK
+    {
+        Points = JSONFlattener::JSONUnpackObject( Object, Object.begin(), QString(), Timestamp );
+    }
+
+    /* Four values plus the open and close markers per level. */
+    QCOMPARE( Points.size(), ( iDepth + 1 ) * 6 );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void HotPathBenchmark::flattenArray_data()
+{
+    QTest::addColumn<int>( "iPlayers" );
+
+    QTest::newRow( "100 players" ) << 100;
+    QTest::newRow( "1000 players" ) << 1000;
+    QTest::newRow( "10000 players" ) << 10000;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void HotPathBenchmark::flattenArray()
+{
+    QFETCH( int, iPlayers );
+    QJsonObject Object = playerList( iPlayers );
+    QList<DataPoint> Points;
+
+    QBENCHMARK
+    {
+        Points = JSONFlattener::JSONUnpackObject( Object, Object.begin(), QString(), Timestamp );
+    }
+
+    QVERIFY( iPlayers < Points.size() );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void HotPathBenchmark::parseAndPublish_data()
+{
+    flattenArray_data();
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void HotPathBenchmark::parseAndPublish()
+{
+    QFETCH( int, iPlayers );
+    QByteArray Payload = QJsonDocument( playerList( iPlayers ) ).toJson( QJsonDocument::Compact );
+
+    /* The whole path a reply body takes, from bytes to the data model. */
+    QBENCHMARK
+    {
+        JSONFlattener::handleJSONPayload( DataStore::instance(), Payload );
+    }
+
+    QCOMPARE( DataStore::getDataPoint( "players.length" ).Value.toInt(), iPlayers );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void HotPathBenchmark::publishFanOut_data()
+{
+    QTest::addColumn<int>( "iSubscribers" );
+
+    QTest::newRow( "1 subscriber" ) << 1;
+    QTest::newRow( "10 subscribers" ) << 10;
+    QTest::newRow( "100 subscribers" ) << 100;
+    QTest::newRow( "1000 subscribers" ) << 1000;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void HotPathBenchmark::publishFanOut()
+{
+    QFETCH( int, iSubscribers );
+    QVector<CountingSubscriber> Subscribers( iSubscribers );
+    DataPoint Point( "Bench.FanOut", QVariant( 42 ), Timestamp );
+
+    for ( CountingSubscriber & Subscriber : Subscribers )
+    {
+        DataStore::subscribe( Point.sTag, &Subscriber );
+    }
+
+    QBENCHMARK
+    {
+        DataStore::publish( Point );
+    }
+
+    for ( CountingSubscriber & Subscriber : Subscribers )
+    {
+        QVERIFY( 0 < Subscriber.iReceived );
+        DataStore::unsubscribeAll( &Subscriber );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void HotPathBenchmark::getDataPoint_data()
+{
+    QTest::addColumn<int>( "iTags" );
+
+    QTest::newRow( "10k tags" ) << 10000;
+    QTest::newRow( "100k tags" ) << 100000;
+    QTest::newRow( "1M tags" ) << 1000000;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void HotPathBenchmark::getDataPoint()
+{
+    QFETCH( int, iTags );
+    QStringList Lookups;
+    DataPoint Point;
+
+    /* The model only grows, so each row tops it up to its size. */
+    for ( ; iModelSize < iTags; iModelSize++ )
+    {
+        DataStore::publish( DataPoint( QString( "Bench.Model.%1.Value" ).arg( iModelSize ), QVariant( iModelSize ), Timestamp ) );
+    }
+
+    for ( int i = 0; i < 1024; i++ )
+    {
+        Lookups.append( QString( "Bench.Model.%1.Value" ).arg( ( i * 7919 ) % iTags ) );
+    }
+
+    /* Each iteration looks up 1024 tags spread across the model. */
+    QBENCHMARK
+    {
+        for ( const QString & sTag : Lookups )
+        {
+            Point = DataStore::getDataPoint( sTag );
+        }
+    }
+
+    QVERIFY( Point.isValid() );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void HotPathBenchmark::unsubscribeAll_data()
+{
+    QTest::addColumn<int>( "iSubscriptions" );
+
+    QTest::newRow( "1k subscriptions" ) << 1000;
+    QTest::newRow( "10k subscriptions" ) << 10000;
+    QTest::newRow( "100k subscriptions" ) << 100000;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void HotPathBenchmark::unsubscribeAll()
+{
+    QFETCH( int, iSubscriptions );
+    CountingSubscriber Background;
+    CountingSubscriber Leaving;
+
+    /* Other subscribers fill the store; the one leaving holds 100 tags among them. */
+    for ( int i = 0; i < iSubscriptions; i++ )
+    {
+        DataStore::subscribe( QString( "Bench.Subscription.%1" ).arg( i ), &Background );
+    }
+
+    QBENCHMARK
+    {
+        for ( int i = 0; i < 100; i++ )
+        {
+            DataStore::subscribe( QString( "Bench.Subscription.%1" ).arg( i * 10 ), &Leaving );
+        }
+        DataStore::unsubscribeAll( &Leaving );
+    }
+
+    DataStore::publish( DataPoint( "Bench.Subscription.0", QVariant( 1 ), Timestamp ) );
+    QCOMPARE( Leaving.iReceived, 0 );
+    QCOMPARE( Background.iReceived, 1 );
+
+    DataStore::unsubscribeAll( &Background );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void HotPathBenchmark::leaderboardUpdate_data()
+{
+    flattenArray_data();
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void HotPathBenchmark::leaderboardUpdate()
+{
+    QFETCH( int, iPlayers );
+    DataStore Store;
+    QVector<RankedEntry> Top;
+    QStringList Ids;
+    int iUpdate = 0;
+
+    JSONFlattener::handleJSONPayload( &Store,
+                                      QJsonDocument( playerList( iPlayers ) ).toJson( QJsonDocument::Compact ) );
+    Store.addIndex( "tickets", { "players.*", "player" }, "playerId", "tickets" );
+
+    for ( int i = 0; i < iPlayers; i++ )
+    {
+        Ids.append( player( i ).value( "playerId" ).toString() );
+    }
+
+    /* Each iteration is a publishPlayerStats() reply for one player followed by a refresh of the top ten. */
+    QBENCHMARK
+    {
+        Store.insert( DataPoint( "player.playerId", QVariant( Ids.at( ( iUpdate * 7919 ) % iPlayers ) ), Timestamp ) );
+        Store.insert( DataPoint( "player.tickets", QVariant( iUpdate % 10000 ), Timestamp ) );
+        Top = Store.getTop( "tickets", 10 );
+        iUpdate++;
+    }
+
+    QCOMPARE( Store.getIndexSize( "tickets" ), iPlayers );
+    QCOMPARE( Top.size(), qMin( 10, iPlayers ) );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+QTEST_GUILESS_MAIN( HotPathBenchmark )
+
+#include "hotpathbench.moc"
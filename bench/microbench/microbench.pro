@@ -0,0 +1,15 @@
+QT -= gui
+QT += network testlib
+
+CONFIG += console
+CONFIG -= app_bundle
+
+TARGET = hotpathbench
+TEMPLATE = app
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+SOURCES += \
+    hotpathbench.cpp
+
+include( ../../libBCONNetwork.pri )
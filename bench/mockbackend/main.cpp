@@ -0,0 +1,59 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QTimer>
+
+#include "mockbackend.h"
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+int main( int argc, char *argv[] )
+{
+    QCoreApplication Application( argc, argv );
+    QCommandLineParser Parser;
+    MockBackend Backend;
+    quint16 uiPort = 0;
+
+    QCommandLineOption PortOption( "port", "Port to listen on.", "port", QString::number( MOCK_DEFAULT_PORT ) );
+    QCommandLineOption GamesOption( "games", "Number of generated games.", "count", QString::number( MOCK_DEFAULT_GAMES ) );
+    QCommandLineOption PlayersOption( "players", "Number of generated players.", "count", QString::number( MOCK_DEFAULT_PLAYERS ) );
+    QCommandLineOption PrizesOption( "prizes", "Number of generated prizes.", "count", QString::number( MOCK_DEFAULT_PRIZES ) );
+    QCommandLineOption LatencyOption( "latency", "Fixed delay added to every reply.", "ms", "0" );
+    QCommandLineOption JitterOption( "jitter", "Random extra delay of up to this much.", "ms", "0" );
+    QCommandLineOption NoCompressionOption( "no-compression", "Never compress replies." );
+    QCommandLineOption IgnoreOffsetOption( "ignore-offset", "Serve every page from the start of its collection." );
+    QCommandLineOption IgnoreLimitOption( "ignore-limit", "Serve whole collections even when a page is asked for." );
+    QCommandLineOption DropStreamsOption( "drop-streams", "Cut all event streams this often to exercise reconnects.", "seconds", "0" );
+    QTimer DropTimer;
+
+    Application.setApplicationName( "mockbackend" );
+    Parser.setApplicationDescription( "Local stand-in for the BCON backend serving generated data." );
+    Parser.addHelpOption();
+    Parser.addOptions( { PortOption, GamesOption, PlayersOption, PrizesOption, LatencyOption, JitterOption,
+                         NoCompressionOption, IgnoreOffsetOption, IgnoreLimitOption, DropStreamsOption } );
+    Parser.process( Application );
+
+    Backend.setDatasetSize( Parser.value( GamesOption ).toInt(),
+                            Parser.value( PlayersOption ).toInt(),
+                            Parser.value( PrizesOption ).toInt() );
+    Backend.setLatency( Parser.value( LatencyOption ).toInt(), Parser.value( JitterOption ).toInt() );
+    Backend.setCompressionEnabled( !Parser.isSet( NoCompressionOption ) );
+    Backend.setPagingSupport( !Parser.isSet( IgnoreOffsetOption ), !Parser.isSet( IgnoreLimitOption ) );
+
+    uiPort = Backend.start( static_cast<quint16>( Parser.value( PortOption ).toUInt() ) );
+    if ( 0 == uiPort )
+    {
+        qCritical() << "Failed to listen:" << Backend.errorString();
+        return 1;
+    }
+
+    if ( 0 < Parser.value( DropStreamsOption ).toInt() )
+    {
+        QObject::connect( &DropTimer, SIGNAL( timeout() ), &Backend, SLOT( dropEventStreams() ) );
+        DropTimer.start( Parser.value( DropStreamsOption ).toInt() * 1000 );
+    }
+
+    qInfo() << "Mock backend listening on" << QString( "http://localhost:%1" ).arg( uiPort );
+
+    return Application.exec();
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,23 @@
+QT -= gui
+QT += network
+
+CONFIG += console c++14
+CONFIG -= app_bundle
+
+TARGET = mockbackend
+TEMPLATE = app
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+INCLUDEPATH += ../../src
+
+SOURCES += \
+    main.cpp \
+    ../../src/compression.cpp
+
+HEADERS += \
+    ../../src/compression.h
+
+LIBS += -lz
+
+include( ../common/mockbackend.pri )
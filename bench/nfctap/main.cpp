@@ -0,0 +1,177 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <QThread>
+#include <QtEndian>
+#include <QTimer>
+
+#include "cardrecord.h"
+#include "nfcmanager.h"
+#include "simulatedreader.h"
+#include "tracer.h"
+
+#define NFCTAP_READER_NAME  "Simulated Reader %1"
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static QJsonObject summarize( const LatencyHistogram & Histogram )
+{
+    QJsonObject Summary;
+
+    /* Bucket upper bounds, in microseconds. */
+    Summary.insert( "count", static_cast<qint64>( Histogram.count() ) );
+    Summary.insert( "meanUs", ( 0 < Histogram.count() ) ? Histogram.sumNs() / 1000.0 / Histogram.count() : 0.0 );
+    Summary.insert( "p50Us", Histogram.percentileNs( 0.5 ) / 1000.0 );
+    Summary.insert( "p99Us", Histogram.percentileNs( 0.99 ) / 1000.0 );
+
+    return Summary;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+int main( int argc, char *argv[] )
+{
+    QCoreApplication Application( argc, argv );
+    QCommandLineParser Parser;
+    SimulatedReader Reader;
+    NFCManager *pManager = nullptr;
+    QList<SimulatedEvent> Script;
+    SimulatedEvent Event;
+    QThread *pPlayer = nullptr;
+    QElapsedTimer Elapsed;
+    QJsonObject Results;
+    QTextStream Out( stdout );
+    int iRead = 0;
+    int iRecords = 0;
+    int iReturn = 0;
+
+    QCommandLineOption TapsOption( "taps", "Taps to simulate.", "count", "1000" );
+    QCommandLineOption ReadersOption( "readers", "Simulated readers, tapped in turn.", "count", "1" );
+    QCommandLineOption BurstOption( "burst", "Taps per burst.", "count", "10" );
+    QCommandLineOption IntervalOption( "interval", "Time between taps within a burst.", "us", "2000" );
+    QCommandLineOption GapOption( "gap", "Time between bursts.", "ms", "50" );
+    QCommandLineOption HoldOption( "hold", "Time a card stays on the reader.", "us", "1000" );
+    QCommandLineOption ConnectOption( "connect-latency", "Simulated time to connect to a card.", "us", "0" );
+    QCommandLineOption TransmitOption( "transmit-latency", "Simulated time to exchange an APDU.", "us", "0" );
+    QCommandLineOption RecordsOption( "records", "Give every card a player record and read it on each tap." );
+    QCommandLineOption JsonOption( "json", "Print the results as a single line of JSON." );
+    QCommandLineOption TraceOption( "trace", "Write a Chrome trace of the run to this file.", "file" );
+
+    Application.setApplicationName( "nfctap" );
+    Parser.setApplicationDescription( "Plays bursts of taps on simulated readers through the NFC worker and reports "
+                                      "the time to read each UID and to deliver it to the application thread." );
+    Parser.addHelpOption();
+    Parser.addOptions( { TapsOption, ReadersOption, BurstOption, IntervalOption, GapOption, HoldOption, ConnectOption,
+                         TransmitOption, RecordsOption, JsonOption, TraceOption } );
+    Parser.process( Application );
+
+    const int iTaps = qMax( 1, Parser.value( TapsOption ).toInt() );
+    const int iReaders = qMax( 1, Parser.value( ReadersOption ).toInt() );
+    const int iBurst = qMax( 1, Parser.value( BurstOption ).toInt() );
+    const int iIntervalUs = qMax( 0, Parser.value( IntervalOption ).toInt() );
+    const int iGapUs = qMax( 0, Parser.value( GapOption ).toInt() ) * 1000;
+    const int iHoldUs = qMax( 0, Parser.value( HoldOption ).toInt() );
+
+    /* Every tap puts a card with a unique UID on the next reader, and takes it off after the hold time. */
+    Reader.setLatency( Parser.value( ConnectOption ).toInt(), Parser.value( TransmitOption ).toInt() );
+    for ( int i = 0; i < iReaders; i++ )
+    {
+        Reader.attachReader( QString( NFCTAP_READER_NAME ).arg( i ) );
+    }
+    for ( int i = 0; i < iTaps; i++ )
+    {
+        Event.sReader = QString( NFCTAP_READER_NAME ).arg( i % iReaders );
+        Event.eType = SimulatedEvent::Type::Insert;
+        Event.Uid = QByteArray( 4, '\0' );
+        qToBigEndian<quint32>( 0x04000000u + static_cast<quint32>( i ), Event.Uid.data() );
+        if ( Parser.isSet( RecordsOption ) )
+        {
+            Reader.writeCardMemory( Event.Uid,
+                                    CARD_RECORD_FIRST_PAGE * CARD_RECORD_PAGE_BYTES,
+                                    CardRecord::encode( QVariantMap { { "screenName", QString( "player%1" ).arg( i ) },
+                                                                      { "tokens", i % 50 },
+                                                                      { "tickets", ( i * 37 ) % 10000 } } ) );
+        }
+        Event.iDelayUs = ( 0 == i ) ? 0 : ( ( 0 == ( i % iBurst ) ) ? iGapUs : iIntervalUs );
+        Script.append( Event );
+
+        Event.eType = SimulatedEvent::Type::Remove;
+        Event.iDelayUs = iHoldUs;
+        Script.append( Event );
+    }
+
+    if ( ( Parser.isSet( TraceOption ) ) && ( !Tracer::start( Parser.value( TraceOption ) ) ) )
+    {
+        qWarning( "Failed to start tracing." );
+    }
+
+    pManager = NFCManager::instance();
+    pManager->setBackend( &Reader );
+    pManager->setCardRecords( Parser.isSet( RecordsOption ) );
+    if ( !pManager->nfcManagerInit() )
+    {
+        qCritical( "Failed to start the NFC manager." );
+        return 1;
+    }
+
+    /* Count the UIDs reaching this thread; the run ends when all taps are in, or when the script has long finished. */
+    QObject::connect( pManager, &NFCManager::cardRead, [ & ]( const QString & )
+    {
+        if ( iTaps == ++iRead )
+        {
+            Application.quit();
+        }
+    } );
+
+    QObject::connect( pManager, &NFCManager::cardRecordRead, [ & ]( const QString &, const QString &, const QVariantMap & )
+    {
+        iRecords++;
+    } );
+
+    pPlayer = QThread::create( [ & ]()
+    {
+        Reader.play( Script );
+        QThread::msleep( 1000 );
+        QMetaObject::invokeMethod( &Application, "quit", Qt::QueuedConnection );
+    } );
+    Elapsed.start();
+    pPlayer->start();
+
+    iReturn = Application.exec();
+    pPlayer->wait();
+    delete pPlayer;
+
+    if ( Tracer::isEnabled() )
+    {
+        ( void )Tracer::stop();
+    }
+
+    const NFCStats & Stats = pManager->getStats();
+    const double dSeconds = Elapsed.nsecsElapsed() / 1e9;
+
+    Results.insert( "taps", iTaps );
+    Results.insert( "tapsRead", iRead );
+    Results.insert( "recordsRead", iRecords );
+    Results.insert( "readers", iReaders );
+    Results.insert( "seconds", dSeconds );
+    Results.insert( "tapsPerSecond", ( 0.0 < dSeconds ) ? iRead / dSeconds : 0.0 );
+    Results.insert( "wakeups", static_cast<qint64>( Stats.ulWakeups.load() ) );
+    Results.insert( "spuriousWakeups", static_cast<qint64>( Stats.ulSpuriousWakeups.load() ) );
+    Results.insert( "errors", static_cast<qint64>( Stats.ulErrors.load() ) );
+    Results.insert( "transmits", static_cast<qint64>( Reader.transmitCount() ) );
+    Results.insert( "read", summarize( Stats.ReadLatency ) );
+    Results.insert( "dispatch", summarize( Stats.DispatchLatency ) );
+
+    if ( Parser.isSet( JsonOption ) )
+    {
+        Out << QJsonDocument( Results ).toJson( QJsonDocument::Compact ) << endl;
+    }
+    else
+    {
+        Out << QJsonDocument( Results ).toJson( QJsonDocument::Indented );
+    }
+
+    return iReturn;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,15 @@
+QT -= gui
+QT += network
+
+CONFIG += console
+CONFIG -= app_bundle
+
+TARGET = nfctap
+TEMPLATE = app
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+SOURCES += \
+    main.cpp
+
+include( ../../libBCONNetwork.pri )
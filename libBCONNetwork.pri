@@ -0,0 +1,47 @@
+# Sources and dependencies of the library, shared by the library project and the benchmarks that build against it.
+
+QT += network
+
+CONFIG += c++14
+
+INCLUDEPATH += $$PWD/src
+
+SOURCES += \
+    $$PWD/src/bufferpool.cpp \
+    $$PWD/src/cardrecord.cpp \
+    $$PWD/src/compression.cpp \
+    $$PWD/src/datastore.cpp \
+    $$PWD/src/bconnetwork.cpp \
+    $$PWD/src/endpoints.cpp \
+    $$PWD/src/jsonflattener.cpp \
+    $$PWD/src/metrics.cpp \
+    $$PWD/src/nfcmanager.cpp \
+    $$PWD/src/pcscbackend.cpp \
+    $$PWD/src/pushchannel.cpp \
+    $$PWD/src/ranktree.cpp \
+    $$PWD/src/replicaset.cpp \
+    $$PWD/src/simulatedreader.cpp \
+    $$PWD/src/tracer.cpp
+
+HEADERS += \
+    $$PWD/src/bufferpool.h \
+    $$PWD/src/cardrecord.h \
+    $$PWD/src/compression.h \
+    $$PWD/src/datastore.h \
+    $$PWD/src/bconnetwork.h \
+    $$PWD/src/endpoints.h \
+    $$PWD/src/jsonflattener.h \
+    $$PWD/src/metrics.h \
+    $$PWD/src/nfcmanager.h \
+    $$PWD/src/pcscbackend.h \
+    $$PWD/src/pushchannel.h \
+    $$PWD/src/ranktree.h \
+    $$PWD/src/replicaset.h \
+    $$PWD/src/simulatedreader.h \
+    $$PWD/src/tracer.h
+
+mac: LIBS += -framework PCSC
+LIBS += -lz
+
+unix:!macx: CONFIG += link_pkgconfig
+unix:!macx: PKGCONFIG += libpcsclite
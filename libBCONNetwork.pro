@@ -5,7 +5,6 @@
 #-------------------------------------------------
 
 QT -= gui
-QT += network
 
 TARGET = BCONNetwork
 TEMPLATE = lib
@@ -21,20 +20,7 @@ DEFINES += QT_DEPRECATED_WARNINGS
 # You can also select to disable deprecated APIs only up to a certain version of Qt.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
-SOURCES += \
-    src/datastore.cpp \
-    src/bconnetwork.cpp \
-    src/nfcmanager.cpp
-
-HEADERS += \
-    src/datastore.h \
-    src/bconnetwork.h \
-    src/nfcmanager.h
-
-mac: LIBS += -framework PCSC
-
-unix:!macx: CONFIG += link_pkgconfig
-unix:!macx: PKGCONFIG += libpcsclite
+include( libBCONNetwork.pri )
 
 macx: QMAKE_LFLAGS_SONAME = -Wl,-install_name,@rpath/
 
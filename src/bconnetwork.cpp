@@ -1,16 +1,29 @@
 #include <QDebug>
 #include <QJsonArray>
 #include <QJsonDocument>
-#include <QtMath>
+#include <QJsonObject>
 #include <QNetworkReply>
+#include <QSaveFile>
+#include <QUrlQuery>
+#ifndef QT_NO_SSL
+#include <QSslConfiguration>
+#endif
 
 #include "bconnetwork.h"
+#include "jsonflattener.h"
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-BCONNetwork::BCONNetwork( const QString & sServerRootAddress, const bool & bUseNFC )
+BCONNetwork::BCONNetwork( const QString & sServerRootAddress,
+                          const bool & bUseNFC,
+                          const bool & bPrewarm,
+                          const bool & bUseWorkerThread,
+                          DataStore * pStore,
+                          NFCManager * pNFC )
 {
-    pModel = DataStore::instance();
-    pNFCManager = NFCManager::instance();
+    /* Publish into the given store and take taps from the given manager, or else the process-wide ones. Clients
+     * with stores of their own share no data, so several can run side by side in one process. */
+    pModel = ( nullptr != pStore ) ? pStore : DataStore::instance();
+    pNFCManager = ( nullptr != pNFC ) ? pNFC : NFCManager::instance();
     pNetworkManager = new QNetworkAccessManager();
     connect( pNetworkManager, SIGNAL( finished( QNetworkReply * ) ), this, SLOT( handleNetworkReply( QNetworkReply * ) ) );
 
@@ -20,464 +33,1532 @@ BCONNetwork::BCONNetwork( const QString & sServerRootAddress, const bool & bUseN
         qDebug() << "LibBCONNetwork::LibBCONNetwork: Failed to initialize the NFC manager!";
     }
 
-    sServerAddress = sServerRootAddress;
+    /* Tap prefetching is opt-in; the UID arrives straight from the NFC worker, ahead of the application. */
+    bTapPrefetch = false;
+    iPlayerCacheEntries = PREFETCH_CACHE_ENTRIES;
+    iPlayerCacheMaxAgeMs = PREFETCH_MAX_AGE_MS;
+    ulPlayerCacheGeneration = 0;
+    connect( pNFCManager, SIGNAL( cardDecoded( const QString &, const QString &, const qint64 & ) ),
+             this, SLOT( handleCardDecoded( const QString &, const QString &, const qint64 & ) ) );
+
+    /* A single server to begin with; setReplicas() can spread requests over several. */
+    Replicas.setReplicas( QStringList { sServerRootAddress } );
+    iPushReplica = -1;
+
+    /* Keep the connection warm between requests so taps after an idle period skip connection setup. */
+    bHttp2Allowed = true;
+    iCompressionThreshold = COMPRESSION_THRESHOLD_BYTES;
+    iPageSize = 0;
+    iPagesInFlight = PAGE_PIPELINE_DEPTH;
+    ulRepliesReleased = 0;
+    ulRepliesOversize = 0;
+    ReceiveScratch.reserve( BUFFER_INITIAL_BYTES );
+    iKeepAliveMaxIdleMs = KEEPALIVE_MAX_IDLE_MS;
+    pKeepAliveTimer = new QTimer( this );
+    pKeepAliveTimer->setInterval( KEEPALIVE_REFRESH_MS );
+    connect( pKeepAliveTimer, SIGNAL( timeout() ), this, SLOT( handleKeepAlive() ) );
+    IdleTimer.start();
+
+    /* Metrics are always collected; exporting them is opt-in. */
+    bMetricsTags = false;
+    pMetricsTimer = new QTimer( this );
+    connect( pMetricsTimer, SIGNAL( timeout() ), this, SLOT( handleMetricsExport() ) );
+
+    /* Server push is opt-in; the channel shares the network manager and thread with everything else. */
+    pPushChannel = new PushChannel( pNetworkManager, this );
+    connect( pPushChannel, SIGNAL( connected() ), this, SLOT( handlePushConnected() ) );
+    connect( pPushChannel, SIGNAL( disconnected() ), this, SLOT( handlePushDisconnected() ) );
+    connect( pPushChannel, SIGNAL( eventReceived( const QString &, const QByteArray & ) ),
+             this, SLOT( handlePushEvent( const QString &, const QByteArray & ) ) );
+
+    /* Optionally run the network stack, reply handling and parsing on a thread of their own. Data points are then
+     * handed to the DataStore's thread in batches, and public calls from other threads are queued over. */
+    pOwnerThread = thread();
+    pWorkerThread = nullptr;
+    if ( bUseWorkerThread )
+    {
+        pWorkerThread = new QThread();
+        pWorkerThread->setObjectName( "BCONNetwork" );
+        pNetworkManager->moveToThread( pWorkerThread );
+        moveToThread( pWorkerThread );
+        pWorkerThread->start();
+    }
 
-    /* Output a warning if the address is invalid. */
-    if ( !QUrl( sServerAddress ).isValid() )
+    if ( bPrewarm )
     {
-        qDebug() << "LibBCONNetwork::LibBCONNetwork: The passed server URL is invalid!";
+        QMetaObject::invokeMethod( this, [ this ]()
+        {
+            prewarmConnection();
+            pKeepAliveTimer->start();
+        }, Qt::AutoConnection );
     }
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
 BCONNetwork::~BCONNetwork()
 {
+    /* Tear the network stack down on its own thread and bring this object back before the thread goes away. */
+    if ( ( nullptr != pWorkerThread ) && ( QThread::currentThread() == pWorkerThread ) )
+    {
+        /* Deleted on the worker itself (i.e. through deleteLater()), which can neither block on nor wait for its own
+         * thread; the thread is deleted on its owner's once it has finished. */
+        shutdownWorker();
+        connect( pWorkerThread, SIGNAL( finished() ), pWorkerThread, SLOT( deleteLater() ) );
+        pWorkerThread->quit();
+        pWorkerThread = nullptr;
+    }
+    else if ( nullptr != pWorkerThread )
+    {
+        QMetaObject::invokeMethod( this, [ this ]() { shutdownWorker(); }, Qt::BlockingQueuedConnection );
+        pWorkerThread->quit();
+        pWorkerThread->wait();
+        delete pWorkerThread;
+        pWorkerThread = nullptr;
+    }
+
+    /* The push stream's reply belongs to the network manager, so let go of it first. */
+    if ( nullptr != pPushChannel )
+    {
+        pPushChannel->close();
+    }
+
+    /* Outstanding replies are owned by the network manager, but their decoders are not. */
+    for ( const PendingRequest & Pending : PendingRequests )
+    {
+        delete Pending.pDecoder;
+    }
+
     delete pNetworkManager;
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void BCONNetwork::handleNetworkReply( QNetworkReply *pReply )
+void BCONNetwork::setKeepAlivePolicy( const int & iRefreshIntervalMs, const int & iMaxIdleMs )
 {
-    if ( QNetworkReply::NoError == pReply->error() )
+    if ( forwardToNetworkThread( [ = ]() { setKeepAlivePolicy( iRefreshIntervalMs, iMaxIdleMs ); } ) )
     {
-        /* Process the request. */
-        handleJSONPayload( pReply->readAll() );
+        return;
+    }
+
+    /* A refresh interval of zero disables keep-alive entirely; a maximum idle time of zero never gives up. */
+    iKeepAliveMaxIdleMs = iMaxIdleMs;
+
+    if ( 0 < iRefreshIntervalMs )
+    {
+        pKeepAliveTimer->start( iRefreshIntervalMs );
     }
     else
     {
-        /* Check the HTTP status code. */
-        switch ( pReply->attribute( QNetworkRequest::HttpStatusCodeAttribute ).toInt() )
-        {
-        case 400:
-        case 500:
-            /* Attempt to parse out the error detail. */
-            handleJSONPayload( pReply->readAll() );
-            break;
+        pKeepAliveTimer->stop();
+        pKeepAliveTimer->setInterval( 0 );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
 
-        default:
-            qDebug() << "LibBCONNetwork::handleNetworkReply received error" << pReply->error() << "for" << pReply->url();
-            break;
+void BCONNetwork::setHttp2Allowed( const bool & bAllowed )
+{
+    if ( forwardToNetworkThread( [ = ]() { setHttp2Allowed( bAllowed ); } ) )
+    {
+        return;
+    }
+
+    bHttp2Allowed = bAllowed;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void BCONNetwork::setRequestCompressionThreshold( const int & iThresholdBytes )
+{
+    if ( forwardToNetworkThread( [ = ]() { setRequestCompressionThreshold( iThresholdBytes ); } ) )
+    {
+        return;
+    }
+
+    /* Bodies at or above the threshold are sent gzip-compressed; zero or less disables request compression. */
+    iCompressionThreshold = iThresholdBytes;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void BCONNetwork::setListPaging( const int & iPageSize, const int & iPagesInFlight )
+{
+    if ( forwardToNetworkThread( [ = ]() { setListPaging( iPageSize, iPagesInFlight ); } ) )
+    {
+        return;
+    }
+
+    /* A page size of zero fetches whole collections in a single reply. */
+    this->iPageSize = qMax( 0, iPageSize );
+    this->iPagesInFlight = qMax( 1, iPagesInFlight );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void BCONNetwork::setMaxPayloadSize( const QString & sResource, const qint64 & iMaxBytes )
+{
+    if ( forwardToNetworkThread( [ = ]() { setMaxPayloadSize( sResource, iMaxBytes ); } ) )
+    {
+        return;
+    }
+
+    /* Limits apply per resource (i.e. "players"), to both the bytes on the wire and the decompressed body. */
+    MaxPayloadSizes.insert( sResource, iMaxBytes );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void BCONNetwork::setMetricsExport( const int & iIntervalMs, const bool & bPublishTags, const QString & sPrometheusFile )
+{
+    if ( forwardToNetworkThread( [ = ]() { setMetricsExport( iIntervalMs, bPublishTags, sPrometheusFile ); } ) )
+    {
+        return;
+    }
+
+    /* Every interval the metrics are published as tags under METRICS_TAG_PREFIX and/or written out in the Prometheus
+     * text format; an interval of zero stops exporting. */
+    bMetricsTags = bPublishTags;
+    sMetricsFile = sPrometheusFile;
+
+    if ( ( 0 < iIntervalMs ) && ( ( bMetricsTags ) || ( !sMetricsFile.isEmpty() ) ) )
+    {
+        pMetricsTimer->start( iIntervalMs );
+    }
+    else
+    {
+        pMetricsTimer->stop();
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void BCONNetwork::setPushUpdates( const bool & bEnabled, const QStringList & Collections )
+{
+    if ( forwardToNetworkThread( [ = ]() { setPushUpdates( bEnabled, Collections ); } ) )
+    {
+        return;
+    }
+
+    /* Changes to the listed collections are streamed from the server and applied to the DataStore as they happen,
+     * replacing polling; every (re)connect starts with a full resync of those collections. */
+    PushCollections = Collections;
+    if ( ( bEnabled ) && ( !PushCollections.isEmpty() ) )
+    {
+        openPushChannel();
+    }
+    else
+    {
+        PushCollections.clear();
+        iPushReplica = -1;
+        pPushChannel->close();
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void BCONNetwork::setReplicas( const QStringList & Addresses, const int & iPrimary )
+{
+    if ( forwardToNetworkThread( [ = ]() { setReplicas( Addresses, iPrimary ); } ) )
+    {
+        return;
+    }
+
+    if ( Addresses.isEmpty() )
+    {
+        qDebug() << "BCONNetwork::setReplicas: At least one server address is needed.";
+        return;
+    }
+
+    /* Reads go to whichever replica has been answering fastest and writes to the primary. A replica that cannot be
+     * reached, or keeps answering with server errors, is left out for a while and its requests go elsewhere. */
+    Replicas.setReplicas( Addresses, iPrimary );
+    prewarmConnection();
+    if ( !PushCollections.isEmpty() )
+    {
+        openPushChannel();
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void BCONNetwork::setTapPrefetch( const bool & bEnabled, const int & iCacheEntries, const int & iMaxAgeMs )
+{
+    if ( forwardToNetworkThread( [ = ]() { setTapPrefetch( bEnabled, iCacheEntries, iMaxAgeMs ); } ) )
+    {
+        return;
+    }
+
+    /* Each tap fetches the player as soon as the UID is decoded, and getPlayer() joins that fetch instead of making
+     * a second one. Recently fetched players are kept for up to the maximum age and answer repeat taps without a
+     * request; writes to players, and pushed player changes, empty the cache. Zero entries disables the cache. */
+    bTapPrefetch = bEnabled;
+    iPlayerCacheEntries = qMax( 0, iCacheEntries );
+    iPlayerCacheMaxAgeMs = qMax( 0, iMaxAgeMs );
+    invalidatePlayerCache();
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+const NetworkMetrics & BCONNetwork::getMetrics() const
+{
+    return Metrics;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+MemoryStats BCONNetwork::getMemoryStats() const
+{
+    MemoryStats Stats;
+    ModelStats Model;
+
+    /* Take the snapshot on the network thread, waiting for it. */
+    if ( QThread::currentThread() != thread() )
+    {
+        QMetaObject::invokeMethod( const_cast<BCONNetwork *>( this ), [ this, &Stats ]() { Stats = getMemoryStats(); },
+                                   Qt::BlockingQueuedConnection );
+        return Stats;
+    }
+
+    Buffers.fillStats( Stats );
+    Stats.ulRepliesInFlight = static_cast<quint64>( PendingRequests.size() );
+    Stats.ulRepliesReleased = ulRepliesReleased;
+    Stats.ulRepliesOversize = ulRepliesOversize;
+    Stats.ulResidentBytes = MemoryStats::residentBytes();
+    Model = pModel->getModelStats();
+    Stats.ulModelEntries = Model.ulEntries;
+    Stats.ulModelBytes = Model.ulBytes;
+    Stats.ulModelEvicted = Model.ulEvicted + Model.ulExpired + Model.ulPruned;
+
+    return Stats;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+QVector<ReplicaStats> BCONNetwork::getReplicaStats() const
+{
+    QVector<ReplicaStats> Stats;
+
+    /* Take the snapshot on the network thread, waiting for it. */
+    if ( QThread::currentThread() != thread() )
+    {
+        QMetaObject::invokeMethod( const_cast<BCONNetwork *>( this ), [ this, &Stats ]() { Stats = getReplicaStats(); },
+                                   Qt::BlockingQueuedConnection );
+        return Stats;
+    }
+
+    return Replicas.stats();
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+CompressionStats BCONNetwork::getCompressionStats() const
+{
+    CompressionStats Stats;
+
+    /* Take the snapshot on the network thread, waiting for it. */
+    if ( QThread::currentThread() != thread() )
+    {
+        QMetaObject::invokeMethod( const_cast<BCONNetwork *>( this ), [ this, &Stats ]() { Stats = getCompressionStats(); },
+                                   Qt::BlockingQueuedConnection );
+        return Stats;
+    }
+
+    return Compression;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void BCONNetwork::prewarmConnection()
+{
+    if ( forwardToNetworkThread( [ = ]() { prewarmConnection(); } ) )
+    {
+        return;
+    }
+
+    QUrl Server;
+#ifndef QT_NO_SSL
+    QSslConfiguration SslConfiguration = QSslConfiguration::defaultConfiguration();
+
+    /* Offer h2 through ALPN when HTTP/2 is allowed, or the warmed connection is negotiated as HTTP/1.1 and the first
+     * HTTP/2 request opens a connection of its own. */
+    if ( bHttp2Allowed )
+    {
+        SslConfiguration.setAllowedNextProtocols( { QSslConfiguration::ALPNProtocolHTTP2,
+                                                    QSslConfiguration::NextProtocolHttp1_1 } );
+    }
+#endif
+
+    /* Every replica is kept warm, since any of them may be picked for the next request. */
+    for ( int i = 0; i < Replicas.count(); i++ )
+    {
+        Server = Replicas.url( i, QString() );
+        if ( Server.isValid() )
+        {
+            /* Open the connection ahead of time, including the TLS handshake when the server is secure. */
+#ifndef QT_NO_SSL
+            if ( 0 == Server.scheme().compare( "https", Qt::CaseInsensitive ) )
+            {
+                pNetworkManager->connectToHostEncrypted( Server.host(), static_cast<quint16>( Server.port( 443 ) ),
+                                                         SslConfiguration );
+            }
+            else
+#endif
+            {
+                pNetworkManager->connectToHost( Server.host(), static_cast<quint16>( Server.port( 80 ) ) );
+            }
         }
     }
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void BCONNetwork::handleJSONPayload( const QByteArray & Message )
+void BCONNetwork::handleKeepAlive()
+{
+    if ( IdleTimer.elapsed() < pKeepAliveTimer->interval() )
+    {
+        /* A request went out during the last interval, so the connection is in use and needs no refreshing. */
+        return;
+    }
+
+    if ( ( 0 >= iKeepAliveMaxIdleMs ) || ( IdleTimer.elapsed() < iKeepAliveMaxIdleMs ) )
+    {
+        /* Idle for a whole interval: re-open the connection in case the server closed it meanwhile. */
+        prewarmConnection();
+    }
+    else
+    {
+        /* Idle for too long, stop refreshing until the next request. */
+        pKeepAliveTimer->stop();
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void BCONNetwork::handleReplyData()
+{
+    QNetworkReply *pReply = qobject_cast<QNetworkReply *>( sender() );
+    QHash<QNetworkReply *, PendingRequest>::iterator Iterator = PendingRequests.find( pReply );
+
+    if ( PendingRequests.end() != Iterator )
+    {
+        /* Decode the body as it streams in rather than all at once on completion. */
+        receiveReplyData( pReply, Iterator.value() );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void BCONNetwork::handleMetricsExport()
 {
-    QJsonDocument Document = QJsonDocument::fromJson( QString( Message ).toUtf8() );
+    QSaveFile File( sMetricsFile );
 
-    if ( !Document.isNull() )
+    if ( bMetricsTags )
     {
-        QList<DataPoint> Points = JSONUnpackObject( Document.object(),
-                                                    Document.object().begin(),
-                                                    QString(),
-                                                    QDateTime::fromMSecsSinceEpoch( QDateTime::currentMSecsSinceEpoch(),
-                                                                                    Qt::UTC ) );
+        Metrics.publish( pModel, METRICS_TAG_PREFIX );
+    }
 
-        for ( const DataPoint & Point : Points )
+    /* Replace the file in one step so a scraper never reads a partial dump. */
+    if ( !sMetricsFile.isEmpty() )
+    {
+        if ( ( !File.open( QIODevice::WriteOnly | QIODevice::Text ) )
+             || ( -1 == File.write( Metrics.toPrometheus().toUtf8() ) )
+             || ( !File.commit() ) )
         {
-            DataStore::publish( Point );
+            qDebug() << "LibBCONNetwork::handleMetricsExport failed to write" << sMetricsFile;
         }
     }
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-QList<DataPoint> BCONNetwork::JSONUnpackObject( const QJsonObject & ParentObject,
-                                                const QJsonObject::const_iterator & ParentIterator,
-                                                const QString & sParentKey,
-                                                const QDateTime & Timestamp )
+void BCONNetwork::handlePushConnected()
+{
+    /* Anything may have changed while the stream was down. */
+    for ( const QString & sCollection : PushCollections )
+    {
+        resyncCollection( sCollection );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void BCONNetwork::handlePushDisconnected()
 {
-    QJsonObject::const_iterator Iterator;
+    /* The channel retries on its own; only move it when its replica has been taken out of rotation. */
+    if ( ( !PushCollections.isEmpty() ) && ( 1 < Replicas.count() ) && ( !Replicas.isAvailable( iPushReplica ) ) )
+    {
+        QMetaObject::invokeMethod( this, [ this ]() { openPushChannel(); }, Qt::QueuedConnection );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void BCONNetwork::handlePushEvent( const QString & sEvent, const QByteArray & Data )
+{
+    const QJsonObject Change = QJsonDocument::fromJson( Data ).object();
+    const QString sCollection = Change.value( "collection" ).toString();
+    const QString sOperation = Change.value( "operation" ).toString();
+    const QString sId = Change.value( "id" ).toString();
+    const int iIndex = Change.value( "index" ).toInt( -1 );
+    const QString sSingular = Change.value( "singular" ).toString();
+    const QJsonObject Entity = Change.value( sSingular ).toObject();
+    const bool bCreate = ( "create" == sOperation );
+    QDateTime Timestamp = QDateTime::fromMSecsSinceEpoch( QDateTime::currentMSecsSinceEpoch(), Qt::UTC );
     QList<DataPoint> Points;
-    QString sFlattenedKey = sParentKey;
+    QList<DataPoint> SingularPoints;
+    QString sIdField;
+    DataStore * const pStore = pModel;
 
-    if ( !sParentKey.isEmpty() )
+    if ( ( "change" != sEvent ) || ( !PushCollections.contains( sCollection ) ) )
     {
-        sFlattenedKey.append( "." );
-        Points.append( DataPoint( sFlattenedKey + "^", QVariant(), Timestamp ) );
+        return;
     }
 
-    /* Process the document. */
-    for ( Iterator = ParentIterator; Iterator != ParentObject.end(); ++Iterator )
+    if ( "players" == sCollection )
     {
-        Points.append( JSONValueToDataPoint( Iterator.value(), sFlattenedKey + Iterator.key(), Timestamp ) );
+        invalidatePlayerCache();
     }
 
-    if ( !sParentKey.isEmpty() )
+    if ( ( "delete" == sOperation ) || ( 0 > iIndex ) )
     {
-        Points.append( DataPoint( sFlattenedKey + "$", QVariant(), Timestamp ) );
+        /* Removing an element renumbers everything after it, so fetch the collection again. */
+        resyncCollection( sCollection );
+        return;
     }
 
-    return Points;
+    /* Replace the element in place, i.e. players.12.* for the 13th player. */
+    Points = JSONFlattener::JSONValueToDataPoint( Entity, sCollection + "." + QString::number( iIndex ), Timestamp );
+
+    /* The single-entity tags (i.e. player.*) are refreshed too if they currently hold this entity, found by the field
+     * carrying its id (i.e. player.playerId). */
+    for ( QJsonObject::const_iterator Iterator = Entity.begin(); Iterator != Entity.end(); ++Iterator )
+    {
+        if ( Iterator.value().toString() == sId )
+        {
+            sIdField = sSingular + "." + Iterator.key();
+            SingularPoints = JSONFlattener::JSONValueToDataPoint( Entity, sSingular, Timestamp );
+            break;
+        }
+    }
+
+    /* Both decisions read the model, which only its own thread may do, so they are made there. A creation beyond the
+     * end extends the collection like a reply would, between its markers; one within it leaves the length alone. */
+    QMetaObject::invokeMethod( pStore, [ pStore, sCollection, sId, sIdField, iIndex, bCreate, Points, SingularPoints,
+                                         Timestamp ]()
+    {
+        QList<DataPoint> Update;
+        const bool bExtends = ( bCreate ) && ( iIndex >= pStore->value( sCollection + ".length" ).Value.toInt() );
+
+        if ( bExtends )
+        {
+            Update.append( DataPoint( sCollection + ".^", QVariant(), Timestamp ) );
+        }
+        Update.append( Points );
+        if ( bExtends )
+        {
+            Update.append( DataPoint( sCollection + ".length", QVariant( iIndex + 1 ), Timestamp ) );
+            Update.append( DataPoint( sCollection + ".$", QVariant(), Timestamp ) );
+        }
+
+        if ( ( !sIdField.isEmpty() ) && ( pStore->value( sIdField ).Value.toString() == sId ) )
+        {
+            Update.append( SingularPoints );
+        }
+
+        pStore->insertBatch( Update );
+    }, Qt::AutoConnection );
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-QList<DataPoint> BCONNetwork::JSONValueToDataPoint( const QJsonValue & Value,
-                                                    const QString & sKey,
-                                                    const QDateTime & Timestamp )
+void BCONNetwork::handleCardDecoded( const QString & sReader, const QString & sId, const qint64 & iChangeNs )
 {
-    DataPoint Data;
-    QList<DataPoint> Points;
+    Q_UNUSED( sReader )
+
+    if ( !bTapPrefetch )
+    {
+        return;
+    }
+
+    /* A repeat tap is answered from the cache right away, otherwise the fetch starts before the application has even
+     * been told about the card. */
+    if ( publishCachedPlayer( sId ) )
+    {
+        Metrics.recordTap( Tracer::now() - iChangeNs, true );
+    }
+    else
+    {
+        fetchPlayer( sId, iChangeNs );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void BCONNetwork::shutdownWorker()
+{
+    /* Runs on the worker thread: timers and the network manager must be stopped and deleted by the thread they live
+     * on. Decoders of outstanding replies are deleted by the destructor. */
+    pKeepAliveTimer->stop();
+    pMetricsTimer->stop();
+    pPushChannel->close();
+    delete pNetworkManager;
+    pNetworkManager = nullptr;
+
+    moveToThread( pOwnerThread );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void BCONNetwork::receiveReplyData( QNetworkReply * pReply, PendingRequest & Pending )
+{
+    qint64 iAvailable = pReply->bytesAvailable();
+    qint64 iRead = 0;
+    int iOffset = 0;
+    QByteArray Encoding;
+    QVariant ContentLength;
+    QElapsedTimer DecodeTimer;
+
+    /* Check the encoding and the advertised size once the headers are available. */
+    if ( !Pending.bEncodingKnown )
+    {
+        Pending.bEncodingKnown = true;
+        Encoding = pReply->rawHeader( "Content-Encoding" ).trimmed().toLower();
+
+        if ( ( "gzip" == Encoding ) || ( "deflate" == Encoding ) )
+        {
+            Pending.pDecoder = new StreamDecoder();
+            Compression.ulResponses++;
+        }
+
+        ContentLength = pReply->header( QNetworkRequest::ContentLengthHeader );
+        if ( ( ContentLength.isValid() ) && ( Pending.iMaxPayload < ContentLength.toLongLong() ) )
+        {
+            rejectOversizeReply( pReply, Pending );
+        }
+    }
+
+    if ( ( 0 >= iAvailable ) || ( Pending.bOversize ) )
+    {
+        return;
+    }
+
+    if ( 0 > Pending.Timing.iFirstByteNs )
+    {
+        Pending.Timing.iFirstByteNs = Pending.Elapsed.nsecsElapsed();
+    }
+
+    Pending.iWireBytes += iAvailable;
+    if ( Pending.iMaxPayload < Pending.iWireBytes )
+    {
+        rejectOversizeReply( pReply, Pending );
+        return;
+    }
+
+    if ( nullptr != Pending.pDecoder )
+    {
+        /* Read the compressed chunk into the shared scratch buffer and inflate straight into the body. */
+        ReceiveScratch.resize( static_cast<int>( iAvailable ) );
+        iRead = pReply->read( ReceiveScratch.data(), iAvailable );
+        ReceiveScratch.resize( static_cast<int>( qMax( Q_INT64_C( 0 ), iRead ) ) );
+
+        DecodeTimer.start();
+        if ( !Pending.pDecoder->decode( ReceiveScratch, Pending.Body ) )
+        {
+            qDebug() << "LibBCONNetwork::receiveReplyData failed to decompress the reply from" << pReply->url();
+        }
+        Compression.ulResponseDecodeNs += static_cast<quint64>( DecodeTimer.nsecsElapsed() );
+        Compression.ulResponseWireBytes += static_cast<quint64>( ReceiveScratch.size() );
+
+        /* Guard against bodies that inflate far beyond their wire size. */
+        if ( Pending.iMaxPayload < Pending.Body.size() )
+        {
+            rejectOversizeReply( pReply, Pending );
+        }
+    }
+    else
+    {
+        /* Read directly into the pooled body buffer. */
+        iOffset = Pending.Body.size();
+        Pending.Body.resize( iOffset + static_cast<int>( iAvailable ) );
+        iRead = pReply->read( Pending.Body.data() + iOffset, iAvailable );
+        Pending.Body.resize( iOffset + static_cast<int>( qMax( Q_INT64_C( 0 ), iRead ) ) );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void BCONNetwork::rejectOversizeReply( QNetworkReply * pReply, PendingRequest & Pending )
+{
+    qDebug() << "LibBCONNetwork::rejectOversizeReply reply exceeds" << Pending.iMaxPayload << "bytes for" << pReply->url();
+
+    Pending.bOversize = true;
+    Pending.Body.resize( 0 );
+    ulRepliesOversize++;
+
+    /* Aborting emits finished() immediately, so defer it until the current read has unwound. */
+    QMetaObject::invokeMethod( pReply, "abort", Qt::QueuedConnection );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void BCONNetwork::handleNetworkReply( QNetworkReply *pReply )
+{
+    /* Only requests made through sendRequest() are handled here; the push channel handles its own stream. Anything
+     * else (i.e. the replies of connectToHost() when pre-warming) is released. */
+    if ( !PendingRequests.contains( pReply ) )
+    {
+        if ( ( nullptr == pPushChannel ) || ( !pPushChannel->owns( pReply ) ) )
+        {
+            pReply->deleteLater();
+        }
+        return;
+    }
 
-    Data.sTag = sKey;
-    Data.Timestamp = Timestamp.isValid() ?
-                Timestamp : QDateTime::fromMSecsSinceEpoch( QDateTime::currentMSecsSinceEpoch(), Qt::UTC );
+    PendingRequest Pending = PendingRequests.take( pReply );
+    QList<DataPoint> PlayerPoints;
+    qint64 iTapNs = 0;
+    bool bCardRecord = false;
+    QByteArray Upload;
+    qint64 iFinishedNs = 0;
+    int iStatusCode = 0;
+    bool bUnreachable = false;
+    CorrelationScope Trace( Pending.ulTraceId );
+    TraceSpan Span( "handleNetworkReply", "network" );
+
+    /* The round trip overlaps other requests, so it is recorded as an async span. */
+    if ( ( Tracer::isEnabled() ) && ( 0 != Pending.iTraceStartNs ) )
+    {
+        Tracer::record( "httpRequest", "network", Pending.iTraceStartNs, Tracer::now(), Pending.ulTraceId,
+                        pReply->url().path(), true );
+    }
 
-    /* Examine the value type to determine what to do next. */
-    switch ( Value.type() )
+    /* Drain anything that arrived after the last read. */
+    receiveReplyData( pReply, Pending );
+    iFinishedNs = Pending.Elapsed.nsecsElapsed();
+    iStatusCode = pReply->attribute( QNetworkRequest::HttpStatusCodeAttribute ).toInt();
+    if ( nullptr != Pending.pDecoder )
     {
-    case QJsonValue::Array:
-        Points.append( DataPoint( sKey + ".^", QVariant(), Timestamp ) );
-        for ( int i = 0; i < Value.toArray().size(); i++ )
+        Compression.ulResponseDecodedBytes += static_cast<quint64>( Pending.Body.size() );
+        if ( !Pending.pDecoder->isValid() )
         {
-            Points.append( JSONValueToDataPoint( Value.toArray()[ i ], sKey + "." + QString::number( i ), Timestamp ) );
+            /* Corrupt or truncated. */
+            Pending.Body.resize( 0 );
         }
-        Points.append( DataPoint( sKey + ".length", QVariant( Value.toArray().size() ), Timestamp ) );
-        Points.append( DataPoint( sKey + ".$", QVariant(), Timestamp ) );
-        break;
+        delete Pending.pDecoder;
+        Pending.pDecoder = nullptr;
+    }
 
-    case QJsonValue::Bool:
-        Data.Value = QVariant( Value.toBool() );
-        break;
+    /* Score the replica on its time to first byte. Failures to connect take it out of rotation at once, server errors
+     * only after several in a row; a cancelled request says nothing about the replica. */
+    bUnreachable = ( QNetworkReply::NoError != pReply->error() )
+            && ( QNetworkReply::OperationCanceledError != pReply->error() )
+            && ( QNetworkReply::ProxyConnectionRefusedError > pReply->error() );
+    if ( ( bUnreachable ) || ( 500 <= iStatusCode ) )
+    {
+        Replicas.recordFailure( Pending.iReplica, bUnreachable );
+    }
+    else if ( QNetworkReply::OperationCanceledError != pReply->error() )
+    {
+        Replicas.recordSuccess( Pending.iReplica,
+                                ( ( 0 < Pending.Timing.iFirstByteNs ) ? Pending.Timing.iFirstByteNs : iFinishedNs )
+                                - Pending.iAttemptStartNs );
+    }
 
-    case QJsonValue::Double:
-        /* Check if this is really an integer. */
-        if ( qFuzzyCompare( Value.toDouble(), qFloor( Value.toDouble() ) ) )
+    /* A read that never reached its replica is sent once more to another one; the caller only sees the outcome of
+     * that second attempt. Writes are not repeated, as the server may already have applied them. */
+    if ( ( bUnreachable )
+         && ( 0 == Pending.iAttempt )
+         && ( QNetworkAccessManager::GetOperation == endpointSpec( Pending.eEndpoint ).eOperation )
+         && ( retryRequest( Pending ) ) )
+    {
+        Buffers.release( Pending.Body );
+        pReply->deleteLater();
+        ulRepliesReleased++;
+        return;
+    }
+
+    if ( !Pending.sCollection.isEmpty() )
+    {
+        /* Pages are renumbered into the collection as they arrive. */
+        int iReceived = PAGE_FAILED;
+        QByteArray FirstElement;
+
+        if ( ( QNetworkReply::NoError == pReply->error() ) && ( !Pending.bOversize ) )
         {
-            Data.Value = QVariant( Value.toInt() );
+            handlePagePayload( pModel, Pending.Body, Pending,
+                               Pending.bAutoPage ? Pagers[ Pending.sCollection ].FirstElement : FirstElement,
+                               iReceived, &Pending.Timing );
         }
         else
         {
-            Data.Value = QVariant( Value.toDouble() );
+            qDebug() << "LibBCONNetwork::handleNetworkReply received error" << pReply->error() << "for" << pReply->url();
+        }
+
+        finishPage( Pending, iReceived );
+    }
+    else if ( Pending.bOversize )
+    {
+        /* Already reported when the limit was hit. */
+    }
+    else if ( QNetworkReply::NoError == pReply->error() )
+    {
+        /* Process the request, keeping a copy of player data points for the tap cache or the player's card. */
+        bCardRecord = ( Endpoint::PublishPlayerStats == Pending.eEndpoint ) && ( pNFCManager->cardRecordsEnabled() );
+        JSONFlattener::handleJSONPayload( pModel, Pending.Body,
+                           &Pending.Timing,
+                           ( ( !Pending.sPlayerId.isEmpty() ) || ( bCardRecord ) ) ? &PlayerPoints : nullptr );
+    }
+    else
+    {
+        /* Check the HTTP status code. */
+        switch ( iStatusCode )
+        {
+        case 400:
+        case 500:
+            /* Attempt to parse out the error detail. */
+            JSONFlattener::handleJSONPayload( pModel, Pending.Body, &Pending.Timing );
+            break;
+
+        default:
+            qDebug() << "LibBCONNetwork::handleNetworkReply received error" << pReply->error() << "for" << pReply->url();
+            break;
+        }
+    }
+
+    /* Finish a player fetch shared by taps and getPlayer(), unless players were written to in the meantime. */
+    if ( !Pending.sPlayerId.isEmpty() )
+    {
+        iTapNs = PlayersInFlight.take( Pending.sPlayerId );
+        if ( ( !PlayerPoints.isEmpty() ) && ( ulPlayerCacheGeneration == Pending.ulCacheGeneration ) )
+        {
+            cachePlayer( Pending.sPlayerId, PlayerPoints );
+        }
+        if ( 0 != iTapNs )
+        {
+            Metrics.recordTap( Tracer::now() - iTapNs, false );
         }
-        break;
+    }
+    else if ( ( Endpoint::Count != Pending.eEndpoint )
+              && ( QNetworkAccessManager::GetOperation != endpointSpec( Pending.eEndpoint ).eOperation )
+              && ( ( "players" == Pending.sResource ) || ( Endpoint::RedeemPrize == Pending.eEndpoint ) ) )
+    {
+        invalidatePlayerCache();
+    }
+
+    /* Bring the copy of the player kept on their card up to date with the new totals. */
+    if ( bCardRecord )
+    {
+        refreshCardRecord( PlayerPoints );
+    }
+
+    /* Report the time from the request being made to its data having been published. */
+    if ( Endpoint::Count != Pending.eEndpoint )
+    {
+        Metrics.recordReply( Pending.eEndpoint,
+                             Pending.Timing,
+                             iFinishedNs,
+                             iStatusCode,
+                             ( QNetworkReply::NoError != pReply->error() ) || ( Pending.bOversize ),
+                             Pending.iWireBytes );
+        emit requestFinished( QString::fromLatin1( endpointSpec( Pending.eEndpoint ).pcName ),
+                              iStatusCode,
+                              Pending.Elapsed.nsecsElapsed() );
+    }
+
+    /* Return the buffers to the pool and hand the reply back to Qt once control returns to the event loop. */
+    if ( nullptr != Pending.pUpload )
+    {
+        Upload.swap( Pending.pUpload->buffer() );
+        Buffers.release( Upload );
+    }
+    Buffers.release( Pending.Body );
+    pReply->deleteLater();
+    ulRepliesReleased++;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void BCONNetwork::handlePagePayload( DataStore * pStore,
+                                     const QByteArray & Payload,
+                                     const PendingRequest & Pending,
+                                     QByteArray & FirstElement,
+                                     int & iReceived,
+                                     RequestTiming * pTiming )
+{
+    QElapsedTimer StageTimer;
+    QJsonDocument Document;
+    QJsonArray Page;
+    QByteArray PageFirst;
+    QDateTime Timestamp = QDateTime::fromMSecsSinceEpoch( QDateTime::currentMSecsSinceEpoch(), Qt::UTC );
+    QList<DataPoint> Points;
+    bool bWhole = false;
+    int iFirst = 0;
+    TraceSpan Span( "handlePagePayload", "parse" );
+
+    StageTimer.start();
+    Document = QJsonDocument::fromJson( Payload );
+    Page = Document.object().value( Pending.sCollection ).toArray();
+
+    if ( Document.isNull() )
+    {
+        /* Unusable reply, treat the page as failed. */
+        iReceived = PAGE_FAILED;
+        return;
+    }
 
-    case QJsonValue::Object:
-        /* Go deeper to break down the object. */
-        Points.append( JSONUnpackObject( Value.toObject(), Value.toObject().begin(), sKey, Timestamp ) );
-        break;
+    /* A reply longer than its limit comes from a server that ignored the paging parameters and sent the whole
+     * collection, which is numbered from the start like the reply to a request for the whole collection. The caller
+     * tells it apart from a page by the count being over the limit. */
+    bWhole = ( Pending.bWhole ) || ( Pending.iPageLimit < Page.size() );
+    iFirst = bWhole ? 0 : Pending.iPageOffset;
+
+    /* A server that honours the limit but not the offset sends the first page over and over. The first page is always
+     * handled before any other is requested, so later pages are compared with it. */
+    if ( ( !bWhole ) && ( !Page.isEmpty() ) )
+    {
+        PageFirst = QJsonDocument( QJsonArray { Page.first() } ).toJson( QJsonDocument::Compact );
+    }
 
-    case QJsonValue::String:
-        Data.Value = QVariant( Value.toString() );
-        break;
+    if ( bWhole )
+    {
+        /* Nothing to compare. */
+    }
+    else if ( 0 == Pending.iPageOffset )
+    {
+        FirstElement = PageFirst;
+    }
+    else if ( ( !PageFirst.isEmpty() ) && ( PageFirst == FirstElement ) )
+    {
+        iReceived = PAGE_REPEATED;
+        return;
+    }
 
-    default:
-        /* Undefined type, ignore. */
-        break;
+    /* Number each element by its position in the whole collection rather than within the page. The markers opening
+     * and closing the collection are left to finishPage(), which knows whether this is its first or last part. */
+    for ( int i = 0; i < Page.size(); i++ )
+    {
+        Points.append( JSONFlattener::JSONValueToDataPoint( Page[ i ],
+                                                            Pending.sCollection + "." + QString::number( iFirst + i ),
+                                                            Timestamp ) );
     }
 
-    if ( ( !Value.isArray() ) && ( !Value.isObject() ) )
+    if ( nullptr != pTiming )
     {
-        Points.append( Data );
+        pTiming->iParseNs = StageTimer.nsecsElapsed();
+        StageTimer.start();
     }
 
-    return Points;
+    pStore->insertBatch( Points );
+
+    if ( nullptr != pTiming )
+    {
+        pTiming->iPublishNs = StageTimer.nsecsElapsed();
+    }
+
+    iReceived = Page.size();
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void BCONNetwork::sendRequest( const QUrl & Destination,
-                               const QNetworkAccessManager::Operation & eRequestType,
-                               const QJsonObject & Body )
+bool BCONNetwork::retryRequest( const PendingRequest & Failed )
 {
+    QNetworkReply *pReply = nullptr;
+
+    pReply = sendRequest( endpointSpec( Failed.eEndpoint ), Failed.sPath, QByteArray(), Failed.Query, Failed.iReplica );
+    if ( nullptr == pReply )
+    {
+        return false;
+    }
+
+    qDebug() << "BCONNetwork::retryRequest: Retrying" << Failed.sPath << "on" << pReply->url().authority();
+    Replicas.recordFailover( Failed.iReplica );
+
+    /* The retry carries on the original request, including its timing, paging and player fetch. */
+    PendingRequest & Pending = PendingRequests[ pReply ];
+    Pending.sCollection = Failed.sCollection;
+    Pending.iPageOffset = Failed.iPageOffset;
+    Pending.iPageLimit = Failed.iPageLimit;
+    Pending.bAutoPage = Failed.bAutoPage;
+    Pending.bWhole = Failed.bWhole;
+    Pending.sPlayerId = Failed.sPlayerId;
+    Pending.ulCacheGeneration = Failed.ulCacheGeneration;
+    Pending.iAttempt = Failed.iAttempt + 1;
+    Pending.Elapsed = Failed.Elapsed;
+    Pending.iAttemptStartNs = Failed.Elapsed.nsecsElapsed();
+    Pending.Timing.iHandedOffNs = Pending.iAttemptStartNs;
+
+    return true;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+QNetworkReply * BCONNetwork::sendRequest( const EndpointSpec & Spec,
+                                          const QString & sPath,
+                                          QByteArray Body,
+                                          const QUrlQuery & Query,
+                                          const int & iExclude )
+{
+    const QNetworkAccessManager::Operation eRequestType = Spec.eOperation;
+    const int iReplica = Replicas.select( QNetworkAccessManager::GetOperation == eRequestType, iExclude );
+    QUrl Destination = Replicas.url( iReplica, sPath );
     QByteArray Data;
+    QByteArray Compressed;
+    QElapsedTimer EncodeTimer;
     QNetworkRequest Request;
+    QNetworkReply *pReply = nullptr;
+    QBuffer *pUpload = nullptr;
+    PendingRequest Pending;
+    CorrelationScope Trace( Tracer::continueCorrelation() );
+    TraceSpan Span( "sendRequest", "network" );
+
+    Pending.Elapsed.start();
+    if ( !Query.isEmpty() )
+    {
+        Destination.setQuery( Query );
+    }
 
     /* Ensure the URL is valid. */
     if ( Destination.isValid() )
     {
+        /* Any activity resets the idle window and resumes keep-alive if it had lapsed. */
+        IdleTimer.restart();
+        if ( ( 0 < pKeepAliveTimer->interval() ) && ( !pKeepAliveTimer->isActive() ) )
+        {
+            pKeepAliveTimer->start();
+        }
+
         /* Set common request properties. */
         Request.setUrl( Destination );
         Request.setRawHeader( "User-Agent", "BCON Network" );
         Request.setRawHeader( "X-Custom-User-Agent", "BCON Network" );
+        Request.setAttribute( QNetworkRequest::HTTP2AllowedAttribute, bHttp2Allowed );
+
+        /* Advertise compression explicitly so the reply is decoded here as it streams in. */
+        Request.setRawHeader( "Accept-Encoding", "gzip, deflate" );
 
         if ( !Body.isEmpty() )
         {
-            /* Convert the body to a byte array. */
-            Data = QJsonDocument( Body ).toJson( QJsonDocument::Compact );
+            /* The body arrives already serialized into a pooled buffer. */
+            Data.swap( Body );
 
             /* Add the additional headers. */
             Request.setHeader( QNetworkRequest::ContentTypeHeader, "application/json" );
+
+            /* Compress large bodies, keeping the original if compression does not help. */
+            if ( ( 0 < iCompressionThreshold ) && ( iCompressionThreshold <= Data.size() ) )
+            {
+                EncodeTimer.start();
+                Compressed = Buffers.acquire();
+                if ( ( StreamDecoder::gzipCompress( Data, Compressed ) ) && ( Compressed.size() < Data.size() ) )
+                {
+                    Compression.ulRequests++;
+                    Compression.ulRequestRawBytes += static_cast<quint64>( Data.size() );
+                    Compression.ulRequestWireBytes += static_cast<quint64>( Compressed.size() );
+                    Compression.ulRequestEncodeNs += static_cast<quint64>( EncodeTimer.nsecsElapsed() );
+                    Request.setRawHeader( "Content-Encoding", "gzip" );
+                    Data.swap( Compressed );
+                }
+                Buffers.release( Compressed );
+            }
+        }
+
+        if ( ( QNetworkAccessManager::PostOperation == eRequestType )
+             || ( QNetworkAccessManager::PutOperation == eRequestType ) )
+        {
+            /* Upload from a device over the pooled buffer so the body is not copied or shared with the reply. */
+            pUpload = new QBuffer();
+            pUpload->buffer().swap( Data );
+            pUpload->open( QIODevice::ReadOnly );
+            Request.setHeader( QNetworkRequest::ContentLengthHeader, pUpload->size() );
+        }
+        else if ( !Data.isNull() )
+        {
+            Buffers.release( Data );
+        }
+        else if ( !Body.isNull() )
+        {
+            Buffers.release( Body );
         }
 
         /* Examine the request type. */
         switch ( eRequestType )
         {
         case QNetworkAccessManager::GetOperation:
-            pNetworkManager->get( Request );
+            pReply = pNetworkManager->get( Request );
             break;
 
         case QNetworkAccessManager::PostOperation:
-            pNetworkManager->post( Request, Data );
+            pReply = pNetworkManager->post( Request, pUpload );
             break;
 
         case QNetworkAccessManager::PutOperation:
-            pNetworkManager->put( Request, Data );
+            pReply = pNetworkManager->put( Request, pUpload );
             break;
 
         case QNetworkAccessManager::DeleteOperation:
-            pNetworkManager->deleteResource( Request );
+            pReply = pNetworkManager->deleteResource( Request );
             break;
 
         default:
             /* Unsupported request. */
             break;
         }
+
+        if ( nullptr != pReply )
+        {
+            /* The upload device goes away with the reply; its buffer is reclaimed when the reply finishes. */
+            if ( nullptr != pUpload )
+            {
+                pUpload->setParent( pReply );
+            }
+
+            Pending.Timing.iHandedOffNs = Pending.Elapsed.nsecsElapsed();
+            Pending.ulTraceId = Tracer::currentCorrelation();
+            Pending.iTraceStartNs = Tracer::isEnabled() ? Tracer::now() : 0;
+            if ( 0 > iExclude )
+            {
+                /* A retry is the same request as far as the metrics are concerned. */
+                Metrics.recordRequest( Spec.eId, ( nullptr != pUpload ) ? pUpload->size() : 0 );
+            }
+
+            Pending.Body = Buffers.acquire();
+            Pending.pUpload = pUpload;
+            Pending.eEndpoint = Spec.eId;
+            Pending.sResource = sPath.section( '/', 1, 1 );
+            Pending.sPath = sPath;
+            Pending.Query = Query;
+            Pending.iReplica = iReplica;
+            Pending.iMaxPayload = MaxPayloadSizes.value( Pending.sResource, MAX_PAYLOAD_BYTES );
+            PendingRequests.insert( pReply, Pending );
+            connect( pReply, SIGNAL( readyRead() ), this, SLOT( handleReplyData() ) );
+        }
+        else if ( nullptr != pUpload )
+        {
+            Data.swap( pUpload->buffer() );
+            Buffers.release( Data );
+            delete pUpload;
+        }
     }
     else
     {
         /* Invalid URL. */
     }
+
+    return pReply;
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void BCONNetwork::createGame( const QString & sName, const int & iTokenCost )
+void BCONNetwork::getAllPaged( const Endpoint & eEndpoint )
 {
-    /* Populate the body with the passed data. */
-    QJsonObject Body
-    {
-        { "name", sName },
-        { "tokenCost", iTokenCost }
-    };
+    const QString sCollection = QString::fromLatin1( endpointSpec( eEndpoint ).pcRoute ).mid( 1 );
+    PagingState & Pager = Pagers[ sCollection ];
 
-    sendRequest( QUrl( sServerAddress + "/games/create" ), QNetworkAccessManager::PostOperation, Body );
+    if ( !Pager.bActive )
+    {
+        /* Open the collection and fill the pipeline; each full page that completes requests the next one. */
+        Pager.bActive = true;
+        Pager.iNextOffset = 0;
+        Pager.iInFlight = 0;
+        Pager.iEnd = -1;
+        Pager.iPublished = 0;
+        Pager.iPages = 0;
+        Pager.bUnpaged = false;
+        Pager.FirstElement.clear();
+        pModel->insert( DataPoint( sCollection + ".^", QVariant() ) );
+
+        /* The first page goes out alone: it tells whether there is more than one page and whether the server pages at
+         * all. Once it is in, the pipeline is filled. */
+        Pager.iInFlight++;
+        Pager.iPages++;
+        requestPage( eEndpoint, Pager.iNextOffset, iPageSize, true );
+        Pager.iNextOffset += iPageSize;
+    }
+    else
+    {
+        /* Already being fetched. */
+    }
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void BCONNetwork::getGame( const QString & sId )
+void BCONNetwork::resyncCollection( const QString & sCollection )
 {
-    sendRequest( QUrl( sServerAddress + "/games/" + sId ), QNetworkAccessManager::GetOperation );
+    if ( "games" == sCollection )
+    {
+        getAllGames();
+    }
+    else if ( "players" == sCollection )
+    {
+        getAllPlayers();
+    }
+    else if ( "prizes" == sCollection )
+    {
+        getAllPrizes();
+    }
+    else
+    {
+        qDebug() << "LibBCONNetwork::resyncCollection unknown collection" << sCollection;
+    }
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void BCONNetwork::getAllGames()
+bool BCONNetwork::publishCachedPlayer( const QString & sId )
 {
-    sendRequest( QUrl( sServerAddress + "/games" ), QNetworkAccessManager::GetOperation );
-}
-/*--------------------------------------------------------------------------------------------------------------------*/
+    QHash<QString, CachedPlayer>::iterator Iterator = PlayerCache.find( sId );
 
-void BCONNetwork::updateGameName( const QString & sId, const QString sNewName )
-{
-    QJsonObject Body
+    if ( PlayerCache.end() == Iterator )
     {
-        { "name", sNewName }
-    };
-
-    sendRequest( QUrl( sServerAddress + "/games/" + sId + "/update" ), QNetworkAccessManager::PutOperation, Body );
-}
-/*--------------------------------------------------------------------------------------------------------------------*/
+        return false;
+    }
 
-void BCONNetwork::updateGameTokenCost( const QString & sId, const int & iNewTokenCost )
-{
-    QJsonObject Body
+    if ( Iterator->Age.hasExpired( iPlayerCacheMaxAgeMs ) )
     {
-        { "tokenCost", iNewTokenCost }
-    };
+        PlayerCache.erase( Iterator );
+        PlayerCacheOrder.removeOne( sId );
+        return false;
+    }
 
-    sendRequest( QUrl( sServerAddress + "/games/" + sId + "/update" ), QNetworkAccessManager::PutOperation, Body );
+    /* Republish the player as last fetched and mark it as the most recently used. */
+    pModel->insertBatch( Iterator->Points );
+    PlayerCacheOrder.removeOne( sId );
+    PlayerCacheOrder.append( sId );
+
+    return true;
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void BCONNetwork::updateGameTopPlayer( const QString & sId, const QString & sPlayerId )
+void BCONNetwork::fetchPlayer( const QString & sId, const qint64 & iTapNs )
 {
-    QJsonObject Body
+    QHash<QString, qint64>::iterator Iterator = PlayersInFlight.find( sId );
+    QNetworkReply *pReply = nullptr;
+
+    /* Join a fetch already in flight, i.e. getPlayer() right after the tap that started it. */
+    if ( PlayersInFlight.end() != Iterator )
     {
-        { "topPlayer", sPlayerId }
-    };
+        if ( 0 == Iterator.value() )
+        {
+            Iterator.value() = iTapNs;
+        }
+        Metrics.recordCoalesced();
+        return;
+    }
 
-    sendRequest( QUrl( sServerAddress + "/games/" + sId + "/update" ), QNetworkAccessManager::PutOperation, Body );
+    pReply = request<Endpoint::GetPlayer>( sId );
+    if ( nullptr != pReply )
+    {
+        PendingRequest & Pending = PendingRequests[ pReply ];
+
+        Pending.sPlayerId = sId;
+        Pending.ulCacheGeneration = ulPlayerCacheGeneration;
+        PlayersInFlight.insert( sId, iTapNs );
+    }
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void BCONNetwork::deleteGame( const QString & sId )
+void BCONNetwork::cachePlayer( const QString & sId, const QList<DataPoint> & Points )
 {
-    sendRequest( QUrl( sServerAddress + "/games/" + sId + "/delete" ), QNetworkAccessManager::DeleteOperation );
+    CachedPlayer & Entry = PlayerCache[ sId ];
+
+    Entry.Points = Points;
+    Entry.Age.start();
+    PlayerCacheOrder.removeOne( sId );
+    PlayerCacheOrder.append( sId );
+
+    /* Evict the least recently used players beyond the limit. */
+    while ( iPlayerCacheEntries < PlayerCacheOrder.size() )
+    {
+        PlayerCache.remove( PlayerCacheOrder.takeFirst() );
+    }
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void BCONNetwork::createPlayer( const QString & sId, const QString & sFirstName, const QString & sLastName, const QString & sScreenName )
+void BCONNetwork::refreshCardRecord( const QList<DataPoint> & Points )
 {
-    QJsonObject Body
+    QVariantMap Record;
+    QString sId;
+
+    /* The reply holds the updated player (player.*); only a few of its fields fit on the card. */
+    for ( const DataPoint & Point : Points )
     {
-        { "playerId", sId },
-        { "firstName", sFirstName },
-        { "lastName", sLastName },
-        { "screenName", sScreenName }
-    };
+        if ( "player.playerId" == Point.sTag )
+        {
+            sId = Point.Value.toString();
+        }
+        else if ( ( "player.screenName" == Point.sTag ) || ( "player.tokens" == Point.sTag )
+                  || ( "player.tickets" == Point.sTag ) )
+        {
+            Record.insert( Point.sTag.mid( 7 ), Point.Value );
+        }
+    }
 
-    sendRequest( QUrl( sServerAddress + "/players/create" ), QNetworkAccessManager::PostOperation, Body );
+    if ( ( !sId.isEmpty() ) && ( !Record.isEmpty() ) )
+    {
+        pNFCManager->writeCardRecord( sId, Record );
+    }
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void BCONNetwork::getPlayer( const QString & sId )
+void BCONNetwork::invalidatePlayerCache()
 {
-    sendRequest( QUrl( sServerAddress + "/players/" + sId ), QNetworkAccessManager::GetOperation );
+    /* Fetches still in flight started before the change, so they are not cached either. */
+    PlayerCache.clear();
+    PlayerCacheOrder.clear();
+    ulPlayerCacheGeneration++;
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void BCONNetwork::getAllPlayers()
+void BCONNetwork::openPushChannel()
 {
-    sendRequest( QUrl( sServerAddress + "/players" ), QNetworkAccessManager::GetOperation );
+    QUrl Source;
+    QUrlQuery Query;
+
+    /* The stream is a long-lived read, so it goes to the replica reads would go to. */
+    iPushReplica = Replicas.select( true );
+    Source = Replicas.url( iPushReplica, "/events" );
+    Query.addQueryItem( "collections", PushCollections.join( ',' ) );
+    Source.setQuery( Query );
+    pPushChannel->open( Source );
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void BCONNetwork::updatePlayerId( const QString & sId, const QString & sNewId )
+void BCONNetwork::requestPage( const Endpoint & eEndpoint,
+                               const int & iOffset,
+                               const int & iLimit,
+                               const bool & bAutoPage )
 {
-    QJsonObject Body
+    /* Pages use the route of the matching whole-collection endpoint, i.e. "/players". */
+    const QString sCollection = QString::fromLatin1( endpointSpec( eEndpoint ).pcRoute ).mid( 1 );
+    QUrlQuery Query;
+    QNetworkReply *pReply = nullptr;
+    PendingRequest Page;
+
+    Query.addQueryItem( "offset", QString::number( iOffset ) );
+    Query.addQueryItem( "limit", QString::number( iLimit ) );
+
+    Page.sCollection = sCollection;
+    Page.iPageOffset = iOffset;
+    Page.iPageLimit = iLimit;
+    Page.bAutoPage = bAutoPage;
+    Page.eEndpoint = eEndpoint;
+
+    pReply = sendRequest( endpointSpec( eEndpoint ), "/" + sCollection, QByteArray(), Query );
+    if ( nullptr != pReply )
     {
-        { "playerId", sNewId }
-    };
-
-    sendRequest( QUrl( sServerAddress + "/players/" + sId + "/update" ), QNetworkAccessManager::PutOperation, Body );
-}
-/*--------------------------------------------------------------------------------------------------------------------*/
-
-void BCONNetwork::updatePlayerName( const QString & sId, const QString & sNewFirstName, const QString & sNewLastName )
-{
-    QJsonObject Body
+        PendingRequest & Pending = PendingRequests[ pReply ];
+        Pending.sCollection = Page.sCollection;
+        Pending.iPageOffset = Page.iPageOffset;
+        Pending.iPageLimit = Page.iPageLimit;
+        Pending.bAutoPage = Page.bAutoPage;
+    }
+    else
     {
-        { "firstName", sNewFirstName },
-        { "lastName", sNewLastName }
-    };
-
-    sendRequest( QUrl( sServerAddress + "/players/" + sId + "/update" ), QNetworkAccessManager::PutOperation, Body );
+        /* Nothing was sent, so release the pipeline slot. */
+        finishPage( Page, PAGE_FAILED );
+    }
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void BCONNetwork::updatePlayerScreenName( const QString & sId, const QString & sNewScreenName )
+void BCONNetwork::requestCollection( const Endpoint & eEndpoint )
 {
-    QJsonObject Body
+    const QString sCollection = QString::fromLatin1( endpointSpec( eEndpoint ).pcRoute ).mid( 1 );
+    QNetworkReply *pReply = nullptr;
+    PendingRequest Whole;
+
+    Whole.sCollection = sCollection;
+    Whole.bAutoPage = true;
+    Whole.bWhole = true;
+    Whole.eEndpoint = eEndpoint;
+
+    /* Counted with the pages, so the collection stays open until its reply has been handled. */
+    Pagers[ sCollection ].iInFlight++;
+    pReply = sendRequest( endpointSpec( eEndpoint ), "/" + sCollection );
+    if ( nullptr != pReply )
     {
-        { "screenName", sNewScreenName }
-    };
-
-    sendRequest( QUrl( sServerAddress + "/players/" + sId + "/update" ), QNetworkAccessManager::PutOperation, Body );
+        PendingRequest & Pending = PendingRequests[ pReply ];
+        Pending.sCollection = Whole.sCollection;
+        Pending.bAutoPage = Whole.bAutoPage;
+        Pending.bWhole = Whole.bWhole;
+    }
+    else
+    {
+        finishPage( Whole, PAGE_FAILED );
+    }
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void BCONNetwork::updatePlayerTokens( const QString & sId, const int & iNewTokens )
+void BCONNetwork::finishPage( const PendingRequest & Pending, const int & iReceived )
 {
-    QJsonObject Body
+    /* More elements than the limit means the server sent the whole collection, numbered from the start. */
+    const bool bWhole = ( Pending.bWhole ) || ( Pending.iPageLimit < iReceived );
+    int iEnd = -1;
+
+    if ( !Pending.bAutoPage )
     {
-        { "tokens", iNewTokens }
-    };
+        /* A single page requested by the application, which opens or closes the collection when at either end. */
+        if ( 0 <= iReceived )
+        {
+            if ( ( 0 == Pending.iPageOffset ) || ( bWhole ) )
+            {
+                pModel->insert( DataPoint( Pending.sCollection + ".^", QVariant() ) );
+            }
+
+            if ( ( Pending.iPageLimit > iReceived ) || ( bWhole ) )
+            {
+                pModel->insert( DataPoint( Pending.sCollection + ".length",
+                                           QVariant( ( bWhole ? 0 : Pending.iPageOffset ) + iReceived ) ) );
+                pModel->insert( DataPoint( Pending.sCollection + ".$", QVariant() ) );
+            }
+        }
 
-    sendRequest( QUrl( sServerAddress + "/players/" + sId + "/update" ), QNetworkAccessManager::PutOperation, Body );
-}
-/*--------------------------------------------------------------------------------------------------------------------*/
+        return;
+    }
 
-void BCONNetwork::updatePlayerTickets( const QString & sId, const int & iNewTickets )
-{
-    QJsonObject Body
-    {
-        { "tickets", iNewTickets }
-    };
+    PagingState & Pager = Pagers[ Pending.sCollection ];
+    Pager.iInFlight--;
 
-    sendRequest( QUrl( sServerAddress + "/players/" + sId + "/update" ), QNetworkAccessManager::PutOperation, Body );
-}
-/*--------------------------------------------------------------------------------------------------------------------*/
+    if ( bWhole )
+    {
+        /* The whole collection in one reply, which replaces any pages published before it; the collection was opened
+         * when the fetch began, so only its end is left to publish. */
+        Pager.bUnpaged = true;
+        Pager.iEnd = qMax( iReceived, 0 );
+        Pager.iPublished = qMax( Pager.iPublished, Pager.iEnd );
+    }
+    else if ( Pager.bUnpaged )
+    {
+        /* A page still in flight when the server turned out to ignore the paging parameters; the whole collection
+         * supersedes it. */
+        if ( 0 < iReceived )
+        {
+            Pager.iPublished = qMax( Pager.iPublished, Pending.iPageOffset + iReceived );
+        }
+    }
+    else if ( PAGE_REPEATED == iReceived )
+    {
+        /* The server ignores the offset, so fetch the whole collection in one request; pages still in flight are
+         * drained as they complete. */
+        qDebug() << "BCONNetwork::finishPage: The server ignores the offset, fetching all of" << Pending.sCollection;
+        Pager.bUnpaged = true;
+        requestCollection( Pending.eEndpoint );
+        return;
+    }
+    else if ( PAGE_FAILED == iReceived )
+    {
+        /* A failed page ends the fetch; the pages before it have already been published. */
+        iEnd = Pending.iPageOffset;
+    }
+    else
+    {
+        Pager.iPublished = qMax( Pager.iPublished, Pending.iPageOffset + iReceived );
+        if ( Pending.iPageLimit > iReceived )
+        {
+            /* A short page marks the end of the collection. */
+            iEnd = Pending.iPageOffset + iReceived;
+        }
+    }
 
-void BCONNetwork::publishPlayerStats( const QString & sId, const QString & sGameId, const int & iTicketsEarned, const int & iHighScore )
-{
-    QJsonObject Body
+    if ( Pager.bUnpaged )
+    {
+        /* No more pages, the end comes with the whole collection. */
+    }
+    else if ( 0 <= iEnd )
     {
-        { "gameId", sGameId },
-        { "ticketsEarned", iTicketsEarned },
-        { "highScore", iHighScore }
-    };
+        Pager.iEnd = ( 0 > Pager.iEnd ) ? iEnd : qMin( Pager.iEnd, iEnd );
+    }
+    else
+    {
+        fillPagePipeline( Pending.eEndpoint, Pending.iPageLimit );
+    }
 
-    sendRequest( QUrl( sServerAddress + "/players/" + sId + "/publishstats" ), QNetworkAccessManager::PostOperation, Body );
+    /* Close the collection once every outstanding page has been accounted for. Pages that completed beyond a failed
+     * one were already published and are dropped again. */
+    if ( ( 0 == Pager.iInFlight ) && ( 0 <= Pager.iEnd ) )
+    {
+        Pager.bActive = false;
+        if ( Pager.iPublished > Pager.iEnd )
+        {
+            pModel->truncate( Pending.sCollection, Pager.iEnd );
+        }
+        pModel->insert( DataPoint( Pending.sCollection + ".length", QVariant( Pager.iEnd ) ) );
+        pModel->insert( DataPoint( Pending.sCollection + ".$", QVariant() ) );
+    }
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void BCONNetwork::deletePlayer( const QString & sId )
+void BCONNetwork::fillPagePipeline( const Endpoint & eEndpoint, const int & iLimit )
 {
-    sendRequest( QUrl( sServerAddress + "/players/" + sId + "/delete" ), QNetworkAccessManager::DeleteOperation );
-}
-/*--------------------------------------------------------------------------------------------------------------------*/
+    const QString sCollection = QString::fromLatin1( endpointSpec( eEndpoint ).pcRoute ).mid( 1 );
+    PagingState & Pager = Pagers[ sCollection ];
 
-void BCONNetwork::createPrize( const QString & sName, const int & iTicketCost, const int & iAvailableQuantity )
-{
-    QJsonObject Body
+    /* Keep the pipeline full until the end is found, up to a hard limit on the pages of one collection. */
+    while ( ( 0 > Pager.iEnd ) && ( iPagesInFlight > Pager.iInFlight ) )
     {
-        { "name", sName },
-        { "ticketCost", iTicketCost },
-        { "availableQuantity", iAvailableQuantity }
-    };
+        if ( PAGE_MAX_PAGES <= Pager.iPages )
+        {
+            qDebug() << "BCONNetwork::fillPagePipeline: Stopping" << sCollection << "after" << Pager.iPages << "pages";
+            Pager.iEnd = Pager.iNextOffset;
+            break;
+        }
 
-    sendRequest( QUrl( sServerAddress + "/prizes/create" ), QNetworkAccessManager::PostOperation, Body );
+        Pager.iInFlight++;
+        Pager.iPages++;
+        requestPage( eEndpoint, Pager.iNextOffset, iLimit, true );
+        Pager.iNextOffset += iLimit;
+    }
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void BCONNetwork::getPrize( const QString & sId )
-{
-    sendRequest( QUrl( sServerAddress + "/prizes/" + sId ), QNetworkAccessManager::GetOperation );
-}
-/*--------------------------------------------------------------------------------------------------------------------*/
+#define ENDPOINT_SLOT_DEFINITION( Id, Name, Slot, Method, Route, Parameters, Arguments, Fields ) \
+    ENDPOINT_##Slot( void BCONNetwork::Name Parameters { request<Endpoint::Id> Arguments; } )
 
-void BCONNetwork::getAllPrizes()
-{
-    sendRequest( QUrl( sServerAddress + "/prizes" ), QNetworkAccessManager::GetOperation );
-}
+ENDPOINT_LIST( ENDPOINT_SLOT_DEFINITION )
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void BCONNetwork::updatePrizeName( const QString & sId, const QString & sNewName )
+void BCONNetwork::getPlayer( const QString & sId )
 {
-    QJsonObject Body
+    if ( forwardToNetworkThread( [ = ]() { getPlayer( sId ); } ) )
     {
-        { "name", sNewName }
-    };
+        return;
+    }
 
-    sendRequest( QUrl( sServerAddress + "/prizes/" + sId + "/update" ), QNetworkAccessManager::PutOperation, Body );
+    /* With tap prefetching the player is most likely on its way already, so join that fetch. The cache only answers
+     * taps: an explicit request always reads the player afresh, i.e. to see writes made by other cabinets. */
+    if ( bTapPrefetch )
+    {
+        fetchPlayer( sId, 0 );
+    }
+    else
+    {
+        request<Endpoint::GetPlayer>( sId );
+    }
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void BCONNetwork::updatePrizeDescription( const QString & sId, const QString & sNewDescription )
+void BCONNetwork::getAllPlayers()
 {
-    QJsonObject Body
+    if ( forwardToNetworkThread( [ = ]() { getAllPlayers(); } ) )
     {
-        { "description", sNewDescription }
-    };
+        return;
+    }
 
-    sendRequest( QUrl( sServerAddress + "/prizes/" + sId + "/update" ), QNetworkAccessManager::PutOperation, Body );
+    if ( 0 < iPageSize )
+    {
+        getAllPaged( Endpoint::GetAllPlayers );
+    }
+    else
+    {
+        request<Endpoint::GetAllPlayers>();
+    }
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void BCONNetwork::updatePrizeTicketCost( const QString & sId, const int & iNewTicketCost )
+void BCONNetwork::getPlayersPage( const int & iOffset, const int & iLimit )
 {
-    QJsonObject Body
+    if ( forwardToNetworkThread( [ = ]() { getPlayersPage( iOffset, iLimit ); } ) )
     {
-        { "ticketCost", iNewTicketCost }
-    };
+        return;
+    }
 
-    sendRequest( QUrl( sServerAddress + "/prizes/" + sId + "/update" ), QNetworkAccessManager::PutOperation, Body );
+    requestPage( Endpoint::GetAllPlayers, iOffset, iLimit );
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void BCONNetwork::updatePrizeAvailableQuantity( const QString & sId, const int & iNewAvailableQuantity )
+void BCONNetwork::getAllPrizes()
 {
-    QJsonObject Body
+    if ( forwardToNetworkThread( [ = ]() { getAllPrizes(); } ) )
     {
-        { "availableQuantity", iNewAvailableQuantity }
-    };
+        return;
+    }
 
-    sendRequest( QUrl( sServerAddress + "/prizes/" + sId + "/update" ), QNetworkAccessManager::PutOperation, Body );
+    if ( 0 < iPageSize )
+    {
+        getAllPaged( Endpoint::GetAllPrizes );
+    }
+    else
+    {
+        request<Endpoint::GetAllPrizes>();
+    }
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void BCONNetwork::redeemPrize( const QString & sPrizeId, const QString & sPlayerId )
+void BCONNetwork::getPrizesPage( const int & iOffset, const int & iLimit )
 {
-    QJsonObject Body
+    if ( forwardToNetworkThread( [ = ]() { getPrizesPage( iOffset, iLimit ); } ) )
     {
-        { "playerId", sPlayerId }
-    };
-
-    sendRequest( QUrl( sServerAddress + "/prizes/" + sPrizeId + "/redeem" ), QNetworkAccessManager::PostOperation, Body );
-}
-/*--------------------------------------------------------------------------------------------------------------------*/
+        return;
+    }
 
-void BCONNetwork::deletePrize( const QString & sId )
-{
-    sendRequest( QUrl( sServerAddress + "/prizes/" + sId + "/delete" ), QNetworkAccessManager::DeleteOperation );
+    requestPage( Endpoint::GetAllPrizes, iOffset, iLimit );
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
-
@@ -1,28 +1,84 @@
 #ifndef LIBBCONNETWORK_H
 #define LIBBCONNETWORK_H
 
+#include <QBuffer>
+#include <QElapsedTimer>
+#include <QHash>
 #include <QJsonObject>
 #include <QNetworkAccessManager>
 #include <QNetworkRequest>
 #include <QObject>
+#include <QStringList>
+#include <QThread>
+#include <QTimer>
+#include <QUrlQuery>
+#include <initializer_list>
 
+#include "bufferpool.h"
+#include "compression.h"
 #include "datastore.h"
+#include "endpoints.h"
+#include "metrics.h"
 #include "nfcmanager.h"
+#include "pushchannel.h"
+#include "replicaset.h"
+#include "tracer.h"
+
+#define KEEPALIVE_REFRESH_MS    4000
+#define KEEPALIVE_MAX_IDLE_MS   600000
+#define PAGE_PIPELINE_DEPTH     3
+#define PAGE_FAILED             -1
+#define PAGE_REPEATED           -3
+#define PAGE_MAX_PAGES          10000
+#define MAX_PAYLOAD_BYTES       16777216
+#define METRICS_TAG_PREFIX      "Network.Metrics"
+#define PREFETCH_CACHE_ENTRIES  32
+#define PREFETCH_MAX_AGE_MS     30000
 
 class BCONNetwork : public QObject
 {
     Q_OBJECT
 
 public:
-    BCONNetwork( const QString & sServerRootAddress = "http://localhost:3000", const bool & bUseNFC = true );
+    BCONNetwork( const QString & sServerRootAddress = "http://localhost:3000",
+                 const bool & bUseNFC = true,
+                 const bool & bPrewarm = true,
+                 const bool & bUseWorkerThread = false,
+                 DataStore * pStore = nullptr,
+                 NFCManager * pNFC = nullptr );
     ~BCONNetwork();
 
+    void setKeepAlivePolicy( const int & iRefreshIntervalMs, const int & iMaxIdleMs );
+    void setHttp2Allowed( const bool & bAllowed );
+    void setRequestCompressionThreshold( const int & iThresholdBytes );
+    void setListPaging( const int & iPageSize, const int & iPagesInFlight = PAGE_PIPELINE_DEPTH );
+    void setMaxPayloadSize( const QString & sResource, const qint64 & iMaxBytes );
+    void setMetricsExport( const int & iIntervalMs, const bool & bPublishTags = true, const QString & sPrometheusFile = QString() );
+    void setPushUpdates( const bool & bEnabled, const QStringList & Collections = QStringList { "games", "players", "prizes" } );
+    void setTapPrefetch( const bool & bEnabled, const int & iCacheEntries = PREFETCH_CACHE_ENTRIES, const int & iMaxAgeMs = PREFETCH_MAX_AGE_MS );
+    void setReplicas( const QStringList & Addresses, const int & iPrimary = 0 );
+
+    CompressionStats getCompressionStats() const;
+    MemoryStats getMemoryStats() const;
+    QVector<ReplicaStats> getReplicaStats() const;
+    const NetworkMetrics & getMetrics() const;
+
+signals:
+    void requestFinished( const QString & sEndpoint, const int & iStatusCode, const qint64 & iElapsedNs );
+
 public slots:
+    /* Connection management. */
+    void prewarmConnection();
+
+    /* Backend requests, one for each entry of ENDPOINT_LIST. Those that only forward their arguments are defined from
+     * the list, but declared here by hand since moc does not expand macros; the compiler rejects a declaration that
+     * does not match its entry. */
+
     /* Game backend requests. */
     void createGame( const QString & sName, const int & iTokenCost );
     void getGame( const QString & sId );
     void getAllGames();
-    void updateGameName( const QString & sId, const QString sNewName );
+    void updateGameName( const QString & sId, const QString & sNewName );
     void updateGameTokenCost( const QString & sId, const int & iNewTokenCost );
     void updateGameTopPlayer( const QString & sId, const QString & sPlayerId );
     void deleteGame( const QString & sId );
@@ -31,6 +87,7 @@ public slots:
     void createPlayer( const QString & sId, const QString & sFirstName, const QString & sLastName, const QString & sScreenName );
     void getPlayer( const QString & sId );
     void getAllPlayers();
+    void getPlayersPage( const int & iOffset, const int & iLimit );
     void updatePlayerId( const QString & sId, const QString & sNewId );
     void updatePlayerName( const QString & sId, const QString & sNewFirstName, const QString & sNewLastName );
     void updatePlayerScreenName( const QString & sId, const QString & sNewScreenName );
@@ -43,6 +100,7 @@ public slots:
     void createPrize( const QString & sName, const int & iTicketCost, const int & iAvailableQuantity );
     void getPrize( const QString & sId );
     void getAllPrizes();
+    void getPrizesPage( const int & iOffset, const int & iLimit );
     void updatePrizeName( const QString & sId, const QString & sNewName );
     void updatePrizeDescription( const QString & sId, const QString & sNewDescription );
     void updatePrizeTicketCost( const QString & sId, const int & iNewTicketCost );
@@ -52,18 +110,170 @@ public slots:
 
 private slots:
     void handleNetworkReply( QNetworkReply * pReply );
+    void handleKeepAlive();
+    void handleReplyData();
+    void handleMetricsExport();
+    void handlePushConnected();
+    void handlePushDisconnected();
+    void handlePushEvent( const QString & sEvent, const QByteArray & Data );
+    void handleCardDecoded( const QString & sReader, const QString & sId, const qint64 & iChangeNs );
 
 private:
+    class PendingRequest
+    {
+    public:
+        QByteArray Body;
+        QBuffer *pUpload = nullptr;
+        StreamDecoder *pDecoder = nullptr;
+        bool bEncodingKnown = false;
+        QString sResource;
+        qint64 iMaxPayload = MAX_PAYLOAD_BYTES;
+        qint64 iWireBytes = 0;
+        bool bOversize = false;
+        QString sCollection;
+        int iPageOffset = 0;
+        int iPageLimit = 0;
+        bool bAutoPage = false;
+        bool bWhole = false;                // Fetches the whole collection from a server that ignores the offset
+        Endpoint eEndpoint = Endpoint::Count;
+        QElapsedTimer Elapsed;
+        RequestTiming Timing;
+        quint64 ulTraceId = 0;
+        qint64 iTraceStartNs = 0;
+        QString sPlayerId;                  // Set on player fetches that feed the tap cache
+        quint64 ulCacheGeneration = 0;
+        QString sPath;                      // Kept with the query so a failed read can be sent to another replica
+        QUrlQuery Query;
+        int iReplica = -1;
+        int iAttempt = 0;
+        qint64 iAttemptStartNs = 0;
+    };
+
+    class CachedPlayer
+    {
+    public:
+        QList<DataPoint> Points;
+        QElapsedTimer Age;
+    };
+
+    class PagingState
+    {
+    public:
+        bool bActive = false;
+        int iNextOffset = 0;
+        int iInFlight = 0;
+        int iEnd = -1;
+        int iPublished = 0;                 // End of the elements published so far
+        int iPages = 0;
+        bool bUnpaged = false;
+        QByteArray FirstElement;            // The collection's first element, to spot a server ignoring the offset
+    };
+
     DataStore *pModel;
     NFCManager *pNFCManager;
     QNetworkAccessManager *pNetworkManager;
-    QString sServerAddress;
+    ReplicaSet Replicas;
+    int iPushReplica;
+    QTimer *pKeepAliveTimer;
+    QElapsedTimer IdleTimer;
+    int iKeepAliveMaxIdleMs;
+    bool bHttp2Allowed;
+    int iCompressionThreshold;
+    CompressionStats Compression;
+    QHash<QNetworkReply *, PendingRequest> PendingRequests;
+    QHash<QString, PagingState> Pagers;
+    QHash<QString, qint64> MaxPayloadSizes;
+    BufferPool Buffers;
+    QByteArray ReceiveScratch;
+    quint64 ulRepliesReleased;
+    quint64 ulRepliesOversize;
+    int iPageSize;
+    int iPagesInFlight;
+    NetworkMetrics Metrics;
+    QTimer *pMetricsTimer;
+    bool bMetricsTags;
+    QString sMetricsFile;
+    QThread *pWorkerThread;
+    QThread *pOwnerThread;
+    PushChannel *pPushChannel;
+    QStringList PushCollections;
+    bool bTapPrefetch;
+    int iPlayerCacheEntries;
+    int iPlayerCacheMaxAgeMs;
+    QHash<QString, CachedPlayer> PlayerCache;
+    QStringList PlayerCacheOrder;           // Least recently used first
+    QHash<QString, qint64> PlayersInFlight; // Player id to the time of the tap waiting on it, zero if none
+    quint64 ulPlayerCacheGeneration;
 
-    static void handleJSONPayload( const QByteArray & Payload );
-    static QList<DataPoint> JSONUnpackObject( const QJsonObject & ParentObject, const QJsonObject::const_iterator & ParentIterator, const QString & sParentKey, const QDateTime & Timestamp );
-    static QList<DataPoint> JSONValueToDataPoint( const QJsonValue & Value, const QString & sKey, const QDateTime & Timestamp );
+    static void handlePagePayload( DataStore * pStore, const QByteArray & Payload, const PendingRequest & Pending, QByteArray & FirstElement, int & iReceived, RequestTiming * pTiming = nullptr );
 
-    void sendRequest( const QUrl & Destination, const QNetworkAccessManager::Operation & eRequestType, const QJsonObject & Body = QJsonObject() );
+    template<typename Function>
+    bool forwardToNetworkThread( Function Call ) const;
+    void shutdownWorker();
+    void receiveReplyData( QNetworkReply * pReply, PendingRequest & Pending );
+    void rejectOversizeReply( QNetworkReply * pReply, PendingRequest & Pending );
+    template<Endpoint eEndpoint, typename... Args>
+    QNetworkReply * request( const Args &... Arguments );
+
+    void getAllPaged( const Endpoint & eEndpoint );
+    void resyncCollection( const QString & sCollection );
+    bool publishCachedPlayer( const QString & sId );
+    void fetchPlayer( const QString & sId, const qint64 & iTapNs );
+    void cachePlayer( const QString & sId, const QList<DataPoint> & Points );
+    void invalidatePlayerCache();
+    void refreshCardRecord( const QList<DataPoint> & Points );
+    void requestPage( const Endpoint & eEndpoint, const int & iOffset, const int & iLimit, const bool & bAutoPage = false );
+    void requestCollection( const Endpoint & eEndpoint );
+    void finishPage( const PendingRequest & Pending, const int & iReceived );
+    void fillPagePipeline( const Endpoint & eEndpoint, const int & iLimit );
+    void openPushChannel();
+    bool retryRequest( const PendingRequest & Failed );
+    QNetworkReply * sendRequest( const EndpointSpec & Spec,
+                                 const QString & sPath,
+                                 QByteArray Body = QByteArray(),
+                                 const QUrlQuery & Query = QUrlQuery(),
+                                 const int & iExclude = -1 );
 };
 
+template<typename Function>
+bool BCONNetwork::forwardToNetworkThread( Function Call ) const
+{
+    const quint64 ulCorrelation = Tracer::currentCorrelation();
+
+    if ( QThread::currentThread() == thread() )
+    {
+        return false;
+    }
+
+    /* Called from another thread: queue the call to the thread running the network stack, keeping any trace. */
+    QMetaObject::invokeMethod( const_cast<BCONNetwork *>( this ), [ Call, ulCorrelation ]()
+    {
+        CorrelationScope Trace( ulCorrelation );
+
+        Call();
+    }, Qt::QueuedConnection );
+
+    return true;
+}
+
+template<Endpoint eEndpoint, typename... Args>
+QNetworkReply * BCONNetwork::request( const Args &... Arguments )
+{
+    static_assert( ( endpointPathCount( eEndpoint ) + endpointFieldCount( eEndpoint ) ) == sizeof...( Args ),
+                   "Wrong number of arguments for the endpoint." );
+    static_assert( endpointArgumentsMatch<eEndpoint, Args...>( 0 ), "Argument types do not match the endpoint." );
+
+    if ( forwardToNetworkThread( [ = ]() { request<eEndpoint>( Arguments... ); } ) )
+    {
+        /* The reply is created later on the network thread. */
+        return nullptr;
+    }
+
+    /* Fill the route and serialize the body in a single pass over the arguments. */
+    EndpointWriter Writer( endpointSpec( eEndpoint ), ( 0 < endpointFieldCount( eEndpoint ) ) ? Buffers.acquire() : QByteArray() );
+    ( void )std::initializer_list<int>{ ( Writer.append( Arguments ), 0 )... };
+
+    return sendRequest( endpointSpec( eEndpoint ), Writer.takePath(), Writer.takeBody() );
+}
+
 #endif // LIBBCONNETWORK_H
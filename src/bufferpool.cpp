@@ -0,0 +1,108 @@
+#include <QFile>
+
+#ifdef __APPLE__
+#include <mach/mach.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "bufferpool.h"
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+quint64 MemoryStats::residentBytes()
+{
+    quint64 ulReturn = 0;
+
+#ifdef __APPLE__
+    mach_task_basic_info_data_t xInfo;
+    mach_msg_type_number_t uiCount = MACH_TASK_BASIC_INFO_COUNT;
+
+    if ( KERN_SUCCESS == task_info( mach_task_self(), MACH_TASK_BASIC_INFO,
+                                    reinterpret_cast<task_info_t>( &xInfo ), &uiCount ) )
+    {
+        ulReturn = static_cast<quint64>( xInfo.resident_size );
+    }
+#else
+    QFile Statm( "/proc/self/statm" );
+
+    /* The second field is the resident set size in pages. */
+    if ( Statm.open( QIODevice::ReadOnly ) )
+    {
+        QList<QByteArray> Fields = Statm.readAll().split( ' ' );
+
+        if ( 1 < Fields.size() )
+        {
+            ulReturn = Fields[ 1 ].toULongLong() * static_cast<quint64>( sysconf( _SC_PAGESIZE ) );
+        }
+    }
+#endif
+
+    return ulReturn;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+BufferPool::BufferPool( const int & iMaxBuffers, const int & iInitialBytes, const int & iMaxRetainedBytes )
+{
+    this->iMaxBuffers = iMaxBuffers;
+    this->iInitialBytes = iInitialBytes;
+    this->iMaxRetainedBytes = iMaxRetainedBytes;
+    ulHits = 0;
+    ulMisses = 0;
+    FreeBuffers.reserve( iMaxBuffers );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+QByteArray BufferPool::acquire()
+{
+    QByteArray Buffer;
+
+    if ( !FreeBuffers.isEmpty() )
+    {
+        Buffer.swap( FreeBuffers.last() );
+        FreeBuffers.removeLast();
+        ulHits++;
+    }
+    else
+    {
+        /* Reserving marks the capacity as sticky, so emptying the buffer later keeps the allocation. */
+        Buffer.reserve( iInitialBytes );
+        ulMisses++;
+    }
+
+    return Buffer;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void BufferPool::release( QByteArray & Buffer )
+{
+    /* Only keep buffers nobody else references and that have not grown beyond the retention limit. */
+    if ( ( Buffer.isDetached() )
+         && ( 0 < Buffer.capacity() )
+         && ( iMaxRetainedBytes >= Buffer.capacity() )
+         && ( iMaxBuffers > FreeBuffers.size() ) )
+    {
+        /* Mark the current capacity as reserved (without reallocating) so emptying it keeps the allocation. */
+        Buffer.reserve( Buffer.capacity() );
+        Buffer.resize( 0 );
+        FreeBuffers.append( QByteArray() );
+        FreeBuffers.last().swap( Buffer );
+    }
+    else
+    {
+        Buffer = QByteArray();
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void BufferPool::fillStats( MemoryStats & Stats ) const
+{
+    Stats.ulPoolHits = ulHits;
+    Stats.ulPoolMisses = ulMisses;
+    Stats.ulPoolRetainedBytes = 0;
+
+    for ( const QByteArray & Buffer : FreeBuffers )
+    {
+        Stats.ulPoolRetainedBytes += static_cast<quint64>( Buffer.capacity() );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,49 @@
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include <QByteArray>
+#include <QVector>
+
+#define BUFFER_POOL_SIZE            16
+#define BUFFER_INITIAL_BYTES        16384
+#define BUFFER_MAX_RETAINED_BYTES   1048576
+
+class MemoryStats
+{
+public:
+    quint64 ulRepliesInFlight = 0;      // Replies that have been sent but not yet finished
+    quint64 ulRepliesReleased = 0;      // Replies handed back to Qt for deletion
+    quint64 ulRepliesOversize = 0;      // Replies aborted for exceeding their maximum payload size
+    quint64 ulPoolHits = 0;             // Buffers served from the pool
+    quint64 ulPoolMisses = 0;           // Buffers that had to be allocated
+    quint64 ulPoolRetainedBytes = 0;    // Capacity currently held by idle pooled buffers
+    quint64 ulResidentBytes = 0;        // Resident set size of the whole process
+    quint64 ulModelEntries = 0;         // Tags held by the client's DataStore
+    quint64 ulModelBytes = 0;           // Estimated memory held by those tags
+    quint64 ulModelEvicted = 0;         // Tags dropped over capacity, past their time to live or pruned
+
+    static quint64 residentBytes();
+};
+
+class BufferPool
+{
+public:
+    explicit BufferPool( const int & iMaxBuffers = BUFFER_POOL_SIZE,
+                         const int & iInitialBytes = BUFFER_INITIAL_BYTES,
+                         const int & iMaxRetainedBytes = BUFFER_MAX_RETAINED_BYTES );
+
+    QByteArray acquire();
+    void release( QByteArray & Buffer );
+
+    void fillStats( MemoryStats & Stats ) const;
+
+private:
+    QVector<QByteArray> FreeBuffers;
+    int iMaxBuffers;
+    int iInitialBytes;
+    int iMaxRetainedBytes;
+    quint64 ulHits;
+    quint64 ulMisses;
+};
+
+#endif // BUFFERPOOL_H
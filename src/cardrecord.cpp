@@ -0,0 +1,179 @@
+#include <QDateTime>
+#include <QtEndian>
+
+#include "cardrecord.h"
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+QByteArray CardRecord::encode( const QVariantMap & Record )
+{
+    QByteArray Payload;
+    QByteArray Data;
+    QString sName = Record.value( "screenName" ).toString();
+    QByteArray Name = sName.toUtf8();
+    quint16 uiChecksum = 0;
+
+    /* Keep the name within its limit without cutting a character in half. */
+    while ( CARD_RECORD_MAX_NAME_BYTES < Name.size() )
+    {
+        sName.chop( 1 );
+        Name = sName.toUtf8();
+    }
+
+    Payload.append( static_cast<char>( Field::ScreenName ) );
+    Payload.append( static_cast<char>( Name.size() ) );
+    Payload.append( Name );
+    appendInteger( Payload, Field::Tokens, Record.value( "tokens" ).toInt() );
+    appendInteger( Payload, Field::Tickets, Record.value( "tickets" ).toInt() );
+    appendInteger( Payload, Field::Written, QDateTime::currentSecsSinceEpoch() );
+
+    uiChecksum = qChecksum( Payload.constData(), static_cast<uint>( Payload.size() ) );
+
+    Data.append( "BC", 2 );
+    Data.append( static_cast<char>( CARD_RECORD_VERSION ) );
+    Data.append( static_cast<char>( Payload.size() ) );
+    Data.append( Payload );
+    Data.append( static_cast<char>( uiChecksum >> 8 ) );
+    Data.append( static_cast<char>( uiChecksum & 0xFF ) );
+
+    /* Writes are whole pages. */
+    while ( 0 != ( Data.size() % CARD_RECORD_PAGE_BYTES ) )
+    {
+        Data.append( '\0' );
+    }
+
+    return Data;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+int CardRecord::encodedLength( const QByteArray & Header )
+{
+    int iLength = 0;
+
+    /* Anything else on the card (i.e. NDEF data, or a blank card) is not a record. */
+    if ( ( CARD_RECORD_PAGE_BYTES > Header.size() ) || ( !Header.startsWith( "BC" ) )
+         || ( CARD_RECORD_VERSION != static_cast<unsigned char>( Header.at( 2 ) ) ) )
+    {
+        return -1;
+    }
+
+    iLength = CARD_RECORD_PAGE_BYTES + static_cast<unsigned char>( Header.at( 3 ) ) + 2;
+
+    return ( CARD_RECORD_MAX_BYTES >= iLength ) ? iLength : -1;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool CardRecord::isWritable( const QByteArray & Existing )
+{
+    const QByteArray EmptyMessage( "\x03\x00\xFE", 3 );
+    int iFirst = 0;
+
+    /* Existing holds the memory that a write would cover. Any record header may be replaced, whatever its version. */
+    if ( Existing.startsWith( "BC" ) )
+    {
+        return true;
+    }
+
+    /* Factory-fresh NTAG21x cards carry an empty NDEF message (an NDEF TLV of length zero, then the terminator TLV),
+     * which holds nothing worth keeping. */
+    if ( Existing.startsWith( EmptyMessage ) )
+    {
+        iFirst = EmptyMessage.size();
+    }
+
+    for ( int i = iFirst; i < Existing.size(); i++ )
+    {
+        if ( '\0' != Existing.at( i ) )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool CardRecord::decode( const QByteArray & Data, QVariantMap & Record )
+{
+    const int iLength = encodedLength( Data );
+    QByteArray Payload;
+    quint16 uiChecksum = 0;
+    int iOffset = 0;
+    int iFieldLength = 0;
+    bool bInteger = false;
+
+    if ( ( 0 > iLength ) || ( Data.size() < iLength ) )
+    {
+        return false;
+    }
+
+    /* A torn write leaves a record that fails its checksum. */
+    Payload = Data.mid( CARD_RECORD_PAGE_BYTES, iLength - CARD_RECORD_PAGE_BYTES - 2 );
+    uiChecksum = static_cast<quint16>( ( static_cast<unsigned char>( Data.at( iLength - 2 ) ) << 8 )
+                                       | static_cast<unsigned char>( Data.at( iLength - 1 ) ) );
+    if ( uiChecksum != qChecksum( Payload.constData(), static_cast<uint>( Payload.size() ) ) )
+    {
+        return false;
+    }
+
+    Record.clear();
+    while ( iOffset + 2 <= Payload.size() )
+    {
+        iFieldLength = static_cast<unsigned char>( Payload.at( iOffset + 1 ) );
+        if ( Payload.size() < iOffset + 2 + iFieldLength )
+        {
+            return false;
+        }
+
+        const QByteArray Value = Payload.mid( iOffset + 2, iFieldLength );
+        bInteger = ( 4 == Value.size() );
+
+        switch ( static_cast<Field>( Payload.at( iOffset ) ) )
+        {
+        case Field::ScreenName:
+            Record.insert( "screenName", QString::fromUtf8( Value ) );
+            break;
+
+        case Field::Tokens:
+            if ( bInteger )
+            {
+                Record.insert( "tokens", qFromBigEndian<qint32>( Value.constData() ) );
+            }
+            break;
+
+        case Field::Tickets:
+            if ( bInteger )
+            {
+                Record.insert( "tickets", qFromBigEndian<qint32>( Value.constData() ) );
+            }
+            break;
+
+        case Field::Written:
+            if ( bInteger )
+            {
+                Record.insert( "written", QDateTime::fromSecsSinceEpoch( qFromBigEndian<quint32>( Value.constData() ), Qt::UTC ) );
+            }
+            break;
+
+        default:
+            /* Written by a newer version. */
+            break;
+        }
+
+        iOffset += 2 + iFieldLength;
+    }
+
+    return true;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void CardRecord::appendInteger( QByteArray & Payload, const Field & eField, const qint64 & iValue )
+{
+    char Value[ 4 ];
+
+    /* Every integer field is four bytes. */
+    qToBigEndian<quint32>( static_cast<quint32>( iValue ), Value );
+    Payload.append( static_cast<char>( eField ) );
+    Payload.append( static_cast<char>( sizeof( Value ) ) );
+    Payload.append( Value, sizeof( Value ) );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,42 @@
+#ifndef CARDRECORD_H
+#define CARDRECORD_H
+
+#include <QByteArray>
+#include <QVariantMap>
+
+#define CARD_RECORD_FIRST_PAGE      4       // First page of user memory on NTAG21x and Ultralight tags
+#define CARD_RECORD_PAGE_BYTES      4
+#define CARD_RECORD_READ_BYTES      16      // A read returns four pages at once
+#define CARD_RECORD_MAX_BYTES       96      // Header, payload and checksum; fits the 144 bytes of an NTAG213
+#define CARD_RECORD_MAX_NAME_BYTES  32
+#define CARD_RECORD_VERSION         1
+
+/* A small copy of the player kept on the card, so a tap can show the player before the backend has answered.
+ *
+ * Layout, from CARD_RECORD_FIRST_PAGE: a header page of "BC", the version and the payload length, then the payload as
+ * tag/length/value fields, then a big-endian CRC-16 of the payload. Fields with unknown tags are skipped. The keys
+ * in the decoded map are screenName, tokens, tickets and written (when the record was last written).
+ *
+ * Only a blank card, or one whose user memory already starts with a record header, is written to: anything else
+ * (i.e. the NDEF message an NTAG21x keeps from page 4) belongs to another application. */
+class CardRecord
+{
+public:
+    static QByteArray encode( const QVariantMap & Record );
+    static bool decode( const QByteArray & Data, QVariantMap & Record );
+    static int encodedLength( const QByteArray & Header );
+    static bool isWritable( const QByteArray & Existing );
+
+private:
+    enum class Field
+    {
+        ScreenName = 1,
+        Tokens = 2,
+        Tickets = 3,
+        Written = 4
+    };
+
+    static void appendInteger( QByteArray & Payload, const Field & eField, const qint64 & iValue );
+};
+
+#endif // CARDRECORD_H
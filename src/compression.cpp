@@ -0,0 +1,112 @@
+#include "compression.h"
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+StreamDecoder::StreamDecoder()
+{
+    bFinished = false;
+    xStream.zalloc = Z_NULL;
+    xStream.zfree = Z_NULL;
+    xStream.opaque = Z_NULL;
+    xStream.next_in = Z_NULL;
+    xStream.avail_in = 0;
+
+    /* Automatically detect either a gzip or a zlib (HTTP "deflate") header. */
+    bInitialized = ( Z_OK == inflateInit2( &xStream, MAX_WBITS + 32 ) );
+    bValid = bInitialized;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+StreamDecoder::~StreamDecoder()
+{
+    if ( bInitialized )
+    {
+        ( void )inflateEnd( &xStream );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool StreamDecoder::isValid() const
+{
+    /* Asked once the reply has completed: a stream that never reached its end was cut off, and what it produced so far
+     * must not be parsed. */
+    return ( bValid ) && ( bFinished );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool StreamDecoder::decode( const QByteArray & Input, QByteArray & Output )
+{
+    int iOffset = 0;
+    int iResult = Z_OK;
+
+    if ( ( !bValid ) || ( bFinished ) )
+    {
+        /* Trailing data after the end of the stream is ignored. */
+        return bValid;
+    }
+
+    xStream.next_in = reinterpret_cast<Bytef *>( const_cast<char *>( Input.constData() ) );
+    xStream.avail_in = static_cast<uInt>( Input.size() );
+
+    /* Inflate until the input is consumed and no output is left pending. */
+    do
+    {
+        iOffset = Output.size();
+        Output.resize( iOffset + DECODE_CHUNK_BYTES );
+        xStream.next_out = reinterpret_cast<Bytef *>( Output.data() + iOffset );
+        xStream.avail_out = DECODE_CHUNK_BYTES;
+
+        iResult = inflate( &xStream, Z_NO_FLUSH );
+        Output.resize( iOffset + DECODE_CHUNK_BYTES - static_cast<int>( xStream.avail_out ) );
+
+        if ( Z_STREAM_END == iResult )
+        {
+            bFinished = true;
+        }
+        else if ( ( Z_OK != iResult ) && ( Z_BUF_ERROR != iResult ) )
+        {
+            /* Corrupt stream. */
+            bValid = false;
+        }
+    } while ( ( bValid ) && ( !bFinished ) && ( Z_BUF_ERROR != iResult )
+              && ( ( 0 < xStream.avail_in ) || ( 0 == xStream.avail_out ) ) );
+
+    return bValid;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool StreamDecoder::gzipCompress( const QByteArray & Input, QByteArray & Output )
+{
+    z_stream xDeflate;
+    bool bReturn = false;
+
+    xDeflate.zalloc = Z_NULL;
+    xDeflate.zfree = Z_NULL;
+    xDeflate.opaque = Z_NULL;
+
+    /* Add 16 to the window bits to get a gzip wrapper rather than a zlib one. */
+    if ( Z_OK == deflateInit2( &xDeflate, Z_DEFAULT_COMPRESSION, Z_DEFLATED, MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY ) )
+    {
+        Output.resize( static_cast<int>( deflateBound( &xDeflate, static_cast<uLong>( Input.size() ) ) ) );
+
+        xDeflate.next_in = reinterpret_cast<Bytef *>( const_cast<char *>( Input.constData() ) );
+        xDeflate.avail_in = static_cast<uInt>( Input.size() );
+        xDeflate.next_out = reinterpret_cast<Bytef *>( Output.data() );
+        xDeflate.avail_out = static_cast<uInt>( Output.size() );
+
+        /* The output was sized with deflateBound(), so a single pass is enough. */
+        if ( Z_STREAM_END == deflate( &xDeflate, Z_FINISH ) )
+        {
+            Output.resize( static_cast<int>( xDeflate.total_out ) );
+            bReturn = true;
+        }
+        else
+        {
+            Output.clear();
+        }
+
+        ( void )deflateEnd( &xDeflate );
+    }
+
+    return bReturn;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,65 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <QByteArray>
+#include <zlib.h>
+
+#define DECODE_CHUNK_BYTES              16384
+#define COMPRESSION_THRESHOLD_BYTES     1024
+
+class CompressionStats
+{
+public:
+    quint64 ulResponses = 0;            // Replies that arrived with a compressed body
+    quint64 ulResponseWireBytes = 0;    // Compressed bytes received
+    quint64 ulResponseDecodedBytes = 0; // Bytes produced by decompression
+    quint64 ulResponseDecodeNs = 0;     // Time spent decompressing
+    quint64 ulRequests = 0;             // Requests sent with a compressed body
+    quint64 ulRequestRawBytes = 0;      // Body bytes before compression
+    quint64 ulRequestWireBytes = 0;     // Body bytes after compression
+    quint64 ulRequestEncodeNs = 0;      // Time spent compressing
+
+    double responseRatio() const
+    {
+        return ( 0 < ulResponseWireBytes ) ?
+                    static_cast<double>( ulResponseDecodedBytes ) / static_cast<double>( ulResponseWireBytes ) : 0.0;
+    }
+
+    double requestRatio() const
+    {
+        return ( 0 < ulRequestWireBytes ) ?
+                    static_cast<double>( ulRequestRawBytes ) / static_cast<double>( ulRequestWireBytes ) : 0.0;
+    }
+
+    quint64 decodeNsPerResponse() const
+    {
+        return ( 0 < ulResponses ) ? ulResponseDecodeNs / ulResponses : 0;
+    }
+
+    quint64 encodeNsPerRequest() const
+    {
+        return ( 0 < ulRequests ) ? ulRequestEncodeNs / ulRequests : 0;
+    }
+};
+
+class StreamDecoder
+{
+public:
+    StreamDecoder();
+    ~StreamDecoder();
+
+    bool decode( const QByteArray & Input, QByteArray & Output );
+    bool isValid() const;
+
+    static bool gzipCompress( const QByteArray & Input, QByteArray & Output );
+
+private:
+    Q_DISABLE_COPY( StreamDecoder )
+
+    z_stream xStream;
+    bool bInitialized;
+    bool bValid;
+    bool bFinished;
+};
+
+#endif // COMPRESSION_H
@@ -1,4 +1,9 @@
+#include <QDebug>
+#include <QThread>
+#include <QtNumeric>
+
 #include "datastore.h"
+#include "tracer.h"
 /*--------------------------------------------------------------------------------------------------------------------*/
 
 static DataStore *pInstance = nullptr;
@@ -6,7 +11,23 @@ static DataStore *pInstance = nullptr;
 
 DataStore::DataStore( QObject * pParent ) : QObject( pParent )
 {
-    /* Nothing to do. */
+    pSharedLayer = nullptr;
+    bFrozen = false;
+
+    /* The model is unbounded until a capacity or time to live is set. */
+    pNewest = nullptr;
+    pOldest = nullptr;
+    iMaxEntries = 0;
+    iMaxBytes = 0;
+    iBatchDepth = 0;
+    ulEntries = 0;
+    ulBytes = 0;
+    ulEvicted = 0;
+    ulExpired = 0;
+    ulPruned = 0;
+    Clock.start();
+    pSweepTimer = new QTimer( this );
+    connect( pSweepTimer, SIGNAL( timeout() ), this, SLOT( handleSweep() ) );
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
@@ -22,65 +43,976 @@ DataStore * DataStore::instance()
 /*--------------------------------------------------------------------------------------------------------------------*/
 
 void DataStore::publish( const DataPoint & Data )
+{
+    if ( nullptr != pInstance )
+    {
+        pInstance->insert( Data );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void DataStore::publishBatch( const QList<DataPoint> & Points )
+{
+    if ( nullptr != pInstance )
+    {
+        pInstance->insertBatch( Points );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void DataStore::subscribe( const QString & sTag, DataSubscriber * pSubscriber )
+{
+    instance()->addSubscriber( sTag, pSubscriber );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void DataStore::unsubscribe( const QString & sTag, DataSubscriber * pSubscriber )
+{
+    if ( nullptr != pInstance )
+    {
+        pInstance->removeSubscriber( sTag, pSubscriber );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void DataStore::unsubscribeAll( DataSubscriber * pSubscriber )
+{
+    if ( nullptr != pInstance )
+    {
+        pInstance->removeSubscriber( pSubscriber );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+DataPoint DataStore::getDataPoint( const QString & sTag )
 {
     if ( nullptr == pInstance )
     {
+        return DataPoint();
+    }
+
+    return pInstance->value( sTag );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void DataStore::insert( const DataPoint & Data )
+{
+    std::unordered_map<QString, ModelEntry, TagHash>::iterator Iterator;
+    QString sKey;
+    int iOldLength = -1;
+    int iNewLength = -1;
+    bool bLength = false;
+
+    if ( bFrozen.load( std::memory_order_acquire ) )
+    {
+        qDebug() << "DataStore::insert: The store is frozen, dropping" << Data.sTag;
         return;
     }
 
-    /* Update the data model. */
-    pInstance->DataModel.insert( Data.sTag.toLower(), Data );
+    /* The model and the subscribers belong to the store's thread; data from other threads is queued over. */
+    if ( QThread::currentThread() != thread() )
+    {
+        insertBatch( QList<DataPoint>{ Data } );
+        return;
+    }
+
+    /* Update the data model, moving the tag to the head of the recency list. */
+    sKey = Data.sTag.toLower();
+    Iterator = DataModel.find( sKey );
+    if ( DataModel.end() == Iterator )
+    {
+        Iterator = DataModel.emplace( sKey, ModelEntry() ).first;
+        Iterator->second.pKey = &Iterator->first;
+        Iterator->second.iRule = ruleFor( sKey );
+        ulEntries++;
+    }
+    else
+    {
+        unlinkExpiry( Iterator->second );
+        ulBytes -= static_cast<quint64>( Iterator->second.iBytes );
+        if ( sKey.endsWith( ".length" ) )
+        {
+            iOldLength = Iterator->second.Data.Value.toInt( &bLength );
+            iNewLength = bLength ? Data.Value.toInt( &bLength ) : -1;
+        }
+    }
+
+    ModelEntry & Entry = Iterator->second;
+    Entry.Data = Data;
+    Entry.iBytes = estimateBytes( sKey, Data );
+    ulBytes += static_cast<quint64>( Entry.iBytes );
+    touch( Entry );
+    linkExpiry( Entry );
+
+    /* Keep any rankings declared over this tag up to date. */
+    if ( !Indexes.isEmpty() )
+    {
+        updateIndexes( sKey, Data.Value, false );
+    }
+
+    /* A collection that got shorter leaves its former tail behind, i.e. players.12.* once players.length is 12. */
+    if ( ( bLength ) && ( iNewLength < iOldLength ) )
+    {
+        pruneCollection( sKey.left( sKey.length() - 7 ), iNewLength );
+    }
+    enforceCapacity( &Entry );
 
     /* Emit a signal for anyone interested. */
-    emit pInstance->newDataPoint( Data );
+    emit newDataPoint( Data );
 
     /* Inform all of the subscribers. */
-    for ( DataSubscriber * const pSubscriber : pInstance->Subscribers.values( Data.sTag.toLower() ) )
+    for ( DataSubscriber * const pSubscriber : Subscribers.values( Data.sTag.toLower() ) )
     {
+        TraceSpan Span( "handleData", "subscriber", Data.sTag );
+
         pSubscriber->handleData( Data );
     }
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void DataStore::subscribe( const QString & sTag, DataSubscriber * pSubscriber )
+void DataStore::insertBatch( const QList<DataPoint> & Points )
 {
-    if ( nullptr == pInstance )
+    const quint64 ulCorrelation = Tracer::currentCorrelation();
+
+    /* A whole batch crosses threads as a single event, which keeps the receiving thread responsive for large replies
+     * and delivers the points in order. */
+    if ( QThread::currentThread() != thread() )
     {
-        pInstance = new DataStore();
+        QMetaObject::invokeMethod( this, [ this, Points, ulCorrelation ]()
+        {
+            CorrelationScope Trace( ulCorrelation );
+
+            insertBatch( Points );
+        }, Qt::QueuedConnection );
+        return;
+    }
+
+    iBatchDepth++;
+    for ( const DataPoint & Point : Points )
+    {
+        insert( Point );
     }
 
-    pInstance->Subscribers.insertMulti( sTag.toLower(), pSubscriber );
+    /* Every root the batch touched now has all of its fields, whatever order they came in, so rank them. */
+    if ( 0 == --iBatchDepth )
+    {
+        for ( SecondaryIndex & Index : Indexes )
+        {
+            syncIndex( Index );
+        }
+    }
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void DataStore::unsubscribe( const QString & sTag, DataSubscriber * pSubscriber )
+void DataStore::addSubscriber( const QString & sTag, DataSubscriber * pSubscriber )
 {
-    pInstance->Subscribers.remove( sTag.toLower(), pSubscriber );
+    Subscribers.insertMulti( sTag.toLower(), pSubscriber );
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void DataStore::unsubscribeAll( DataSubscriber * pSubscriber )
+void DataStore::removeSubscriber( const QString & sTag, DataSubscriber * pSubscriber )
 {
-    /* Remove all references to the subscriber. */
-    for ( QMultiHash<QString, DataSubscriber *>::const_iterator Iterator = pInstance->Subscribers.begin();
-          Iterator != pInstance->Subscribers.end();
-          ++Iterator )
+    Subscribers.remove( sTag.toLower(), pSubscriber );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void DataStore::removeSubscriber( DataSubscriber * pSubscriber )
+{
+    QMultiHash<QString, DataSubscriber *>::iterator Iterator;
+
+    /* Remove all references to the subscriber, erasing through the iterator so it stays valid. */
+    Iterator = Subscribers.begin();
+    while ( Iterator != Subscribers.end() )
     {
         if ( Iterator.value() == pSubscriber )
         {
-            pInstance->Subscribers.remove( Iterator.key(), pSubscriber );
+            Iterator = Subscribers.erase( Iterator );
+        }
+        else
+        {
+            ++Iterator;
         }
     }
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-DataPoint DataStore::getDataPoint( const QString & sTag )
+DataPoint DataStore::value( const QString & sTag ) const
 {
-    if ( nullptr == pInstance )
+    const QString sKey = sTag.toLower();
+    std::unordered_map<QString, ModelEntry, TagHash>::const_iterator Iterator = DataModel.find( sKey );
+
+    /* Tags this store does not hold, or holds past their time to live, fall through to the shared layer, if any. */
+    if ( ( DataModel.end() != Iterator )
+         && ( ( 0 > Iterator->second.iRule ) || ( Clock.elapsed() < Iterator->second.iExpiresMs ) ) )
     {
-        return DataPoint();
+        /* With a bound on the model, reads on the store's thread count as use too. */
+        if ( ( ( 0 < iMaxEntries ) || ( 0 < iMaxBytes ) ) && ( QThread::currentThread() == thread() )
+             && ( !bFrozen.load( std::memory_order_acquire ) ) )
+        {
+            touch( Iterator->second );
+        }
+
+        return Iterator->second.Data;
+    }
+
+    return ( nullptr != pSharedLayer ) ? pSharedLayer->value( sKey ) : DataPoint();
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void DataStore::setSharedLayer( const DataStore * pLayer )
+{
+    /* Only a frozen store can be shared, since it is then read from other threads without locking. */
+    if ( ( nullptr != pLayer ) && ( !pLayer->isFrozen() ) )
+    {
+        qDebug() << "DataStore::setSharedLayer: The layer must be frozen first.";
+        return;
+    }
+
+    pSharedLayer = pLayer;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void DataStore::freeze()
+{
+    /* From here on the model never changes, so any thread may read it. That includes expiry: the sweep removes tags,
+     * so it stops too, and any sweep already queued finds the store frozen. */
+    bFrozen.store( true, std::memory_order_release );
+    if ( QThread::currentThread() != thread() )
+    {
+        QMetaObject::invokeMethod( pSweepTimer, "stop", Qt::QueuedConnection );
+    }
+    else
+    {
+        pSweepTimer->stop();
     }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool DataStore::isFrozen() const
+{
+    return bFrozen.load( std::memory_order_acquire );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void DataStore::setCapacity( const int & iMaxEntries, const qint64 & iMaxBytes )
+{
+    if ( bFrozen.load( std::memory_order_acquire ) )
+    {
+        qDebug() << "DataStore::setCapacity: The store is frozen, ignoring";
+        return;
+    }
+
+    /* Beyond either limit the least recently used tags are dropped; zero leaves that limit off. */
+    this->iMaxEntries = qMax( 0, iMaxEntries );
+    this->iMaxBytes = qMax( Q_INT64_C( 0 ), iMaxBytes );
+    enforceCapacity( nullptr );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void DataStore::setTimeToLive( const QString & sPrefix, const int & iTimeToLiveMs )
+{
+    const QString sRulePrefix = sPrefix.toLower();
+    ExpiryRule Rule;
+    int i = 0;
+
+    if ( bFrozen.load( std::memory_order_acquire ) )
+    {
+        qDebug() << "DataStore::setTimeToLive: The store is frozen, ignoring" << sPrefix;
+        return;
+    }
+
+    /* Tags are dropped once they have not been updated for the time to live of the longest prefix they match. A time
+     * to live of zero removes the rule. */
+    for ( i = 0; i < ExpiryRules.size(); i++ )
+    {
+        ExpiryRules[ i ].pFirst = nullptr;
+        ExpiryRules[ i ].pLast = nullptr;
+        if ( ExpiryRules.at( i ).sPrefix == sRulePrefix )
+        {
+            ExpiryRules.remove( i-- );
+        }
+    }
+
+    if ( 0 < iTimeToLiveMs )
+    {
+        Rule.sPrefix = sRulePrefix;
+        Rule.iTimeToLiveMs = iTimeToLiveMs;
+        i = 0;
+        while ( ( i < ExpiryRules.size() ) && ( ExpiryRules.at( i ).sPrefix.length() >= sRulePrefix.length() ) )
+        {
+            i++;
+        }
+        ExpiryRules.insert( i, Rule );
+    }
+
+    /* Rule positions have changed, so sort every tag into its rule again, starting its time to live afresh. */
+    for ( std::pair<const QString, ModelEntry> & Item : DataModel )
+    {
+        Item.second.pExpiresBefore = nullptr;
+        Item.second.pExpiresAfter = nullptr;
+        Item.second.iRule = ruleFor( Item.first );
+        linkExpiry( Item.second );
+    }
+
+    if ( ExpiryRules.isEmpty() )
+    {
+        pSweepTimer->stop();
+    }
+    else if ( !pSweepTimer->isActive() )
+    {
+        pSweepTimer->start( DATASTORE_SWEEP_MS );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void DataStore::truncate( const QString & sCollection, const int & iLength )
+{
+    if ( bFrozen.load( std::memory_order_acquire ) )
+    {
+        return;
+    }
+
+    /* Queued like inserts from other threads, so it lands in order with the points published before it. */
+    if ( QThread::currentThread() != thread() )
+    {
+        QMetaObject::invokeMethod( this, [ this, sCollection, iLength ]()
+        {
+            truncate( sCollection, iLength );
+        }, Qt::QueuedConnection );
+        return;
+    }
+
+    pruneCollection( sCollection.toLower(), iLength );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+ModelStats DataStore::getModelStats() const
+{
+    ModelStats Stats;
+
+    /* The counters are atomic, so this can be called from any thread. */
+    Stats.ulEntries = ulEntries.load( std::memory_order_relaxed );
+    Stats.ulBytes = ulBytes.load( std::memory_order_relaxed );
+    Stats.ulEvicted = ulEvicted.load( std::memory_order_relaxed );
+    Stats.ulExpired = ulExpired.load( std::memory_order_relaxed );
+    Stats.ulPruned = ulPruned.load( std::memory_order_relaxed );
+
+    return Stats;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void DataStore::addIndex( const QString & sName,
+                          const QStringList & Roots,
+                          const QString & sIdField,
+                          const QString & sValueField,
+                          const QString & sGroupField )
+{
+    SecondaryIndex Index;
+    QString sRoot;
+    QString sField;
+    QString sSegment;
+
+    /* Roots are where the entities live (i.e. "players.*" and "player"); the fields are relative to a root and may
+     * have one wildcard segment of their own, shared by the value and its group (i.e. "stats.*.highScore" ranked per
+     * "stats.*.gameId"). */
+    for ( const QString & sPattern : Roots )
+    {
+        Index.Roots.append( parsePattern( sPattern.toLower() ) );
+    }
+    Index.IdField = parsePattern( sIdField.toLower() );
+    Index.ValueField = parsePattern( sValueField.toLower() );
+    Index.GroupField = parsePattern( sGroupField.toLower() );
+    Index.bGrouped = !sGroupField.isEmpty();
+
+    /* Build it from what the model already holds, ranking each root once all of it has been seen. This is the only
+     * time the model is walked; afterwards each published tag updates the index on its own. */
+    for ( const std::pair<const QString, ModelEntry> & Item : DataModel )
+    {
+        for ( const FieldPattern & Pattern : Index.Roots )
+        {
+            if ( matchRoot( Pattern, Item.first, sRoot, sField ) )
+            {
+                updateIndex( Index, sRoot, sField, Item.second.Data.Value, false );
+                Index.DirtyRoots.insert( sRoot );
+                break;
+            }
+        }
+    }
+    syncIndex( Index );
+
+    Indexes.insert( sName, Index );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void DataStore::removeIndex( const QString & sName )
+{
+    Indexes.remove( sName );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+QVector<RankedEntry> DataStore::getTop( const QString & sIndex, const int & iCount, const QString & sGroup ) const
+{
+    QHash<QString, SecondaryIndex>::const_iterator Index = Indexes.constFind( sIndex );
+    QHash<QString, RankTree>::const_iterator Ranking;
+
+    if ( Indexes.constEnd() == Index )
+    {
+        return QVector<RankedEntry>();
+    }
+
+    Ranking = Index->Rankings.constFind( sGroup );
+
+    return ( Index->Rankings.constEnd() != Ranking ) ? Ranking->first( iCount ) : QVector<RankedEntry>();
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+int DataStore::getRank( const QString & sIndex, const QString & sId, const QString & sGroup ) const
+{
+    QHash<QString, SecondaryIndex>::const_iterator Index = Indexes.constFind( sIndex );
+    QHash<QString, QHash<QString, double>>::const_iterator Member;
+    QHash<QString, RankTree>::const_iterator Ranking;
+
+    /* Zero is the top of the ranking; -1 if the entity is not ranked. */
+    if ( Indexes.constEnd() == Index )
+    {
+        return -1;
+    }
+
+    Member = Index->Members.constFind( sId );
+    Ranking = Index->Rankings.constFind( sGroup );
+    if ( ( Index->Members.constEnd() == Member ) || ( !Member->contains( sGroup ) ) ||
+         ( Index->Rankings.constEnd() == Ranking ) )
+    {
+        return -1;
+    }
+
+    return Ranking->rank( Member->value( sGroup ), sId );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+int DataStore::getIndexSize( const QString & sIndex, const QString & sGroup ) const
+{
+    QHash<QString, SecondaryIndex>::const_iterator Index = Indexes.constFind( sIndex );
+    QHash<QString, RankTree>::const_iterator Ranking;
+
+    if ( Indexes.constEnd() == Index )
+    {
+        return 0;
+    }
+
+    Ranking = Index->Rankings.constFind( sGroup );
+
+    return ( Index->Rankings.constEnd() != Ranking ) ? Ranking->size() : 0;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void DataStore::handleSweep()
+{
+    const qint64 iNowMs = Clock.elapsed();
+
+    if ( bFrozen.load( std::memory_order_acquire ) )
+    {
+        return;
+    }
+
+    /* Each rule's list is in expiry order, so only the expired tags at its front are visited. */
+    for ( ExpiryRule & Rule : ExpiryRules )
+    {
+        while ( ( nullptr != Rule.pFirst ) && ( Rule.pFirst->iExpiresMs <= iNowMs ) )
+        {
+            removeEntry( *Rule.pFirst );
+            ulExpired++;
+        }
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void DataStore::touch( const ModelEntry & Entry ) const
+{
+    ModelEntry *pEntry = const_cast<ModelEntry *>( &Entry );
+
+    if ( pNewest == pEntry )
+    {
+        return;
+    }
+
+    /* Relinking only moves pointers held in the entries, so no memory is allocated. */
+    unlinkRecency( Entry );
+    pEntry->pOlder = pNewest;
+    if ( nullptr != pNewest )
+    {
+        pNewest->pNewer = pEntry;
+    }
+    pNewest = pEntry;
+    if ( nullptr == pOldest )
+    {
+        pOldest = pEntry;
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void DataStore::unlinkRecency( const ModelEntry & Entry ) const
+{
+    if ( nullptr != Entry.pNewer )
+    {
+        Entry.pNewer->pOlder = Entry.pOlder;
+    }
+    else if ( pNewest == &Entry )
+    {
+        pNewest = Entry.pOlder;
+    }
+
+    if ( nullptr != Entry.pOlder )
+    {
+        Entry.pOlder->pNewer = Entry.pNewer;
+    }
+    else if ( pOldest == &Entry )
+    {
+        pOldest = Entry.pNewer;
+    }
+
+    Entry.pNewer = nullptr;
+    Entry.pOlder = nullptr;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void DataStore::linkExpiry( ModelEntry & Entry )
+{
+    if ( 0 > Entry.iRule )
+    {
+        return;
+    }
+
+    /* Every tag of a rule lives equally long, so appending keeps the list in expiry order. */
+    ExpiryRule & Rule = ExpiryRules[ Entry.iRule ];
+    Entry.iExpiresMs = Clock.elapsed() + Rule.iTimeToLiveMs;
+    Entry.pExpiresBefore = Rule.pLast;
+    Entry.pExpiresAfter = nullptr;
+    if ( nullptr != Rule.pLast )
+    {
+        Rule.pLast->pExpiresAfter = &Entry;
+    }
+    else
+    {
+        Rule.pFirst = &Entry;
+    }
+    Rule.pLast = &Entry;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void DataStore::unlinkExpiry( ModelEntry & Entry )
+{
+    if ( 0 > Entry.iRule )
+    {
+        return;
+    }
+
+    ExpiryRule & Rule = ExpiryRules[ Entry.iRule ];
+    if ( nullptr != Entry.pExpiresBefore )
+    {
+        Entry.pExpiresBefore->pExpiresAfter = Entry.pExpiresAfter;
+    }
+    else if ( Rule.pFirst == &Entry )
+    {
+        Rule.pFirst = Entry.pExpiresAfter;
+    }
+
+    if ( nullptr != Entry.pExpiresAfter )
+    {
+        Entry.pExpiresAfter->pExpiresBefore = Entry.pExpiresBefore;
+    }
+    else if ( Rule.pLast == &Entry )
+    {
+        Rule.pLast = Entry.pExpiresBefore;
+    }
+
+    Entry.pExpiresBefore = nullptr;
+    Entry.pExpiresAfter = nullptr;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void DataStore::removeEntry( ModelEntry & Entry )
+{
+    /* Copy the key first, as it goes away with the entry. */
+    const QString sKey = *Entry.pKey;
+
+    unlinkRecency( Entry );
+    unlinkExpiry( Entry );
+    ulBytes -= static_cast<quint64>( Entry.iBytes );
+    ulEntries--;
+    DataModel.erase( sKey );
+
+    if ( !Indexes.isEmpty() )
+    {
+        updateIndexes( sKey, QVariant(), true );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void DataStore::enforceCapacity( const ModelEntry * pKeep )
+{
+    while ( ( nullptr != pOldest )
+            && ( pKeep != pOldest )
+            && ( ( ( 0 < iMaxEntries ) && ( static_cast<size_t>( iMaxEntries ) < DataModel.size() ) )
+                 || ( ( 0 < iMaxBytes ) && ( static_cast<quint64>( iMaxBytes ) < ulBytes.load() ) ) ) )
+    {
+        removeEntry( *pOldest );
+        ulEvicted++;
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void DataStore::pruneCollection( const QString & sCollection, const int & iLength )
+{
+    const QString sPrefix = sCollection + ".";
+    std::unordered_map<QString, ModelEntry, TagHash>::iterator Iterator = DataModel.begin();
+    int iEnd = 0;
+    int iIndex = 0;
+    bool bIndex = false;
+
+    /* Drop every element at or beyond the new length, i.e. players.12 and players.12.*. This walks the whole model,
+     * but only runs when a collection shrinks. */
+    while ( DataModel.end() != Iterator )
+    {
+        ModelEntry & Entry = Iterator->second;
+        const QString & sKey = Iterator->first;
+
+        ++Iterator;
+        if ( sKey.startsWith( sPrefix ) )
+        {
+            iEnd = sKey.indexOf( '.', sPrefix.length() );
+            iIndex = sKey.midRef( sPrefix.length(), ( 0 > iEnd ) ? -1 : iEnd - sPrefix.length() ).toInt( &bIndex );
+            if ( ( bIndex ) && ( iLength <= iIndex ) )
+            {
+                removeEntry( Entry );
+                ulPruned++;
+            }
+        }
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+int DataStore::ruleFor( const QString & sKey ) const
+{
+    /* The rules are ordered longest prefix first, so the first match is the most specific. */
+    for ( int i = 0; i < ExpiryRules.size(); i++ )
+    {
+        if ( sKey.startsWith( ExpiryRules.at( i ).sPrefix ) )
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+qint64 DataStore::estimateBytes( const QString & sKey, const DataPoint & Data )
+{
+    qint64 iBytes = DATASTORE_ENTRY_BYTES + ( sKey.size() + Data.sTag.size() ) * static_cast<qint64>( sizeof( QChar ) );
+
+    /* Only the variable-sized values are worth measuring. */
+    switch ( static_cast<int>( Data.Value.type() ) )
+    {
+    case QVariant::String:
+        iBytes += Data.Value.toString().size() * static_cast<qint64>( sizeof( QChar ) );
+        break;
+
+    case QVariant::ByteArray:
+        iBytes += Data.Value.toByteArray().size();
+        break;
+
+    default:
+        break;
+    }
+
+    return iBytes;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void DataStore::updateIndexes( const QString & sKey, const QVariant & Value, const bool & bRemoved )
+{
+    QString sRoot;
+    QString sField;
+
+    for ( SecondaryIndex & Index : Indexes )
+    {
+        for ( const FieldPattern & Pattern : Index.Roots )
+        {
+            if ( matchRoot( Pattern, sKey, sRoot, sField ) )
+            {
+                updateIndex( Index, sRoot, sField, Value, bRemoved );
+                if ( 0 < iBatchDepth )
+                {
+                    Index.DirtyRoots.insert( sRoot );
+                }
+                else
+                {
+                    syncRoot( Index, sRoot );
+                }
+                break;
+            }
+        }
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void DataStore::updateIndex( SecondaryIndex & Index,
+                             const QString & sRoot,
+                             const QString & sField,
+                             const QVariant & Value,
+                             const bool & bRemoved )
+{
+    IndexRoot & Root = Index.RootStates[ sRoot ];
+    QString sSegment;
+    double dValue = 0.0;
+    bool bValue = false;
+
+    /* Only note what the root now holds; syncRoot() ranks it. The fields of a root arrive in key order, so within a
+     * batch its values may well come before its id, and they belong to that id rather than the one the root held. */
+    if ( matchField( Index.IdField, sField, sSegment ) )
+    {
+        Root.sId = bRemoved ? QString() : Value.toString();
+    }
+    else if ( ( Index.bGrouped ) && ( matchField( Index.GroupField, sField, sSegment ) ) )
+    {
+        Root.Updated.insert( sSegment );
+        if ( bRemoved )
+        {
+            Root.Groups.remove( sSegment );
+        }
+        else
+        {
+            Root.Groups.insert( sSegment, Value.toString() );
+        }
+    }
+    else if ( ( !bRemoved ) && ( matchField( Index.ValueField, sField, sSegment ) ) )
+    {
+        /* A value dropped from the model keeps its last ranking; only its entity leaving the model removes it. NaN and
+         * infinities have no place in an ordering, so they are ignored too. */
+        dValue = Value.toDouble( &bValue );
+        if ( ( bValue ) && ( qIsFinite( dValue ) ) )
+        {
+            Root.Values.insert( sSegment, dValue );
+            Root.Updated.insert( sSegment );
+        }
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void DataStore::syncIndex( SecondaryIndex & Index )
+{
+    const QSet<QString> Roots = Index.DirtyRoots;
+
+    Index.DirtyRoots.clear();
+    for ( const QString & sRoot : Roots )
+    {
+        syncRoot( Index, sRoot );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void DataStore::syncRoot( SecondaryIndex & Index, const QString & sRoot )
+{
+    QHash<QString, IndexRoot>::iterator Iterator = Index.RootStates.find( sRoot );
+    QHash<QString, QString> Groups;
+    QHash<QString, double>::iterator Value;
+    QSet<QString> RankedGroups;
+    QString sGroup;
+
+    if ( Index.RootStates.end() == Iterator )
+    {
+        return;
+    }
+
+    IndexRoot & Root = Iterator.value();
+
+    /* The root holds another entity (or none) now, i.e. after a reorder. The values that came with the new id are
+     * its own, as are any that arrived ahead of the first id; the others belonged to the previous entity. */
+    if ( Root.sId != Root.sRankedId )
+    {
+        if ( !Root.sRankedId.isEmpty() )
+        {
+            releaseMember( Index, Root.sRankedId );
+
+            Value = Root.Values.begin();
+            while ( Root.Values.end() != Value )
+            {
+                if ( Root.Updated.contains( Value.key() ) )
+                {
+                    ++Value;
+                }
+                else
+                {
+                    Value = Root.Values.erase( Value );
+                }
+            }
+            for ( const QString & sSegment : Root.Groups.keys() )
+            {
+                if ( !Root.Updated.contains( sSegment ) )
+                {
+                    Root.Groups.remove( sSegment );
+                }
+            }
+        }
+
+        Root.sRankedId = Root.sId;
+        Root.RankedGroups.clear();
+        if ( !Root.sId.isEmpty() )
+        {
+            Index.RootCounts[ Root.sId ]++;
+        }
+    }
+    Root.Updated.clear();
+
+    if ( !Root.sId.isEmpty() )
+    {
+        /* Unchanged values cost a lookup each, as setMember() leaves them where they are. */
+        for ( Value = Root.Values.begin(); Root.Values.end() != Value; ++Value )
+        {
+            sGroup = Index.bGrouped ? Root.Groups.value( Value.key() ) : QString();
+            if ( ( !Index.bGrouped ) || ( !sGroup.isEmpty() ) )
+            {
+                setMember( Index, Root.sId, sGroup, true, Value.value() );
+                Groups.insert( Value.key(), sGroup );
+                RankedGroups.insert( sGroup );
+            }
+        }
+
+        /* A value moved to another group leaves the old group's ranking. */
+        for ( const QString & sOldGroup : Root.RankedGroups )
+        {
+            if ( !RankedGroups.contains( sOldGroup ) )
+            {
+                setMember( Index, Root.sId, sOldGroup, false, 0.0 );
+            }
+        }
+        Root.RankedGroups = Groups;
+    }
+    else if ( ( Root.Values.isEmpty() ) && ( Root.Groups.isEmpty() ) )
+    {
+        Index.RootStates.erase( Iterator );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void DataStore::setMember( SecondaryIndex & Index,
+                           const QString & sId,
+                           const QString & sGroup,
+                           const bool & bRanked,
+                           const double & dValue )
+{
+    QHash<QString, double> & Groups = Index.Members[ sId ];
+    QHash<QString, double>::iterator Iterator = Groups.find( sGroup );
+
+    /* An update is a removal at the old value and an insertion at the new one, each O(log n). */
+    if ( Groups.end() != Iterator )
+    {
+        if ( ( bRanked ) && ( dValue == Iterator.value() ) )
+        {
+            return;
+        }
+        Index.Rankings[ sGroup ].remove( Iterator.value(), sId );
+        Groups.erase( Iterator );
+    }
+
+    if ( bRanked )
+    {
+        Groups.insert( sGroup, dValue );
+        Index.Rankings[ sGroup ].insert( dValue, sId );
+    }
+    else if ( Groups.isEmpty() )
+    {
+        Index.Members.remove( sId );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void DataStore::releaseMember( SecondaryIndex & Index, const QString & sId )
+{
+    QHash<QString, QHash<QString, double>>::iterator Member;
+
+    /* An entity stays ranked while any root (i.e. both players.12 and player) still holds it. */
+    if ( 0 < --Index.RootCounts[ sId ] )
+    {
+        return;
+    }
+
+    Index.RootCounts.remove( sId );
+    Member = Index.Members.find( sId );
+    if ( Index.Members.end() != Member )
+    {
+        for ( QHash<QString, double>::const_iterator Iterator = Member->constBegin();
+              Iterator != Member->constEnd();
+              ++Iterator )
+        {
+            Index.Rankings[ Iterator.key() ].remove( Iterator.value(), sId );
+        }
+        Index.Members.erase( Member );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+DataStore::FieldPattern DataStore::parsePattern( const QString & sPattern )
+{
+    FieldPattern Pattern;
+    const int iWildcard = sPattern.indexOf( '*' );
+
+    if ( 0 > iWildcard )
+    {
+        Pattern.sPrefix = sPattern;
+    }
+    else
+    {
+        Pattern.sPrefix = sPattern.left( iWildcard );
+        Pattern.sSuffix = sPattern.mid( iWildcard + 1 );
+        Pattern.bWildcard = true;
+    }
+
+    return Pattern;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool DataStore::matchRoot( const FieldPattern & Pattern, const QString & sKey, QString & sRoot, QString & sField )
+{
+    int iEnd = 0;
+
+    if ( !sKey.startsWith( Pattern.sPrefix ) )
+    {
+        return false;
+    }
+
+    /* "players.*" takes one more segment into the root, "player" none. Either way a field must follow. */
+    iEnd = Pattern.bWildcard ? sKey.indexOf( '.', Pattern.sPrefix.length() ) : Pattern.sPrefix.length();
+    if ( ( 0 > iEnd ) || ( sKey.length() <= ( iEnd + 1 ) ) || ( '.' != sKey.at( iEnd ) ) )
+    {
+        return false;
+    }
+
+    sRoot = sKey.left( iEnd );
+    sField = sKey.mid( iEnd + 1 );
+
+    return true;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool DataStore::matchField( const FieldPattern & Pattern, const QString & sField, QString & sSegment )
+{
+    const int iLength = sField.length() - Pattern.sPrefix.length() - Pattern.sSuffix.length();
+
+    if ( !Pattern.bWildcard )
+    {
+        sSegment.clear();
+        return ( !sField.isEmpty() ) && ( sField == Pattern.sPrefix );
+    }
+
+    if ( ( 0 >= iLength ) || ( !sField.startsWith( Pattern.sPrefix ) ) || ( !sField.endsWith( Pattern.sSuffix ) ) )
+    {
+        return false;
+    }
+
+    sSegment = sField.mid( Pattern.sPrefix.length(), iLength );
 
-    return pInstance->DataModel.value( sTag.toLower(), DataPoint() );
+    return !sSegment.contains( '.' );
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
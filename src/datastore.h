@@ -2,8 +2,21 @@
 #define DATACACHE_H
 
 #include <QDateTime>
+#include <QElapsedTimer>
+#include <QHash>
 #include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
 #include <QVariant>
+#include <QVector>
+#include <atomic>
+#include <unordered_map>
+
+#include "ranktree.h"
+
+#define DATASTORE_SWEEP_MS          1000    // How often tags past their time to live are dropped
+#define DATASTORE_ENTRY_BYTES       128     // Estimated cost of a tag beyond its strings, for the memory budget
 
 class DataPoint
 {
@@ -41,28 +54,176 @@ public:
     virtual void handleData( const DataPoint & Data ) = 0;
 };
 
+class ModelStats
+{
+public:
+    quint64 ulEntries = 0;
+    quint64 ulBytes = 0;                // Estimated memory held by the model
+    quint64 ulEvicted = 0;              // Least recently used tags dropped to stay within capacity or budget
+    quint64 ulExpired = 0;              // Tags dropped for outliving their time to live
+    quint64 ulPruned = 0;               // Tags dropped when their collection got shorter
+};
+
 class DataStore : public QObject
 {
     Q_OBJECT
 
 public:
+    explicit DataStore( QObject * pParent = nullptr );
+
+    /* The process-wide store, used by the static functions and by default everywhere else. */
     static DataStore * instance();
 
     static void publish( const DataPoint & Data );
+    static void publishBatch( const QList<DataPoint> & Points );
     static void subscribe( const QString & sTag, DataSubscriber * pSubscriber );
     static void unsubscribe( const QString & sTag, DataSubscriber * pSubscriber );
     static void unsubscribeAll( DataSubscriber * pSubscriber );
 
     static DataPoint getDataPoint( const QString & sTag );
 
+    /* The same operations on this store alone. */
+    void insert( const DataPoint & Data );
+    void insertBatch( const QList<DataPoint> & Points );
+    void addSubscriber( const QString & sTag, DataSubscriber * pSubscriber );
+    void removeSubscriber( const QString & sTag, DataSubscriber * pSubscriber );
+    void removeSubscriber( DataSubscriber * pSubscriber );
+
+    DataPoint value( const QString & sTag ) const;
+
+    void setSharedLayer( const DataStore * pLayer );
+    void freeze();
+    bool isFrozen() const;
+
+    void setCapacity( const int & iMaxEntries, const qint64 & iMaxBytes = 0 );
+    void setTimeToLive( const QString & sPrefix, const int & iTimeToLiveMs );
+    void truncate( const QString & sCollection, const int & iLength );
+    ModelStats getModelStats() const;
+
+    /* Rankings of the entities under some roots by one of their fields, kept up to date as tags are published. */
+    void addIndex( const QString & sName,
+                   const QStringList & Roots,
+                   const QString & sIdField,
+                   const QString & sValueField,
+                   const QString & sGroupField = QString() );
+    void removeIndex( const QString & sName );
+    QVector<RankedEntry> getTop( const QString & sIndex, const int & iCount, const QString & sGroup = QString() ) const;
+    int getRank( const QString & sIndex, const QString & sId, const QString & sGroup = QString() ) const;
+    int getIndexSize( const QString & sIndex, const QString & sGroup = QString() ) const;
+
 signals:
     void newDataPoint( const DataPoint & Data );
 
+private slots:
+    void handleSweep();
+
 private:
-    explicit DataStore( QObject * pParent = nullptr );
+    class ModelEntry
+    {
+    public:
+        DataPoint Data;
+        const QString *pKey = nullptr;              // The entry's own key in the model
+        mutable ModelEntry *pNewer = nullptr;       // Recency list, newest at the head
+        mutable ModelEntry *pOlder = nullptr;
+        ModelEntry *pExpiresBefore = nullptr;       // Expiry list of the entry's time-to-live rule, soonest first
+        ModelEntry *pExpiresAfter = nullptr;
+        int iRule = -1;
+        qint64 iExpiresMs = 0;
+        qint64 iBytes = 0;
+    };
+
+    class ExpiryRule
+    {
+    public:
+        QString sPrefix;
+        int iTimeToLiveMs = 0;
+        ModelEntry *pFirst = nullptr;
+        ModelEntry *pLast = nullptr;
+    };
+
+    class FieldPattern
+    {
+    public:
+        QString sPrefix;
+        QString sSuffix;
+        bool bWildcard = false;                     // One segment between the prefix and suffix matches anything
+    };
+
+    class IndexRoot
+    {
+    public:
+        QString sId;
+        QHash<QString, QString> Groups;             // Wildcard segment of the group field to its group
+        QHash<QString, double> Values;              // Wildcard segment of the value field to its value
+        QSet<QString> Updated;                      // Segments whose value or group arrived since the last sync
+        QString sRankedId;                          // The entity the values are ranked under, as of the last sync
+        QHash<QString, QString> RankedGroups;       // Wildcard segment to the group its value is ranked in
+    };
+
+    class SecondaryIndex
+    {
+    public:
+        QVector<FieldPattern> Roots;
+        FieldPattern IdField;
+        FieldPattern ValueField;
+        FieldPattern GroupField;
+        bool bGrouped = false;
+        QHash<QString, IndexRoot> RootStates;       // Root tag (i.e. players.12) to the entity it holds
+        QHash<QString, int> RootCounts;             // Entity id to the number of roots holding it
+        QHash<QString, QHash<QString, double>> Members; // Entity id to its ranked value per group
+        QHash<QString, RankTree> Rankings;          // Group to its ranking; the empty group when ungrouped
+        QSet<QString> DirtyRoots;                   // Roots changed by the batch being inserted
+    };
+
+    class TagHash
+    {
+    public:
+        size_t operator()( const QString & sTag ) const
+        {
+            return qHash( sTag );
+        }
+    };
 
     QMultiHash<QString, DataSubscriber *> Subscribers;
-    QHash<QString, DataPoint> DataModel;
+    std::unordered_map<QString, ModelEntry, TagHash> DataModel;
+    mutable ModelEntry *pNewest;
+    mutable ModelEntry *pOldest;
+    QVector<ExpiryRule> ExpiryRules;                // Longest prefix first
+    QHash<QString, SecondaryIndex> Indexes;
+    int iMaxEntries;
+    qint64 iMaxBytes;
+    int iBatchDepth;                                // insertBatch() calls in progress; rankings wait for the outermost
+    QTimer *pSweepTimer;
+    QElapsedTimer Clock;
+    const DataStore *pSharedLayer;
+    std::atomic<bool> bFrozen;
+    std::atomic<quint64> ulEntries;
+    std::atomic<quint64> ulBytes;
+    std::atomic<quint64> ulEvicted;
+    std::atomic<quint64> ulExpired;
+    std::atomic<quint64> ulPruned;
+
+    void touch( const ModelEntry & Entry ) const;
+    void unlinkRecency( const ModelEntry & Entry ) const;
+    void linkExpiry( ModelEntry & Entry );
+    void unlinkExpiry( ModelEntry & Entry );
+    void removeEntry( ModelEntry & Entry );
+    void enforceCapacity( const ModelEntry * pKeep );
+    void pruneCollection( const QString & sCollection, const int & iLength );
+    int ruleFor( const QString & sKey ) const;
+    void updateIndexes( const QString & sKey, const QVariant & Value, const bool & bRemoved );
+    void updateIndex( SecondaryIndex & Index, const QString & sRoot, const QString & sField, const QVariant & Value,
+                      const bool & bRemoved );
+    void syncIndex( SecondaryIndex & Index );
+    void syncRoot( SecondaryIndex & Index, const QString & sRoot );
+    void setMember( SecondaryIndex & Index, const QString & sId, const QString & sGroup, const bool & bRanked,
+                    const double & dValue );
+    void releaseMember( SecondaryIndex & Index, const QString & sId );
+
+    static qint64 estimateBytes( const QString & sKey, const DataPoint & Data );
+    static FieldPattern parsePattern( const QString & sPattern );
+    static bool matchRoot( const FieldPattern & Pattern, const QString & sKey, QString & sRoot, QString & sField );
+    static bool matchField( const FieldPattern & Pattern, const QString & sField, QString & sSegment );
 };
 
 #endif // DATACACHE_H
@@ -0,0 +1,192 @@
+#include <QUrl>
+
+#include "endpoints.h"
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+EndpointWriter::EndpointWriter( const EndpointSpec & Spec, const QByteArray & Buffer ) : Spec( Spec )
+{
+    pcRoute = Spec.pcRoute;
+    iArgument = 0;
+    iPathCount = 0;
+    Body = Buffer;
+
+    /* Count the path placeholders so arguments can be routed to the path or the body. */
+    for ( const char *pcCursor = pcRoute; '\0' != *pcCursor; ++pcCursor )
+    {
+        if ( ( '{' == pcCursor[ 0 ] ) && ( '}' == pcCursor[ 1 ] ) )
+        {
+            iPathCount++;
+        }
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void EndpointWriter::appendRouteLiteral()
+{
+    const char *pcStart = pcRoute;
+
+    /* Copy the route up to the next placeholder (or the end), then step over the placeholder. */
+    while ( ( '\0' != *pcRoute ) && ( !( ( '{' == pcRoute[ 0 ] ) && ( '}' == pcRoute[ 1 ] ) ) ) )
+    {
+        ++pcRoute;
+    }
+
+    sPath.append( QLatin1String( pcStart, static_cast<int>( pcRoute - pcStart ) ) );
+
+    if ( '\0' != *pcRoute )
+    {
+        pcRoute += 2;
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void EndpointWriter::beginField()
+{
+    const int iField = iArgument - iPathCount;
+
+    Body.append( ( 0 == iField ) ? "{\"" : ",\"" );
+    Body.append( Spec.Fields[ iField ].pcName );
+    Body.append( "\":" );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void EndpointWriter::append( const QString & sValue )
+{
+    if ( iPathCount > iArgument )
+    {
+        /* Path arguments are escaped as a single segment. */
+        appendRouteLiteral();
+        sPath.append( QString::fromLatin1( QUrl::toPercentEncoding( sValue ) ) );
+    }
+    else
+    {
+        beginField();
+        appendJSONString( sValue );
+    }
+
+    iArgument++;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void EndpointWriter::append( const int & iValue )
+{
+    char acDigits[ 12 ];
+    int iLength = 0;
+    unsigned int uiMagnitude = ( 0 > iValue ) ? 0u - static_cast<unsigned int>( iValue ) : static_cast<unsigned int>( iValue );
+
+    beginField();
+
+    /* Format the digits in reverse, then append them in order. */
+    do
+    {
+        acDigits[ iLength++ ] = static_cast<char>( '0' + ( uiMagnitude % 10 ) );
+        uiMagnitude /= 10;
+    } while ( 0 != uiMagnitude );
+
+    if ( 0 > iValue )
+    {
+        Body.append( '-' );
+    }
+
+    while ( 0 < iLength )
+    {
+        Body.append( acDigits[ --iLength ] );
+    }
+
+    iArgument++;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void EndpointWriter::appendJSONString( const QString & sValue )
+{
+    static const char acHex[] = "0123456789abcdef";
+    const QChar *pCharacters = sValue.constData();
+    const int iLength = sValue.size();
+    uint uiCodePoint = 0;
+
+    Body.append( '"' );
+
+    /* Encode straight to UTF-8, escaping as required by JSON. */
+    for ( int i = 0; i < iLength; i++ )
+    {
+        uiCodePoint = pCharacters[ i ].unicode();
+
+        if ( ( pCharacters[ i ].isHighSurrogate() ) && ( iLength > ( i + 1 ) ) && ( pCharacters[ i + 1 ].isLowSurrogate() ) )
+        {
+            uiCodePoint = QChar::surrogateToUcs4( pCharacters[ i ], pCharacters[ i + 1 ] );
+            i++;
+        }
+        else if ( pCharacters[ i ].isSurrogate() )
+        {
+            /* A surrogate without its other half has no UTF-8 encoding. */
+            uiCodePoint = 0xfffd;
+        }
+
+        if ( ( '"' == uiCodePoint ) || ( '\\' == uiCodePoint ) )
+        {
+            Body.append( '\\' );
+            Body.append( static_cast<char>( uiCodePoint ) );
+        }
+        else if ( 0x20 > uiCodePoint )
+        {
+            Body.append( "\\u00" );
+            Body.append( acHex[ uiCodePoint >> 4 ] );
+            Body.append( acHex[ uiCodePoint & 0x0f ] );
+        }
+        else if ( 0x80 > uiCodePoint )
+        {
+            Body.append( static_cast<char>( uiCodePoint ) );
+        }
+        else if ( 0x800 > uiCodePoint )
+        {
+            Body.append( static_cast<char>( 0xc0 | ( uiCodePoint >> 6 ) ) );
+            Body.append( static_cast<char>( 0x80 | ( uiCodePoint & 0x3f ) ) );
+        }
+        else if ( 0x10000 > uiCodePoint )
+        {
+            Body.append( static_cast<char>( 0xe0 | ( uiCodePoint >> 12 ) ) );
+            Body.append( static_cast<char>( 0x80 | ( ( uiCodePoint >> 6 ) & 0x3f ) ) );
+            Body.append( static_cast<char>( 0x80 | ( uiCodePoint & 0x3f ) ) );
+        }
+        else
+        {
+            Body.append( static_cast<char>( 0xf0 | ( uiCodePoint >> 18 ) ) );
+            Body.append( static_cast<char>( 0x80 | ( ( uiCodePoint >> 12 ) & 0x3f ) ) );
+            Body.append( static_cast<char>( 0x80 | ( ( uiCodePoint >> 6 ) & 0x3f ) ) );
+            Body.append( static_cast<char>( 0x80 | ( uiCodePoint & 0x3f ) ) );
+        }
+    }
+
+    Body.append( '"' );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+QString EndpointWriter::takePath()
+{
+    QString sReturn;
+
+    /* Copy whatever is left of the route after the last placeholder. */
+    while ( '\0' != *pcRoute )
+    {
+        appendRouteLiteral();
+    }
+
+    sReturn.swap( sPath );
+    return sReturn;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+QByteArray EndpointWriter::takeBody()
+{
+    QByteArray Return;
+
+    /* Close the object if any field was written. */
+    if ( iPathCount < iArgument )
+    {
+        Body.append( '}' );
+    }
+
+    Return.swap( Body );
+    return Return;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
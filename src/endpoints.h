@@ -0,0 +1,215 @@
+#ifndef ENDPOINTS_H
+#define ENDPOINTS_H
+
+#include <QByteArray>
+#include <QNetworkAccessManager>
+#include <QString>
+
+#define ENDPOINT_MAX_FIELDS     4
+
+enum class FieldType
+{
+    String,
+    Integer
+};
+
+class EndpointField
+{
+public:
+    const char *pcName;
+    FieldType eType;
+};
+
+/* The single definition of every backend request: its name in the Endpoint enum and as a BCONNetwork slot, whether
+ * the slot only forwards its arguments to the request (Forward) or is written by hand (Custom), the HTTP method, the
+ * route relative to the server address (each {} is filled by a path argument in order), the slot's parameters and
+ * arguments, and the typed body fields. Adding an endpoint takes one entry here. */
+#define ENDPOINT_LIST( X ) \
+    X( CreateGame, createGame, Forward, Post, "/games/create", \
+       ( const QString & sName, const int & iTokenCost ), ( sName, iTokenCost ), \
+       ( { "name", FieldType::String }, { "tokenCost", FieldType::Integer } ) ) \
+    X( GetGame, getGame, Forward, Get, "/games/{}", ( const QString & sId ), ( sId ), () ) \
+    X( GetAllGames, getAllGames, Forward, Get, "/games", (), (), () ) \
+    X( UpdateGameName, updateGameName, Forward, Put, "/games/{}/update", \
+       ( const QString & sId, const QString & sNewName ), ( sId, sNewName ), \
+       ( { "name", FieldType::String } ) ) \
+    X( UpdateGameTokenCost, updateGameTokenCost, Forward, Put, "/games/{}/update", \
+       ( const QString & sId, const int & iNewTokenCost ), ( sId, iNewTokenCost ), \
+       ( { "tokenCost", FieldType::Integer } ) ) \
+    X( UpdateGameTopPlayer, updateGameTopPlayer, Forward, Put, "/games/{}/update", \
+       ( const QString & sId, const QString & sPlayerId ), ( sId, sPlayerId ), \
+       ( { "topPlayer", FieldType::String } ) ) \
+    X( DeleteGame, deleteGame, Forward, Delete, "/games/{}/delete", ( const QString & sId ), ( sId ), () ) \
+    X( CreatePlayer, createPlayer, Forward, Post, "/players/create", \
+       ( const QString & sId, const QString & sFirstName, const QString & sLastName, const QString & sScreenName ), \
+       ( sId, sFirstName, sLastName, sScreenName ), \
+       ( { "playerId", FieldType::String }, { "firstName", FieldType::String }, \
+         { "lastName", FieldType::String }, { "screenName", FieldType::String } ) ) \
+    X( GetPlayer, getPlayer, Custom, Get, "/players/{}", ( const QString & sId ), ( sId ), () ) \
+    X( GetAllPlayers, getAllPlayers, Custom, Get, "/players", (), (), () ) \
+    X( UpdatePlayerId, updatePlayerId, Forward, Put, "/players/{}/update", \
+       ( const QString & sId, const QString & sNewId ), ( sId, sNewId ), \
+       ( { "playerId", FieldType::String } ) ) \
+    X( UpdatePlayerName, updatePlayerName, Forward, Put, "/players/{}/update", \
+       ( const QString & sId, const QString & sNewFirstName, const QString & sNewLastName ), \
+       ( sId, sNewFirstName, sNewLastName ), \
+       ( { "firstName", FieldType::String }, { "lastName", FieldType::String } ) ) \
+    X( UpdatePlayerScreenName, updatePlayerScreenName, Forward, Put, "/players/{}/update", \
+       ( const QString & sId, const QString & sNewScreenName ), ( sId, sNewScreenName ), \
+       ( { "screenName", FieldType::String } ) ) \
+    X( UpdatePlayerTokens, updatePlayerTokens, Forward, Put, "/players/{}/update", \
+       ( const QString & sId, const int & iNewTokens ), ( sId, iNewTokens ), \
+       ( { "tokens", FieldType::Integer } ) ) \
+    X( UpdatePlayerTickets, updatePlayerTickets, Forward, Put, "/players/{}/update", \
+       ( const QString & sId, const int & iNewTickets ), ( sId, iNewTickets ), \
+       ( { "tickets", FieldType::Integer } ) ) \
+    X( PublishPlayerStats, publishPlayerStats, Forward, Post, "/players/{}/publishstats", \
+       ( const QString & sId, const QString & sGameId, const int & iTicketsEarned, const int & iHighScore ), \
+       ( sId, sGameId, iTicketsEarned, iHighScore ), \
+       ( { "gameId", FieldType::String }, { "ticketsEarned", FieldType::Integer }, \
+         { "highScore", FieldType::Integer } ) ) \
+    X( DeletePlayer, deletePlayer, Forward, Delete, "/players/{}/delete", ( const QString & sId ), ( sId ), () ) \
+    X( CreatePrize, createPrize, Forward, Post, "/prizes/create", \
+       ( const QString & sName, const int & iTicketCost, const int & iAvailableQuantity ), \
+       ( sName, iTicketCost, iAvailableQuantity ), \
+       ( { "name", FieldType::String }, { "ticketCost", FieldType::Integer }, \
+         { "availableQuantity", FieldType::Integer } ) ) \
+    X( GetPrize, getPrize, Forward, Get, "/prizes/{}", ( const QString & sId ), ( sId ), () ) \
+    X( GetAllPrizes, getAllPrizes, Custom, Get, "/prizes", (), (), () ) \
+    X( UpdatePrizeName, updatePrizeName, Forward, Put, "/prizes/{}/update", \
+       ( const QString & sId, const QString & sNewName ), ( sId, sNewName ), \
+       ( { "name", FieldType::String } ) ) \
+    X( UpdatePrizeDescription, updatePrizeDescription, Forward, Put, "/prizes/{}/update", \
+       ( const QString & sId, const QString & sNewDescription ), ( sId, sNewDescription ), \
+       ( { "description", FieldType::String } ) ) \
+    X( UpdatePrizeTicketCost, updatePrizeTicketCost, Forward, Put, "/prizes/{}/update", \
+       ( const QString & sId, const int & iNewTicketCost ), ( sId, iNewTicketCost ), \
+       ( { "ticketCost", FieldType::Integer } ) ) \
+    X( UpdatePrizeAvailableQuantity, updatePrizeAvailableQuantity, Forward, Put, "/prizes/{}/update", \
+       ( const QString & sId, const int & iNewAvailableQuantity ), ( sId, iNewAvailableQuantity ), \
+       ( { "availableQuantity", FieldType::Integer } ) ) \
+    X( RedeemPrize, redeemPrize, Forward, Post, "/prizes/{}/redeem", \
+       ( const QString & sPrizeId, const QString & sPlayerId ), ( sPrizeId, sPlayerId ), \
+       ( { "playerId", FieldType::String } ) ) \
+    X( DeletePrize, deletePrize, Forward, Delete, "/prizes/{}/delete", ( const QString & sId ), ( sId ), () )
+
+#define ENDPOINT_UNWRAP( ... )      __VA_ARGS__
+#define ENDPOINT_Forward( ... )     __VA_ARGS__
+#define ENDPOINT_Custom( ... )
+#define ENDPOINT_ENUM( Id, Name, Slot, Method, Route, Parameters, Arguments, Fields ) Id,
+#define ENDPOINT_SPEC( Id, Name, Slot, Method, Route, Parameters, Arguments, Fields ) \
+    { Endpoint::Id, #Name, QNetworkAccessManager::Method##Operation, Route, { ENDPOINT_UNWRAP Fields } },
+
+enum class Endpoint
+{
+    ENDPOINT_LIST( ENDPOINT_ENUM )
+    Count
+};
+
+class EndpointSpec
+{
+public:
+    Endpoint eId;
+    const char *pcName;
+    QNetworkAccessManager::Operation eOperation;
+    const char *pcRoute;
+    EndpointField Fields[ ENDPOINT_MAX_FIELDS ];
+};
+
+static constexpr EndpointSpec EndpointTable[] =
+{
+    ENDPOINT_LIST( ENDPOINT_SPEC )
+};
+
+constexpr const EndpointSpec & endpointSpec( const Endpoint eEndpoint )
+{
+    return EndpointTable[ static_cast<int>( eEndpoint ) ];
+}
+
+constexpr bool endpointTableOrdered( const int iIndex = 0 )
+{
+    return ( static_cast<int>( Endpoint::Count ) == iIndex )
+            || ( ( static_cast<int>( EndpointTable[ iIndex ].eId ) == iIndex ) && ( endpointTableOrdered( iIndex + 1 ) ) );
+}
+
+static_assert( static_cast<int>( Endpoint::Count ) == sizeof( EndpointTable ) / sizeof( EndpointTable[ 0 ] ),
+               "Every endpoint needs exactly one table entry." );
+static_assert( endpointTableOrdered(), "Endpoint table entries must be in the same order as the Endpoint enum." );
+
+constexpr int endpointPathCount( const Endpoint eEndpoint )
+{
+    int iCount = 0;
+
+    for ( const char *pcCursor = endpointSpec( eEndpoint ).pcRoute; '\0' != *pcCursor; ++pcCursor )
+    {
+        if ( ( '{' == pcCursor[ 0 ] ) && ( '}' == pcCursor[ 1 ] ) )
+        {
+            iCount++;
+        }
+    }
+
+    return iCount;
+}
+
+constexpr int endpointFieldCount( const Endpoint eEndpoint )
+{
+    int iCount = 0;
+
+    while ( ( ENDPOINT_MAX_FIELDS > iCount ) && ( nullptr != endpointSpec( eEndpoint ).Fields[ iCount ].pcName ) )
+    {
+        iCount++;
+    }
+
+    return iCount;
+}
+
+/* Path arguments are always strings; body arguments take the type declared for their field. */
+constexpr FieldType endpointArgumentType( const Endpoint eEndpoint, const int iArgument )
+{
+    return ( endpointPathCount( eEndpoint ) > iArgument ) ?
+                FieldType::String : endpointSpec( eEndpoint ).Fields[ iArgument - endpointPathCount( eEndpoint ) ].eType;
+}
+
+template<typename T> class EndpointArgument;
+template<> class EndpointArgument<QString> { public: static constexpr FieldType eType = FieldType::String; };
+template<> class EndpointArgument<int> { public: static constexpr FieldType eType = FieldType::Integer; };
+
+template<Endpoint eEndpoint>
+constexpr bool endpointArgumentsMatch( const int )
+{
+    return true;
+}
+
+template<Endpoint eEndpoint, typename First, typename... Rest>
+constexpr bool endpointArgumentsMatch( const int iArgument )
+{
+    return ( ( endpointPathCount( eEndpoint ) + endpointFieldCount( eEndpoint ) ) > iArgument )
+            && ( EndpointArgument<First>::eType == endpointArgumentType( eEndpoint, iArgument ) )
+            && ( endpointArgumentsMatch<eEndpoint, Rest...>( iArgument + 1 ) );
+}
+
+class EndpointWriter
+{
+public:
+    EndpointWriter( const EndpointSpec & Spec, const QByteArray & Buffer );
+
+    void append( const QString & sValue );
+    void append( const int & iValue );
+
+    QString takePath();
+    QByteArray takeBody();
+
+private:
+    const EndpointSpec & Spec;
+    const char *pcRoute;
+    int iArgument;
+    int iPathCount;
+    QString sPath;
+    QByteArray Body;
+
+    void appendRouteLiteral();
+    void beginField();
+    void appendJSONString( const QString & sValue );
+};
+
+#endif // ENDPOINTS_H
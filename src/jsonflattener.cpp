@@ -0,0 +1,140 @@
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QtMath>
+
+#include "jsonflattener.h"
+#include "tracer.h"
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void JSONFlattener::handleJSONPayload( DataStore * pStore, const QByteArray & Message, RequestTiming * pTiming, QList<DataPoint> * pPoints )
+{
+    QElapsedTimer StageTimer;
+    QJsonDocument Document;
+    TraceSpan Span( "handleJSONPayload", "parse" );
+
+    StageTimer.start();
+    Document = QJsonDocument::fromJson( Message );
+
+    if ( !Document.isNull() )
+    {
+        QList<DataPoint> Points = JSONUnpackObject( Document.object(),
+                                                    Document.object().begin(),
+                                                    QString(),
+                                                    QDateTime::fromMSecsSinceEpoch( QDateTime::currentMSecsSinceEpoch(),
+                                                                                    Qt::UTC ) );
+
+        if ( nullptr != pTiming )
+        {
+            pTiming->iParseNs = StageTimer.nsecsElapsed();
+            StageTimer.start();
+        }
+
+        if ( nullptr != pPoints )
+        {
+            *pPoints = Points;
+        }
+
+        /* On a worker thread this hands the whole reply to the DataStore's thread as a single update. */
+        pStore->insertBatch( Points );
+
+        if ( nullptr != pTiming )
+        {
+            pTiming->iPublishNs = StageTimer.nsecsElapsed();
+        }
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+QList<DataPoint> JSONFlattener::JSONUnpackObject( const QJsonObject & ParentObject,
+                                                  const QJsonObject::const_iterator & ParentIterator,
+                                                  const QString & sParentKey,
+                                                  const QDateTime & Timestamp )
+{
+    QJsonObject::const_iterator Iterator;
+    QList<DataPoint> Points;
+    QString sFlattenedKey = sParentKey;
+
+    if ( !sParentKey.isEmpty() )
+    {
+        sFlattenedKey.append( "." );
+        Points.append( DataPoint( sFlattenedKey + "^", QVariant(), Timestamp ) );
+    }
+
+    /* Process the document. */
+    for ( Iterator = ParentIterator; Iterator != ParentObject.end(); ++Iterator )
+    {
+        Points.append( JSONValueToDataPoint( Iterator.value(), sFlattenedKey + Iterator.key(), Timestamp ) );
+    }
+
+    if ( !sParentKey.isEmpty() )
+    {
+        Points.append( DataPoint( sFlattenedKey + "$", QVariant(), Timestamp ) );
+    }
+
+    return Points;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+QList<DataPoint> JSONFlattener::JSONValueToDataPoint( const QJsonValue & Value,
+                                                      const QString & sKey,
+                                                      const QDateTime & Timestamp )
+{
+    DataPoint Data;
+    QList<DataPoint> Points;
+
+    Data.sTag = sKey;
+    Data.Timestamp = Timestamp.isValid() ?
+                Timestamp : QDateTime::fromMSecsSinceEpoch( QDateTime::currentMSecsSinceEpoch(), Qt::UTC );
+
+    /* Examine the value type to determine what to do next. */
+    switch ( Value.type() )
+    {
+    case QJsonValue::Array:
+        Points.append( DataPoint( sKey + ".^", QVariant(), Timestamp ) );
+        for ( int i = 0; i < Value.toArray().size(); i++ )
+        {
+            Points.append( JSONValueToDataPoint( Value.toArray()[ i ], sKey + "." + QString::number( i ), Timestamp ) );
+        }
+        Points.append( DataPoint( sKey + ".length", QVariant( Value.toArray().size() ), Timestamp ) );
+        Points.append( DataPoint( sKey + ".$", QVariant(), Timestamp ) );
+        break;
+
+    case QJsonValue::Bool:
+        Data.Value = QVariant( Value.toBool() );
+        break;
+
+    case QJsonValue::Double:
+        /* Check if this is really an integer. */
+        if ( qFuzzyCompare( Value.toDouble(), qFloor( Value.toDouble() ) ) )
+        {
+            Data.Value = QVariant( Value.toInt() );
+        }
+        else
+        {
+            Data.Value = QVariant( Value.toDouble() );
+        }
+        break;
+
+    case QJsonValue::Object:
+        /* Go deeper to break down the object. */
+        Points.append( JSONUnpackObject( Value.toObject(), Value.toObject().begin(), sKey, Timestamp ) );
+        break;
+
+    case QJsonValue::String:
+        Data.Value = QVariant( Value.toString() );
+        break;
+
+    default:
+        /* Undefined type, ignore. */
+        break;
+    }
+
+    if ( ( !Value.isArray() ) && ( !Value.isObject() ) )
+    {
+        Points.append( Data );
+    }
+
+    return Points;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,21 @@
+#ifndef JSONFLATTENER_H
+#define JSONFLATTENER_H
+
+#include <QDateTime>
+#include <QJsonObject>
+#include <QList>
+
+#include "datastore.h"
+#include "metrics.h"
+
+/* Turns JSON replies into data points, i.e. {"player":{"tokens":4}} into player.^, player.tokens and player.$. Kept
+ * out of bconnetwork.h so the library's users do not see it; the microbenchmarks include it directly. */
+class JSONFlattener
+{
+public:
+    static void handleJSONPayload( DataStore * pStore, const QByteArray & Payload, RequestTiming * pTiming = nullptr, QList<DataPoint> * pPoints = nullptr );
+    static QList<DataPoint> JSONUnpackObject( const QJsonObject & ParentObject, const QJsonObject::const_iterator & ParentIterator, const QString & sParentKey, const QDateTime & Timestamp );
+    static QList<DataPoint> JSONValueToDataPoint( const QJsonValue & Value, const QString & sKey, const QDateTime & Timestamp );
+};
+
+#endif // JSONFLATTENER_H
@@ -0,0 +1,375 @@
+#include "metrics.h"
+
+#include <QtAlgorithms>
+#include <cmath>
+#include <limits>
+
+#include "datastore.h"
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+LatencyHistogram::LatencyHistogram()
+{
+    for ( std::atomic<quint64> & Bucket : Buckets )
+    {
+        Bucket.store( 0, std::memory_order_relaxed );
+    }
+    ulCount.store( 0, std::memory_order_relaxed );
+    ulSumNs.store( 0, std::memory_order_relaxed );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void LatencyHistogram::record( const qint64 & iNs )
+{
+    const quint64 ulNs = static_cast<quint64>( qMax( Q_INT64_C( 0 ), iNs ) );
+    const quint64 ulScaled = ( 0 < ulNs ) ? ( ulNs - 1 ) / METRICS_FIRST_BUCKET_NS : 0;
+    int iBucket = 0;
+
+    /* Bucket i holds values up to METRICS_FIRST_BUCKET_NS * 2^i, so the index is the bit length of the scaled value. */
+    if ( 0 < ulScaled )
+    {
+        iBucket = qMin( 64 - static_cast<int>( qCountLeadingZeroBits( ulScaled ) ), METRICS_BUCKET_COUNT );
+    }
+
+    /* Relaxed ordering is enough: each counter is only ever read as a snapshot. */
+    Buckets[ iBucket ].fetch_add( 1, std::memory_order_relaxed );
+    ulCount.fetch_add( 1, std::memory_order_relaxed );
+    ulSumNs.fetch_add( ulNs, std::memory_order_relaxed );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+quint64 LatencyHistogram::count() const
+{
+    return ulCount.load( std::memory_order_relaxed );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+quint64 LatencyHistogram::sumNs() const
+{
+    return ulSumNs.load( std::memory_order_relaxed );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+quint64 LatencyHistogram::bucketCount( const int & iBucket ) const
+{
+    if ( ( 0 > iBucket ) || ( METRICS_BUCKET_COUNT < iBucket ) )
+    {
+        return 0;
+    }
+
+    return Buckets[ iBucket ].load( std::memory_order_relaxed );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+qint64 LatencyHistogram::percentileNs( const double & dPercentile ) const
+{
+    const quint64 ulTotal = count();
+    quint64 ulTarget = 0;
+    quint64 ulSeen = 0;
+
+    if ( 0 == ulTotal )
+    {
+        return 0;
+    }
+
+    /* Report the upper bound of the bucket holding the requested rank, computed in 64 bits since the counters may
+     * outgrow an int. */
+    ulTarget = qMax( Q_UINT64_C( 1 ),
+                     static_cast<quint64>( std::ceil( dPercentile * static_cast<double>( ulTotal ) ) ) );
+    for ( int i = 0; i < METRICS_BUCKET_COUNT; i++ )
+    {
+        ulSeen += bucketCount( i );
+        if ( ulTarget <= ulSeen )
+        {
+            return bucketBoundNs( i );
+        }
+    }
+
+    /* The overflow bucket has no upper bound, so report the last finite one, which the value is known to exceed. */
+    return bucketBoundNs( METRICS_BUCKET_COUNT - 1 );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+qint64 LatencyHistogram::bucketBoundNs( const int & iBucket )
+{
+    if ( METRICS_BUCKET_COUNT <= iBucket )
+    {
+        return std::numeric_limits<qint64>::max();
+    }
+
+    return static_cast<qint64>( METRICS_FIRST_BUCKET_NS ) << iBucket;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+EndpointMetrics::EndpointMetrics()
+{
+    ulRequests.store( 0, std::memory_order_relaxed );
+    ulErrors.store( 0, std::memory_order_relaxed );
+    ulBytesSent.store( 0, std::memory_order_relaxed );
+    ulBytesReceived.store( 0, std::memory_order_relaxed );
+    for ( std::atomic<quint64> & Status : Statuses )
+    {
+        Status.store( 0, std::memory_order_relaxed );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+TapMetrics::TapMetrics()
+{
+    ulCacheHits.store( 0, std::memory_order_relaxed );
+    ulCoalesced.store( 0, std::memory_order_relaxed );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void NetworkMetrics::recordRequest( const Endpoint & eEndpoint, const qint64 & iBytesSent )
+{
+    EndpointMetrics & Metrics = Endpoints[ static_cast<int>( eEndpoint ) ];
+
+    Metrics.ulRequests.fetch_add( 1, std::memory_order_relaxed );
+    Metrics.ulBytesSent.fetch_add( static_cast<quint64>( qMax( Q_INT64_C( 0 ), iBytesSent ) ), std::memory_order_relaxed );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void NetworkMetrics::recordReply( const Endpoint & eEndpoint,
+                                  const RequestTiming & Timing,
+                                  const qint64 & iFinishedNs,
+                                  const int & iStatusCode,
+                                  const bool & bError,
+                                  const qint64 & iBytesReceived )
+{
+    EndpointMetrics & Metrics = Endpoints[ static_cast<int>( eEndpoint ) ];
+    const int iStatusClass = ( ( 100 <= iStatusCode ) && ( 600 > iStatusCode ) ) ? iStatusCode / 100 : 0;
+
+    /* Replies without any body never saw a first byte; count their whole wait as time to first byte. */
+    const qint64 iFirstByteNs = ( 0 <= Timing.iFirstByteNs ) ? Timing.iFirstByteNs : iFinishedNs;
+
+    if ( 0 <= Timing.iHandedOffNs )
+    {
+        Metrics.Stages[ static_cast<int>( Stage::Queue ) ].record( Timing.iHandedOffNs );
+        Metrics.Stages[ static_cast<int>( Stage::FirstByte ) ].record( iFirstByteNs - Timing.iHandedOffNs );
+        Metrics.Stages[ static_cast<int>( Stage::Transfer ) ].record( iFinishedNs - iFirstByteNs );
+    }
+    Metrics.Stages[ static_cast<int>( Stage::Parse ) ].record( Timing.iParseNs );
+    Metrics.Stages[ static_cast<int>( Stage::Publish ) ].record( Timing.iPublishNs );
+
+    Metrics.Statuses[ iStatusClass ].fetch_add( 1, std::memory_order_relaxed );
+    Metrics.ulBytesReceived.fetch_add( static_cast<quint64>( qMax( Q_INT64_C( 0 ), iBytesReceived ) ),
+                                       std::memory_order_relaxed );
+    if ( bError )
+    {
+        Metrics.ulErrors.fetch_add( 1, std::memory_order_relaxed );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void NetworkMetrics::recordTap( const qint64 & iLatencyNs, const bool & bCacheHit )
+{
+    Taps.TapToPlayer.record( iLatencyNs );
+    if ( bCacheHit )
+    {
+        Taps.ulCacheHits.fetch_add( 1, std::memory_order_relaxed );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void NetworkMetrics::recordCoalesced()
+{
+    Taps.ulCoalesced.fetch_add( 1, std::memory_order_relaxed );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+const EndpointMetrics & NetworkMetrics::endpoint( const Endpoint & eEndpoint ) const
+{
+    return Endpoints[ static_cast<int>( eEndpoint ) ];
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+const TapMetrics & NetworkMetrics::taps() const
+{
+    return Taps;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void NetworkMetrics::publish( DataStore * pStore, const QString & sPrefix ) const
+{
+    for ( int i = 0; i < static_cast<int>( Endpoint::Count ); i++ )
+    {
+        const EndpointMetrics & Metrics = Endpoints[ i ];
+        const QString sEndpoint = sPrefix + "." + QString::fromLatin1( EndpointTable[ i ].pcName );
+
+        /* Skip endpoints that were never used to keep the model small. */
+        if ( 0 == Metrics.ulRequests.load( std::memory_order_relaxed ) )
+        {
+            continue;
+        }
+
+        pStore->insert( DataPoint( sEndpoint + ".requests", QVariant( Metrics.ulRequests.load() ) ) );
+        pStore->insert( DataPoint( sEndpoint + ".errors", QVariant( Metrics.ulErrors.load() ) ) );
+        pStore->insert( DataPoint( sEndpoint + ".bytesSent", QVariant( Metrics.ulBytesSent.load() ) ) );
+        pStore->insert( DataPoint( sEndpoint + ".bytesReceived", QVariant( Metrics.ulBytesReceived.load() ) ) );
+
+        /* Latencies are published in microseconds. */
+        for ( int j = 0; j < static_cast<int>( Stage::Count ); j++ )
+        {
+            const LatencyHistogram & Histogram = Metrics.Stages[ j ];
+            const QString sStage = sEndpoint + "." + QString::fromLatin1( stageName( static_cast<Stage>( j ) ) );
+
+            pStore->insert( DataPoint( sStage + ".count", QVariant( Histogram.count() ) ) );
+            pStore->insert( DataPoint( sStage + ".p50", QVariant( Histogram.percentileNs( 0.5 ) / 1000 ) ) );
+            pStore->insert( DataPoint( sStage + ".p99", QVariant( Histogram.percentileNs( 0.99 ) / 1000 ) ) );
+        }
+    }
+
+    /* Tap-to-player latency only exists with tap prefetching enabled. */
+    if ( 0 < Taps.TapToPlayer.count() )
+    {
+        pStore->insert( DataPoint( sPrefix + ".tap.count", QVariant( Taps.TapToPlayer.count() ) ) );
+        pStore->insert( DataPoint( sPrefix + ".tap.cacheHits", QVariant( Taps.ulCacheHits.load() ) ) );
+        pStore->insert( DataPoint( sPrefix + ".tap.coalesced", QVariant( Taps.ulCoalesced.load() ) ) );
+        pStore->insert( DataPoint( sPrefix + ".tap.p50", QVariant( Taps.TapToPlayer.percentileNs( 0.5 ) / 1000 ) ) );
+        pStore->insert( DataPoint( sPrefix + ".tap.p99", QVariant( Taps.TapToPlayer.percentileNs( 0.99 ) / 1000 ) ) );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+QString NetworkMetrics::toPrometheus() const
+{
+    QString sText;
+    QString sLabels;
+    quint64 ulCumulative = 0;
+
+    sText.append( "# HELP bcon_network_stage_seconds Time spent in each stage of a request.\n"
+                  "# TYPE bcon_network_stage_seconds histogram\n" );
+    for ( int i = 0; i < static_cast<int>( Endpoint::Count ); i++ )
+    {
+        if ( 0 == Endpoints[ i ].ulRequests.load( std::memory_order_relaxed ) )
+        {
+            continue;
+        }
+
+        for ( int j = 0; j < static_cast<int>( Stage::Count ); j++ )
+        {
+            const LatencyHistogram & Histogram = Endpoints[ i ].Stages[ j ];
+
+            sLabels = QString( "endpoint=\"%1\",stage=\"%2\"" ).arg( EndpointTable[ i ].pcName,
+                                                                     stageName( static_cast<Stage>( j ) ) );
+            ulCumulative = 0;
+            for ( int k = 0; k < METRICS_BUCKET_COUNT; k++ )
+            {
+                ulCumulative += Histogram.bucketCount( k );
+                sText.append( QString( "bcon_network_stage_seconds_bucket{%1,le=\"%2\"} %3\n" )
+                              .arg( sLabels )
+                              .arg( static_cast<double>( LatencyHistogram::bucketBoundNs( k ) ) / 1e9 )
+                              .arg( ulCumulative ) );
+            }
+            sText.append( QString( "bcon_network_stage_seconds_bucket{%1,le=\"+Inf\"} %2\n" ).arg( sLabels ).arg( Histogram.count() ) );
+            sText.append( QString( "bcon_network_stage_seconds_sum{%1} %2\n" )
+                          .arg( sLabels )
+                          .arg( static_cast<double>( Histogram.sumNs() ) / 1e9 ) );
+            sText.append( QString( "bcon_network_stage_seconds_count{%1} %2\n" ).arg( sLabels ).arg( Histogram.count() ) );
+        }
+    }
+
+    sText.append( "# HELP bcon_network_requests_total Requests sent.\n"
+                  "# TYPE bcon_network_requests_total counter\n" );
+    for ( int i = 0; i < static_cast<int>( Endpoint::Count ); i++ )
+    {
+        sText.append( QString( "bcon_network_requests_total{endpoint=\"%1\"} %2\n" )
+                      .arg( EndpointTable[ i ].pcName )
+                      .arg( Endpoints[ i ].ulRequests.load( std::memory_order_relaxed ) ) );
+    }
+
+    sText.append( "# HELP bcon_network_errors_total Requests that failed or were rejected.\n"
+                  "# TYPE bcon_network_errors_total counter\n" );
+    for ( int i = 0; i < static_cast<int>( Endpoint::Count ); i++ )
+    {
+        sText.append( QString( "bcon_network_errors_total{endpoint=\"%1\"} %2\n" )
+                      .arg( EndpointTable[ i ].pcName )
+                      .arg( Endpoints[ i ].ulErrors.load( std::memory_order_relaxed ) ) );
+    }
+
+    sText.append( "# HELP bcon_network_sent_bytes_total Request body bytes sent.\n"
+                  "# TYPE bcon_network_sent_bytes_total counter\n" );
+    for ( int i = 0; i < static_cast<int>( Endpoint::Count ); i++ )
+    {
+        sText.append( QString( "bcon_network_sent_bytes_total{endpoint=\"%1\"} %2\n" )
+                      .arg( EndpointTable[ i ].pcName )
+                      .arg( Endpoints[ i ].ulBytesSent.load( std::memory_order_relaxed ) ) );
+    }
+
+    sText.append( "# HELP bcon_network_received_bytes_total Reply body bytes received.\n"
+                  "# TYPE bcon_network_received_bytes_total counter\n" );
+    for ( int i = 0; i < static_cast<int>( Endpoint::Count ); i++ )
+    {
+        sText.append( QString( "bcon_network_received_bytes_total{endpoint=\"%1\"} %2\n" )
+                      .arg( EndpointTable[ i ].pcName )
+                      .arg( Endpoints[ i ].ulBytesReceived.load( std::memory_order_relaxed ) ) );
+    }
+
+    sText.append( "# HELP bcon_network_responses_total Replies by status class.\n"
+                  "# TYPE bcon_network_responses_total counter\n" );
+    for ( int i = 0; i < static_cast<int>( Endpoint::Count ); i++ )
+    {
+        for ( int j = 0; j < 6; j++ )
+        {
+            sText.append( QString( "bcon_network_responses_total{endpoint=\"%1\",code=\"%2\"} %3\n" )
+                          .arg( EndpointTable[ i ].pcName )
+                          .arg( ( 0 < j ) ? QString( "%1xx" ).arg( j ) : QString( "none" ) )
+                          .arg( Endpoints[ i ].Statuses[ j ].load( std::memory_order_relaxed ) ) );
+        }
+    }
+
+    if ( 0 < Taps.TapToPlayer.count() )
+    {
+        sText.append( "# HELP bcon_tap_to_player_seconds Time from a card tap to its player's data being published.\n"
+                      "# TYPE bcon_tap_to_player_seconds histogram\n" );
+        ulCumulative = 0;
+        for ( int k = 0; k < METRICS_BUCKET_COUNT; k++ )
+        {
+            ulCumulative += Taps.TapToPlayer.bucketCount( k );
+            sText.append( QString( "bcon_tap_to_player_seconds_bucket{le=\"%1\"} %2\n" )
+                          .arg( static_cast<double>( LatencyHistogram::bucketBoundNs( k ) ) / 1e9 )
+                          .arg( ulCumulative ) );
+        }
+        sText.append( QString( "bcon_tap_to_player_seconds_bucket{le=\"+Inf\"} %1\n" ).arg( Taps.TapToPlayer.count() ) );
+        sText.append( QString( "bcon_tap_to_player_seconds_sum %1\n" )
+                      .arg( static_cast<double>( Taps.TapToPlayer.sumNs() ) / 1e9 ) );
+        sText.append( QString( "bcon_tap_to_player_seconds_count %1\n" ).arg( Taps.TapToPlayer.count() ) );
+
+        sText.append( "# HELP bcon_tap_cache_hits_total Taps answered from the player cache.\n"
+                      "# TYPE bcon_tap_cache_hits_total counter\n" );
+        sText.append( QString( "bcon_tap_cache_hits_total %1\n" ).arg( Taps.ulCacheHits.load( std::memory_order_relaxed ) ) );
+
+        sText.append( "# HELP bcon_tap_coalesced_total Player requests folded into one already in flight.\n"
+                      "# TYPE bcon_tap_coalesced_total counter\n" );
+        sText.append( QString( "bcon_tap_coalesced_total %1\n" )
+                      .arg( Taps.ulCoalesced.load( std::memory_order_relaxed ) ) );
+    }
+
+    return sText;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+const char * NetworkMetrics::stageName( const Stage & eStage )
+{
+    switch ( eStage )
+    {
+    case Stage::Queue:
+        return "queue";
+
+    case Stage::FirstByte:
+        return "firstByte";
+
+    case Stage::Transfer:
+        return "transfer";
+
+    case Stage::Parse:
+        return "parse";
+
+    case Stage::Publish:
+        return "publish";
+
+    default:
+        return "unknown";
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,113 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QString>
+#include <atomic>
+
+#include "endpoints.h"
+
+class DataStore;
+
+#define METRICS_BUCKET_COUNT        20      // Finite buckets, each bound twice the previous
+#define METRICS_FIRST_BUCKET_NS     50000   // Upper bound of the first bucket (50 us)
+
+enum class Stage
+{
+    Queue,      // Request made until handed to Qt (serialization and compression)
+    FirstByte,  // Handed to Qt until the first reply data, including connection setup and server time
+    Transfer,   // First reply data until the reply finished
+    Parse,      // Parsing and flattening the body
+    Publish,    // Publishing the data points to the DataStore and its subscribers
+    Count
+};
+
+class RequestTiming
+{
+public:
+    qint64 iHandedOffNs = -1;   // Offsets from the start of the request
+    qint64 iFirstByteNs = -1;
+    qint64 iParseNs = 0;        // Durations
+    qint64 iPublishNs = 0;      // With a worker thread, only the time to queue the points to the DataStore's thread
+};
+
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void record( const qint64 & iNs );
+
+    quint64 count() const;
+    quint64 sumNs() const;
+    quint64 bucketCount( const int & iBucket ) const;
+    qint64 percentileNs( const double & dPercentile ) const;
+
+    static qint64 bucketBoundNs( const int & iBucket );
+
+private:
+    Q_DISABLE_COPY( LatencyHistogram )
+
+    std::atomic<quint64> Buckets[ METRICS_BUCKET_COUNT + 1 ];   // The last bucket catches everything above the bounds
+    std::atomic<quint64> ulCount;
+    std::atomic<quint64> ulSumNs;
+};
+
+class EndpointMetrics
+{
+public:
+    EndpointMetrics();
+
+    LatencyHistogram Stages[ static_cast<int>( Stage::Count ) ];
+    std::atomic<quint64> ulRequests;
+    std::atomic<quint64> ulErrors;          // Network errors, error statuses and rejected replies
+    std::atomic<quint64> ulBytesSent;       // Request bodies as sent
+    std::atomic<quint64> ulBytesReceived;   // Reply bodies as received
+    std::atomic<quint64> Statuses[ 6 ];     // By status class (1xx to 5xx), index zero for replies without a status
+
+private:
+    Q_DISABLE_COPY( EndpointMetrics )
+};
+
+class TapMetrics
+{
+public:
+    TapMetrics();
+
+    LatencyHistogram TapToPlayer;           // Card state change seen until the player's data points were published
+    std::atomic<quint64> ulCacheHits;       // Taps answered from the player cache without a request
+    std::atomic<quint64> ulCoalesced;       // Player requests folded into one already in flight
+
+private:
+    Q_DISABLE_COPY( TapMetrics )
+};
+
+class NetworkMetrics
+{
+public:
+    NetworkMetrics() = default;
+
+    void recordRequest( const Endpoint & eEndpoint, const qint64 & iBytesSent );
+    void recordReply( const Endpoint & eEndpoint,
+                      const RequestTiming & Timing,
+                      const qint64 & iFinishedNs,
+                      const int & iStatusCode,
+                      const bool & bError,
+                      const qint64 & iBytesReceived );
+    void recordTap( const qint64 & iLatencyNs, const bool & bCacheHit );
+    void recordCoalesced();
+
+    const EndpointMetrics & endpoint( const Endpoint & eEndpoint ) const;
+    const TapMetrics & taps() const;
+    void publish( DataStore * pStore, const QString & sPrefix ) const;
+    QString toPrometheus() const;
+
+    static const char * stageName( const Stage & eStage );
+
+private:
+    Q_DISABLE_COPY( NetworkMetrics )
+
+    EndpointMetrics Endpoints[ static_cast<int>( Endpoint::Count ) ];
+    TapMetrics Taps;
+};
+
+#endif // METRICS_H
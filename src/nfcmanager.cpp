@@ -1,17 +1,24 @@
 #include <QCoreApplication>
+#include <QDateTime>
 #include <QDebug>
+#include <QMutexLocker>
+#include <cstring>
 
+#include "cardrecord.h"
 #include "datastore.h"
 #include "nfcmanager.h"
+#include "tracer.h"
 /*--------------------------------------------------------------------------------------------------------------------*/
 
 static NFCManager *pInstance = nullptr;
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-NFCManager::NFCManager( QObject * pParent ) : QObject( pParent )
+NFCManager::NFCManager( DataStore * pStore, QObject * pParent ) : QObject( pParent )
 {
+    /* Without a store of its own, the manager publishes into the process-wide one. */
+    this->pStore = ( nullptr != pStore ) ? pStore : DataStore::instance();
     hContext = 0;
-    pcReaderName = nullptr;
+    pBackend = PCSCBackend::system();
     pWorkerThread = nullptr;
     sCurrentId = "";
 
@@ -20,6 +27,12 @@ NFCManager::NFCManager( QObject * pParent ) : QObject( pParent )
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
+NFCManager::~NFCManager()
+{
+    cleanupBeforeQuit();
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
 NFCManager * NFCManager::instance()
 {
     if ( nullptr == pInstance )
@@ -31,9 +44,16 @@ NFCManager * NFCManager::instance()
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-QString NFCManager::getCurrentId()
+QString NFCManager::getCurrentId( const QString & sReader )
 {
-    return sCurrentId;
+    /* Without a reader, report the most recent tap on any of them. */
+    return sReader.isEmpty() ? sCurrentId : CurrentIds.value( sReader );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+QStringList NFCManager::getReaders() const
+{
+    return Readers;
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
@@ -42,19 +62,17 @@ bool NFCManager::nfcManagerInit()
     bool bReturn = false;
 
     /* Create the card context. */
-    if ( SCARD_S_SUCCESS == SCardEstablishContext( SCARD_SCOPE_SYSTEM, nullptr, nullptr, &hContext ) )
+    if ( SCARD_S_SUCCESS == pBackend->establishContext( &hContext ) )
     {
-        /* Attempt to get the reader name. */
-        if ( getReaderName() )
-        {
-            /* Start the worker thread. */
-            bReturn = startWorker();
-        }
-        else
+        /* Readers can be attached later, so start watching even when none are present yet. */
+        on_readersChanged( listReaders( pBackend, hContext ) );
+        if ( Readers.isEmpty() )
         {
-            /* Failed to find the reader. */
-            bReturn = false;
+            qDebug() << "NFCManager::nfcManagerInit found no readers, waiting for one to be attached.";
         }
+
+        /* Start the worker thread. */
+        bReturn = startWorker();
     }
     else
     {
@@ -66,60 +84,104 @@ bool NFCManager::nfcManagerInit()
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-bool NFCManager::getReaderName()
+void NFCManager::setCardRecords( const bool & bEnabled )
 {
-#ifdef __APPLE__
-    unsigned int uiLength = 0;
-#else
-    unsigned long uiLength = 0; // Improper variable name prefix!
-#endif
-    bool bReturn = false;
+    /* Read the player record kept on each card as it is tapped, and allow writing it. */
+    bCardRecords = bEnabled;
+    if ( nullptr != pWorkerThread )
+    {
+        pWorkerThread->setCardRecords( bEnabled );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool NFCManager::cardRecordsEnabled() const
+{
+    /* Read from the network thread, i.e. after every publishPlayerStats() reply. */
+    return bCardRecords.load();
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
 
-    /* If necessary, free previously-allocated memory. */
-    if ( nullptr != pcReaderName )
+void NFCManager::writeCardRecord( const QString & sId, const QVariantMap & Record )
+{
+    /* May be called from any thread (i.e. the network thread). */
+    if ( QThread::currentThread() != thread() )
     {
-        free( pcReaderName );
-        pcReaderName = nullptr;
+        QMetaObject::invokeMethod( this, [ = ]() { writeCardRecord( sId, Record ); }, Qt::QueuedConnection );
+        return;
     }
 
-    /* Make the first request for the reader list with a null buffer to get the number of bytes to allocate. */
-    if ( SCARD_S_SUCCESS == SCardListReaders( hContext, nullptr, nullptr, &uiLength ) )
+    /* Written right away if the card is still on a reader, otherwise on its next tap. */
+    if ( ( bCardRecords.load() ) && ( nullptr != pWorkerThread ) )
     {
-        /* Allocate space for the string with the returned buffer length. */
-        pcReaderName = static_cast<char *>( malloc( uiLength * sizeof( char ) ) );
+        pWorkerThread->queueRecordWrite( sId, Record );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void NFCManager::setBackend( PCSCBackend * pBackend )
+{
+    /* Takes effect on the next nfcManagerInit(); the backend is not owned and must outlive the manager. */
+    this->pBackend = ( nullptr != pBackend ) ? pBackend : PCSCBackend::system();
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+QStringList NFCManager::listReaders( PCSCBackend * pBackend, const SCARDCONTEXT & hContext )
+{
+    DWORD ulLength = 0;
+    QStringList Names;
+    QByteArray Buffer;
+    int iStart = 0;
+    int iEnd = 0;
 
-        /* Ensure the allocation was successful. */
-        if ( nullptr != pcReaderName )
+    /* Make the first request for the reader list with a null buffer to get the number of bytes to allocate. */
+    if ( SCARD_S_SUCCESS == pBackend->listReaders( hContext, nullptr, &ulLength ) )
+    {
+        /* Now pass in the buffer to get the names. */
+        Buffer.fill( '\0', static_cast<int>( ulLength ) );
+        if ( SCARD_S_SUCCESS == pBackend->listReaders( hContext, Buffer.data(), &ulLength ) )
         {
-            /* Now pass in the buffer to get the name. */
-            *pcReaderName = '\0';
-            if ( SCARD_S_SUCCESS == SCardListReaders( hContext, nullptr, pcReaderName, &uiLength ) )
-            {
-                qDebug() << "Detected reader:" << pcReaderName;
-                bReturn = true;
-            }
-            else
+            /* The names are packed one after another, each null-terminated, with an empty name at the end. */
+            while ( ( iStart < Buffer.size() ) && ( '\0' != Buffer.at( iStart ) ) )
             {
-                /* Failed to get name. */
-                qDebug() << "NFCManager::bGetReader failed to get the reader name.";
-                bReturn = false;
+                iEnd = Buffer.indexOf( '\0', iStart );
+                if ( 0 > iEnd )
+                {
+                    iEnd = Buffer.size();
+                }
+                Names.append( QString::fromLocal8Bit( Buffer.constData() + iStart, iEnd - iStart ) );
+                iStart = iEnd + 1;
             }
         }
         else
         {
-            /* Out of memory. */
-            qDebug() << "NFCManager::bGetReader ran out of memory!";
-            bReturn = false;
+            /* The list changed between the two calls; the next refresh picks it up. */
+            qDebug() << "NFCManager::listReaders failed to get the reader names.";
         }
     }
     else
     {
-        /* No readers detected. */
-        qDebug() << "NFCManager::bGetReader failed to detect reader.";
-        bReturn = false;
+        /* No readers detected (SCARD_E_NO_READERS_AVAILABLE), or the service is unavailable. */
     }
 
-    return bReturn;
+    return Names;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+int NFCManager::readerIndex( const QString & sReader )
+{
+    int iIndex = KnownReaders.indexOf( sReader );
+
+    /* Readers keep their index when unplugged, so tags stay stable when one is plugged back in. */
+    if ( 0 > iIndex )
+    {
+        iIndex = KnownReaders.size();
+        KnownReaders.append( sReader );
+        pStore->insert( DataPoint( "Card.Readers." + QString::number( iIndex ) + ".Name", QVariant( sReader ) ) );
+        pStore->insert( DataPoint( "Card.Readers.length", QVariant( KnownReaders.size() ) ) );
+    }
+
+    return iIndex;
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
@@ -128,21 +190,32 @@ bool NFCManager::startWorker()
     /* Kill any existing threads. */
     if ( nullptr != pWorkerThread )
     {
-        pWorkerThread->terminate();
-        pWorkerThread->wait();
+        pWorkerThread->stop();
         pWorkerThread = nullptr;
     }
 
     /* Set up the thread to offload polling for events. */
     pWorkerThread = new NFCWorker();
+    pWorkerThread->setBackend( pBackend );
     pWorkerThread->setContext( hContext );
-    pWorkerThread->setReaderName( pcReaderName );
+    pWorkerThread->setStats( &Stats );
+    pWorkerThread->setCardRecords( bCardRecords );
     connect( pWorkerThread, SIGNAL( finished() ), pWorkerThread, SLOT( deleteLater() ) );
 
-    /* Wire up relevant signals. */
-    connect( pWorkerThread, SIGNAL( cardInserted() ), this, SLOT( on_cardInserted() ) );
-    connect( pWorkerThread, SIGNAL( cardRemoved() ), this, SLOT( on_cardRemoved() ) );
-    connect( pWorkerThread, SIGNAL( cardRead( const QString & ) ), this, SLOT( on_cardRead( const QString & ) ) );
+    /* Wire up relevant signals. The early UID notification is forwarded straight from the worker's thread, and is
+     * connected first so anything it starts is queued ahead of cardRead. */
+    connect( pWorkerThread, SIGNAL( cardDecoded( const QString &, const QString &, const qint64 & ) ),
+             this, SIGNAL( cardDecoded( const QString &, const QString &, const qint64 & ) ), Qt::DirectConnection );
+    connect( pWorkerThread, SIGNAL( cardInserted( const QString & ) ), this, SLOT( on_cardInserted( const QString & ) ) );
+    connect( pWorkerThread, SIGNAL( cardRemoved( const QString & ) ), this, SLOT( on_cardRemoved( const QString & ) ) );
+    connect( pWorkerThread, SIGNAL( cardRead( const QString &, const QString & ) ),
+             this, SLOT( on_cardRead( const QString &, const QString & ) ) );
+    connect( pWorkerThread, SIGNAL( cardRecordRead( const QString &, const QString &, const QVariantMap & ) ),
+             this, SLOT( on_cardRecordRead( const QString &, const QString &, const QVariantMap & ) ) );
+    connect( pWorkerThread, SIGNAL( cardRecordWritten( const QString &, const bool & ) ),
+             this, SIGNAL( cardRecordWritten( const QString &, const bool & ) ) );
+    connect( pWorkerThread, SIGNAL( readersChanged( const QStringList & ) ),
+             this, SLOT( on_readersChanged( const QStringList & ) ) );
 
     /* Start watching for events. */
     pWorkerThread->start();
@@ -151,218 +224,769 @@ bool NFCManager::startWorker()
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void NFCManager::on_cardInserted()
+void NFCManager::on_cardInserted( const QString & sReader )
 {
     /* Pass the signal out. */
+    emit readerCardInserted( sReader );
     emit cardInserted();
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void NFCManager::on_cardRemoved()
+void NFCManager::on_cardRemoved( const QString & sReader )
 {
+    CurrentIds.remove( sReader );
+    pStore->insert( DataPoint( "Card.Readers." + QString::number( readerIndex( sReader ) ) + ".UID",
+                               QVariant( QString() ) ) );
+
+    emit readerCardRemoved( sReader );
     emit cardRemoved();
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void NFCManager::on_cardRead( const QString & sId )
+void NFCManager::on_readersChanged( const QStringList & Readers )
 {
-    /* Publish a data point with the card UID. */
-    DataStore::publish( DataPoint( "Card.UID", QVariant( sId ) ) );
+    qDebug() << "Detected readers:" << Readers;
 
-    emit cardRead( sId );
+    /* Assign each new reader its index (and publish its name) before any of its taps arrive. */
+    this->Readers = Readers;
+    for ( const QString & sReader : Readers )
+    {
+        ( void )readerIndex( sReader );
+    }
+
+    emit readersChanged( Readers );
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void NFCManager::cleanupBeforeQuit()
+const NFCStats & NFCManager::getStats() const
 {
-    pWorkerThread->terminate();
-    pWorkerThread->wait();
-    ( void )SCardReleaseContext( hContext );
+    return Stats;
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void NFCWorker::run()
+void NFCManager::on_cardRead( const QString & sReader, const QString & sId )
 {
-    unsigned int uiStatusReturnCode = SCARD_S_SUCCESS;
-    bActive = true;
+    /* Continue the trace started by the worker for this tap, so requests made by subscribers are linked to it. */
+    CorrelationScope Tap( Tracer::takeCorrelation( sId ) );
+    TraceSpan Span( "cardRead", "nfc" );
 
-    /* Allocate the state struct. */
-    pxReaderState = static_cast<SCARD_READERSTATE *>( calloc( 1, sizeof( *pxReaderState ) ) );
-    if ( nullptr != pxReaderState )
+    /* Time from the worker seeing the card to the UID reaching this thread. */
+    Stats.DispatchLatency.record( Tracer::now() - Stats.iLastChangeNs.load( std::memory_order_relaxed ) );
+
+    sCurrentId = sId;
+    CurrentIds.insert( sReader, sId );
+
+    /* Publish the card UID for the reader it was tapped on, and as the most recent tap on any reader. */
+    pStore->insert( DataPoint( "Card.Readers." + QString::number( readerIndex( sReader ) ) + ".UID",
+                               QVariant( sId ) ) );
+    pStore->insert( DataPoint( "Card.UID", QVariant( sId ) ) );
+
+    emit readerCardRead( sReader, sId );
+    emit cardRead( sId );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void NFCManager::on_cardRecordRead( const QString & sReader, const QString & sId, const QVariantMap & Record )
+{
+    QList<DataPoint> Points;
+
+    /* Provisional until the backend answers with the player itself (player.*). */
+    Points.append( DataPoint( "Card.Player.playerId", QVariant( sId ) ) );
+    for ( QVariantMap::const_iterator Iterator = Record.begin(); Iterator != Record.end(); ++Iterator )
     {
-        /* Set the initial state to unknown. */
-        pxReaderState->szReader = pcReaderName;
-        pxReaderState->dwCurrentState = SCARD_STATE_UNAWARE;
+        Points.append( DataPoint( "Card.Player." + Iterator.key(), Iterator.value() ) );
     }
-    else
+    Points.append( DataPoint( "Card.Player.provisional", QVariant( true ) ) );
+    pStore->insertBatch( Points );
+
+    emit cardRecordRead( sReader, sId, Record );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void NFCManager::cleanupBeforeQuit()
+{
+    /* The worker is woken from its wait, so this returns promptly. */
+    if ( nullptr != pWorkerThread )
+    {
+        pWorkerThread->stop();
+        pWorkerThread = nullptr;
+    }
+
+    /* Also runs on destruction, so only release a context once. */
+    if ( 0 != hContext )
     {
-        /* Out of memory. */
-        qDebug() << "NFCWorker::run ran out of memory!";
-        exit( -1 );
+        ( void )pBackend->releaseContext( hContext );
+        hContext = 0;
     }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
 
-    /* Wait for events. */
+void NFCWorker::run()
+{
+    unsigned int uiStatusReturnCode = SCARD_S_SUCCESS;
+    qint64 iChangeNs = 0;
+    bool bChanged = false;
+    bool bReadersChanged = false;
+    int iReaderCount = 0;
+
+    /* Watch the plug-and-play pseudo-reader when the PC/SC service offers it, otherwise re-list the readers on a
+     * timeout. */
+    bPnPSupported = detectPnP();
+    refreshReaders();
+
+    /* Wait for events. The call blocks until any reader changes state, a reader is attached or detached, or
+     * terminate() cancels it. */
     while ( bActive )
     {
-        /* Nothing requested, just wait. */
-        uiStatusReturnCode = static_cast<unsigned int>( SCardGetStatusChange( hContext, EVENT_TIMEOUT_MS,
-                                                                              pxReaderState, 1 ) );
+        /* Nothing to wait on, so check for readers again after a pause. */
+        if ( ReaderStates.isEmpty() )
+        {
+            BackoffMutex.lock();
+            if ( bActive )
+            {
+                BackoffCondition.wait( &BackoffMutex, POLLING_INTERVAL_MS );
+            }
+            BackoffMutex.unlock();
+            refreshReaders();
+            continue;
+        }
+
+        /* Records queued for cards still on a reader are written before waiting; queueing one also wakes the wait. */
+        flushWrites();
+
+        uiStatusReturnCode = static_cast<unsigned int>(
+                    pBackend->getStatusChange( hContext, bPnPSupported ? EVENT_TIMEOUT_MS : POLLING_INTERVAL_MS,
+                                               ReaderStates.data(), static_cast<DWORD>( ReaderStates.size() ) ) );
+        iChangeNs = Tracer::now();
+        if ( nullptr != pStats )
+        {
+            pStats->ulWakeups.fetch_add( 1, std::memory_order_relaxed );
+        }
 
         /* Examine the return code. */
         if ( SCARD_S_SUCCESS == uiStatusReturnCode )
         {
-            /* Ensure there is actually a change to process. */
-            if ( ( pxReaderState->dwCurrentState == pxReaderState->dwEventState )
-                 || ( !( pxReaderState->dwEventState & SCARD_STATE_CHANGED ) ) )
+            bChanged = false;
+            bReadersChanged = false;
+            iReaderCount = ReaderNames.size();
+
+            for ( int i = 0; i != ReaderStates.size(); i++ )
             {
-                return;
-            }
+                SCARD_READERSTATE & State = ReaderStates[ i ];
 
-            /* Update the current state to be the new one. */
-            pxReaderState->dwCurrentState = pxReaderState->dwEventState;
+                /* Skip entries that carry no actual change. */
+                if ( ( State.dwCurrentState == State.dwEventState )
+                     || ( !( State.dwEventState & SCARD_STATE_CHANGED ) ) )
+                {
+                    continue;
+                }
+                bChanged = true;
 
-            if ( pxReaderState->dwEventState & SCARD_STATE_EMPTY )
-            {
-                emit cardRemoved();
+                if ( i == iReaderCount )
+                {
+                    /* The plug-and-play entry, a reader was attached or detached. */
+                    State.dwCurrentState = State.dwEventState;
+                    bReadersChanged = true;
+                }
+                else if ( State.dwEventState & ( SCARD_STATE_UNKNOWN | SCARD_STATE_IGNORE ) )
+                {
+                    /* The reader itself went away. */
+                    bReadersChanged = true;
+                }
+                else
+                {
+                    handleReaderEvent( State, iChangeNs );
+                }
             }
 
-            if ( pxReaderState->dwEventState & SCARD_STATE_PRESENT )
+            if ( ( !bChanged ) && ( nullptr != pStats ) )
             {
-                emit cardInserted();
+                pStats->ulSpuriousWakeups.fetch_add( 1, std::memory_order_relaxed );
+            }
 
-                if ( !readId() )
-                {
-                    qDebug() << "NFCWorker::run failed to read ID from card!";
-                }
+            if ( bReadersChanged )
+            {
+                refreshReaders();
             }
         }
-        else if ( SCARD_E_TIMEOUT != uiStatusReturnCode )
+        else if ( SCARD_E_CANCELLED == uiStatusReturnCode )
         {
-            /* Unexpected return code, stop. */
-            qDebug() << "NFCWorker::run got unexpected return code:" << uiStatusReturnCode;
+            /* Woken up on purpose, either to stop or to re-check the configuration. */
+        }
+        else if ( SCARD_E_TIMEOUT == uiStatusReturnCode )
+        {
+            /* Without plug-and-play notification, check whether the readers changed. With it, the bound on the wait
+             * only catches a cancel that came in just before the wait began, and the loop picks that up. */
+            if ( !bPnPSupported )
+            {
+                refreshReaders();
+            }
+        }
+        else if ( ( SCARD_E_UNKNOWN_READER == uiStatusReturnCode )
+                  || ( SCARD_E_NO_READERS_AVAILABLE == uiStatusReturnCode ) )
+        {
+            /* A reader was detached before the change could be reported on its entry. */
+            refreshReaders();
         }
         else
         {
-            /* Timeout, wait for another potential event. */
+            /* Unexpected return code (i.e. the PC/SC service went away). These return immediately, so pause before
+             * retrying rather than spinning; terminate() cuts the pause short. */
+            qDebug() << "NFCWorker::run got unexpected return code:" << uiStatusReturnCode;
+            if ( nullptr != pStats )
+            {
+                pStats->ulErrors.fetch_add( 1, std::memory_order_relaxed );
+            }
+
+            BackoffMutex.lock();
+            if ( bActive )
+            {
+                BackoffCondition.wait( &BackoffMutex, ERROR_BACKOFF_MS );
+            }
+            BackoffMutex.unlock();
+
+            /* Start over from an unknown state on every reader still attached. */
+            refreshReaders();
+            for ( int i = 0; i != ReaderNames.size(); i++ )
+            {
+                ReaderStates[ i ].dwCurrentState = SCARD_STATE_UNAWARE;
+            }
         }
     }
 
     /* Clean up. */
-    free( pxReaderState );
-    pxReaderState = nullptr;
-    free( pcReaderName );
-    pcReaderName = nullptr;
+    ReaderStates.clear();
+    ReaderNames.clear();
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void NFCWorker::setContext( const SCARDCONTEXT & hContext )
+void NFCWorker::handleReaderEvent( SCARD_READERSTATE & State, const qint64 & iChangeNs )
 {
-    this->hContext = hContext;
+    QString sReader = QString::fromLocal8Bit( State.szReader );
+
+    /* Update the current state to be the new one. */
+    State.dwCurrentState = State.dwEventState;
+    if ( nullptr != pStats )
+    {
+        pStats->iLastChangeNs.store( iChangeNs, std::memory_order_relaxed );
+    }
+
+    if ( State.dwEventState & SCARD_STATE_EMPTY )
+    {
+        CardsPresent.remove( sReader );
+        emit cardRemoved( sReader );
+    }
+
+    if ( State.dwEventState & SCARD_STATE_PRESENT )
+    {
+        emit cardInserted( sReader );
+
+        if ( !readId( State.szReader, iChangeNs ) )
+        {
+            qDebug() << "NFCWorker::handleReaderEvent failed to read ID from card on" << sReader;
+        }
+        else if ( nullptr != pStats )
+        {
+            pStats->ReadLatency.record( Tracer::now() - iChangeNs );
+        }
+    }
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void NFCWorker::setReaderName( const char * pcReaderName )
+bool NFCWorker::detectPnP()
 {
-    if ( nullptr != this->pcReaderName )
+    SCARD_READERSTATE State;
+
+    /* Services without plug-and-play notification flag the pseudo-reader as unknown. */
+    memset( &State, 0, sizeof( State ) );
+    State.szReader = PNP_READER_NAME;
+    State.dwCurrentState = SCARD_STATE_UNAWARE;
+    ( void )pBackend->getStatusChange( hContext, 0, &State, 1 );
+
+    return !( State.dwEventState & SCARD_STATE_UNKNOWN );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void NFCWorker::refreshReaders()
+{
+    QStringList Names = NFCManager::listReaders( pBackend, hContext );
+    QList<QByteArray> NewNames;
+    QVector<SCARD_READERSTATE> NewStates;
+    SCARD_READERSTATE State;
+    int iIndex = 0;
+    bool bListChanged = false;
+
+    /* Keep the last known state of readers that are still attached, so they do not report their card again. */
+    for ( const QString & sName : Names )
     {
-        free( this->pcReaderName );
-        this->pcReaderName = nullptr;
+        NewNames.append( sName.toLocal8Bit() );
+        iIndex = ReaderNames.indexOf( NewNames.last() );
+        if ( 0 <= iIndex )
+        {
+            State = ReaderStates.at( iIndex );
+        }
+        else
+        {
+            memset( &State, 0, sizeof( State ) );
+            State.dwCurrentState = SCARD_STATE_UNAWARE;
+        }
+        NewStates.append( State );
     }
 
-    this->pcReaderName = static_cast<char *>( malloc( strlen( pcReaderName ) * sizeof( char ) ) );
+    /* A reader detached while holding a card also took the card away. */
+    for ( int i = 0; i != ReaderNames.size(); i++ )
+    {
+        if ( ( !NewNames.contains( ReaderNames.at( i ) ) )
+             && ( ReaderStates.at( i ).dwCurrentState & SCARD_STATE_PRESENT ) )
+        {
+            CardsPresent.remove( QString::fromLocal8Bit( ReaderNames.at( i ) ) );
+            emit cardRemoved( QString::fromLocal8Bit( ReaderNames.at( i ) ) );
+        }
+    }
 
-    if ( nullptr != pcReaderName )
+    /* The plug-and-play entry goes last, with the number of readers known in the high word of its state. */
+    if ( bPnPSupported )
     {
-        strcpy( this->pcReaderName, pcReaderName );
+        memset( &State, 0, sizeof( State ) );
+        State.szReader = PNP_READER_NAME;
+        State.dwCurrentState = static_cast<DWORD>( NewNames.size() ) << 16;
+        NewStates.append( State );
     }
-    else
+
+    bListChanged = ( NewNames != ReaderNames );
+    ReaderNames = NewNames;
+    ReaderStates = NewStates;
+
+    /* Point the entries at the names now owned by this object. */
+    for ( int i = 0; i != ReaderNames.size(); i++ )
+    {
+        ReaderStates[ i ].szReader = ReaderNames.at( i ).constData();
+    }
+
+    if ( bListChanged )
     {
-        qDebug() << "NFCWorker::setReaderName ran out of memory!";
+        emit readersChanged( Names );
     }
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
+void NFCWorker::setBackend( PCSCBackend * pBackend )
+{
+    this->pBackend = pBackend;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void NFCWorker::setContext( const SCARDCONTEXT & hContext )
+{
+    this->hContext = hContext;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void NFCWorker::setStats( NFCStats * pStats )
+{
+    this->pStats = pStats;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void NFCWorker::setCardRecords( const bool & bEnabled )
+{
+    bCardRecords = bEnabled;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void NFCWorker::queueRecordWrite( const QString & sId, const QVariantMap & Record )
+{
+    PendingWrite Write;
+
+    /* Replaces any record still waiting for the same card, then wakes the worker to write it. A cancel is lost if the
+     * worker is between flushWrites() and its wait, in which case the write waits for EVENT_TIMEOUT_MS at most. */
+    Write.Record = Record;
+    Write.Age.start();
+    WriteMutex.lock();
+    insertPendingWrite( sId, Write );
+    WriteMutex.unlock();
+
+    ( void )pBackend->cancel( hContext );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
 void NFCWorker::terminate()
 {
-    /* Signal to the loop that it should break. */
+    /* Signal to the loop that it should break, then wake it from the blocking wait or an error backoff. */
+    BackoffMutex.lock();
     bActive = false;
+    BackoffCondition.wakeAll();
+    BackoffMutex.unlock();
+
+    ( void )pBackend->cancel( hContext );
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-bool NFCWorker::readId()
+void NFCWorker::stop()
 {
-#ifdef __APPLE__
-    unsigned int uiActiveProtocol = 0;
-#else
-    unsigned long uiActiveProtocol = 0; // Improper variable name prefix!
-#endif
+    /* A cancel only wakes a wait already in progress, so one that arrives just before the worker enters the wait is
+     * lost. Keep cancelling until the thread has actually exited. */
+    terminate();
+    while ( !wait( CANCEL_RETRY_MS ) )
+    {
+        ( void )pBackend->cancel( hContext );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool NFCWorker::readId( const char * pcReaderName, const qint64 & iChangeNs )
+{
+    const QString sReader = QString::fromLocal8Bit( pcReaderName );
+    DWORD ulActiveProtocol = 0;
     SCARDHANDLE hCard;
+    bool bReturn = false;
+    QString sId;
+    CorrelationScope Tap( Tracer::isEnabled() ? Tracer::newCorrelation() : 0 );
+    TraceSpan Span( "readId", "nfc" );
+
+    /* Connect to the card. */
+    if ( SCARD_S_SUCCESS == pBackend->connect( hContext, pcReaderName, &hCard, &ulActiveProtocol ) )
+    {
+        if ( readUid( hCard, ulActiveProtocol, sId ) )
+        {
+            /* Announce the UID as a string. */
+            Tracer::bindCorrelation( sId, Tracer::currentCorrelation() );
+            emit cardDecoded( sReader, sId, iChangeNs );
+            CardsPresent.insert( sReader, sId );
+
+            /* The player record comes from the same connection, ahead of cardRead. */
+            if ( bCardRecords )
+            {
+                exchangeRecord( hCard, ulActiveProtocol, sReader, sId );
+            }
+
+            emit cardRead( sReader, sId );
+            bReturn = true;
+        }
+
+        ( void )pBackend->disconnect( hCard );
+    }
+    else
+    {
+        /* Failed to connect. */
+        bReturn = false;
+    }
+
+    return bReturn;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool NFCWorker::readUid( const SCARDHANDLE & hCard, const DWORD & ulProtocol, QString & sId )
+{
     unsigned char Command[] = { 0xff, 0xCA, 0x00, 0x00, 0x00 };
     unsigned char RxBuffer[ 32 ];
-#ifdef __APPLE__
-    unsigned int uiRxLength = 32;
-#else
-    unsigned long uiRxLength = 32; // Improper variable name prefix!
-#endif
-    SCARD_IO_REQUEST ioRequest;
+    DWORD ulRxLength = 32;
     unsigned long ulRawId = 0;
     bool bReturn = false;
 
-    /* Connect to the card. */
-    if ( SCARD_S_SUCCESS == SCardConnect( hContext, pcReaderName,
-                                          SCARD_SHARE_SHARED, SCARD_PROTOCOL_T0 | SCARD_PROTOCOL_T1,
-                                          &hCard, &uiActiveProtocol ) )
+    /* Send the command to the reader. */
+    if ( SCARD_S_SUCCESS == pBackend->transmit( hCard, ulProtocol, Command, 5, RxBuffer, &ulRxLength ) )
     {
-        /* Set up the IO request. */
-        ioRequest.dwProtocol = uiActiveProtocol;
-        ioRequest.cbPciLength = sizeof(ioRequest);
-
-        /* Send the command to the reader. */
-        if ( SCARD_S_SUCCESS == SCardTransmit( hCard, &ioRequest, Command, 5, nullptr, RxBuffer, &uiRxLength ) )
+        /* Ensure the response is valid. */
+        if ( 2 <= ulRxLength )
         {
-            /* Ensure the response is valid. */
-            if ( 2 <= uiRxLength )
+            /* Check for an error. */
+            if ( ( RxBuffer[ ulRxLength - 2 ] != 0x90 ) || ( RxBuffer[ ulRxLength - 1 ] != 0x00 ) )
             {
-                /* Check for an error. */
-                if ( ( RxBuffer[ uiRxLength - 2 ] != 0x90 ) || ( RxBuffer[ uiRxLength - 1 ] != 0x00 ) )
-                {
-                    /* Reported error. */
-                    bReturn = false;
-                }
-                else if ( 2 < uiRxLength )
-                {
-                    /* Extract the UID from the buffer. */
-                    for ( unsigned int i = 0; i != ( uiRxLength - 2 ); i++ )
-                    {
-                        ulRawId <<= 8;
-                        ulRawId |= static_cast<unsigned long>( RxBuffer[ i ] );
-                    }
-
-                    /* Announce the UID as a string. */
-                    emit cardRead( QString::number( ulRawId, 16 ) );
-                    bReturn = true;
-                }
+                /* Reported error. */
+                bReturn = false;
             }
-            else
+            else if ( 2 < ulRxLength )
             {
-                /* Bad response. */
-                bReturn = false;
+                /* Extract the UID from the buffer. */
+                for ( unsigned int i = 0; i != ( ulRxLength - 2 ); i++ )
+                {
+                    ulRawId <<= 8;
+                    ulRawId |= static_cast<unsigned long>( RxBuffer[ i ] );
+                }
+
+                sId = QString::number( ulRawId, 16 );
+                bReturn = true;
             }
         }
         else
         {
-            /* Failed to send the command. */
+            /* Bad response. */
             bReturn = false;
         }
-
-        ( void )SCardDisconnect( hCard, SCARD_LEAVE_CARD );
     }
     else
     {
-        /* Failed to connect. */
+        /* Failed to send the command. */
         bReturn = false;
     }
 
     return bReturn;
 }
 /*--------------------------------------------------------------------------------------------------------------------*/
+
+void NFCWorker::exchangeRecord( const SCARDHANDLE & hCard,
+                                const DWORD & ulProtocol,
+                                const QString & sReader,
+                                const QString & sId )
+{
+    QVariantMap Record;
+    PendingWrite Write;
+    RecordWrite eWritten = RecordWrite::Failed;
+    TraceSpan Span( "exchangeRecord", "nfc" );
+
+    if ( takePendingWrite( sId, Write ) )
+    {
+        /* A newer record is waiting for this card, so write it and announce it instead of what the card held. */
+        eWritten = writeRecord( hCard, ulProtocol, Write.Record );
+        if ( RecordWrite::Written == eWritten )
+        {
+            Write.Record.insert( "written", QDateTime::currentDateTimeUtc() );
+        }
+        else if ( RecordWrite::Failed == eWritten )
+        {
+            Write.bNextTap = true;
+            requeueWrite( sId, Write );
+        }
+        else
+        {
+            /* Not a card that holds a record, so there is nothing to retry or to announce. */
+            emit cardRecordWritten( sId, false );
+            return;
+        }
+        emit cardRecordWritten( sId, RecordWrite::Written == eWritten );
+        emit cardRecordRead( sReader, sId, Write.Record );
+    }
+    else if ( readRecord( hCard, ulProtocol, Record ) )
+    {
+        emit cardRecordRead( sReader, sId, Record );
+    }
+    else
+    {
+        /* No record on the card (or not a card that holds one). */
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool NFCWorker::readRecord( const SCARDHANDLE & hCard, const DWORD & ulProtocol, QVariantMap & Record )
+{
+    QByteArray Command( "\xFF\xB0\x00\x00\x00", 5 );
+    QByteArray Response;
+    QByteArray Data;
+    int iLength = -1;
+
+    /* Read four pages per command until the length from the header has been covered. */
+    Command[ 4 ] = static_cast<char>( CARD_RECORD_READ_BYTES );
+    do
+    {
+        Command[ 3 ] = static_cast<char>( CARD_RECORD_FIRST_PAGE + ( Data.size() / CARD_RECORD_PAGE_BYTES ) );
+        if ( ( !transmitApdu( hCard, ulProtocol, Command, Response ) ) || ( Response.isEmpty() ) )
+        {
+            return false;
+        }
+        Data.append( Response );
+
+        if ( 0 > iLength )
+        {
+            iLength = CardRecord::encodedLength( Data );
+            if ( 0 > iLength )
+            {
+                return false;
+            }
+        }
+    }
+    while ( Data.size() < iLength );
+
+    return CardRecord::decode( Data, Record );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+NFCWorker::RecordWrite NFCWorker::writeRecord( const SCARDHANDLE & hCard,
+                                               const DWORD & ulProtocol,
+                                               const QVariantMap & Record )
+{
+    const QByteArray Data = CardRecord::encode( Record );
+    QByteArray Command( "\xFF\xB0\x00\x00\x00", 5 );
+    QByteArray Response;
+    QByteArray Existing;
+    int iOffset = CARD_RECORD_PAGE_BYTES;
+
+    /* Read what the write would cover first, and leave the card alone unless it is blank or already holds a record. */
+    Command[ 4 ] = static_cast<char>( CARD_RECORD_READ_BYTES );
+    while ( Existing.size() < Data.size() )
+    {
+        Command[ 3 ] = static_cast<char>( CARD_RECORD_FIRST_PAGE + ( Existing.size() / CARD_RECORD_PAGE_BYTES ) );
+        if ( ( !transmitApdu( hCard, ulProtocol, Command, Response ) ) || ( Response.isEmpty() ) )
+        {
+            return RecordWrite::Failed;
+        }
+        Existing.append( Response );
+    }
+
+    if ( !CardRecord::isWritable( Existing.left( Data.size() ) ) )
+    {
+        qDebug() << "NFCWorker::writeRecord: card holds other data, not writing";
+        return RecordWrite::Refused;
+    }
+
+    Command = QByteArray( "\xFF\xD6\x00\x00\x04", 5 );
+
+    /* One page per command. The header goes last, so a write cut short by the card leaving the reader leaves a record
+     * that fails its checksum rather than a mix of old and new fields. */
+    while ( true )
+    {
+        Command.resize( 5 );
+        Command[ 3 ] = static_cast<char>( CARD_RECORD_FIRST_PAGE + ( iOffset / CARD_RECORD_PAGE_BYTES ) );
+        Command.append( Data.mid( iOffset, CARD_RECORD_PAGE_BYTES ) );
+        if ( !transmitApdu( hCard, ulProtocol, Command, Response ) )
+        {
+            return RecordWrite::Failed;
+        }
+
+        if ( 0 == iOffset )
+        {
+            return RecordWrite::Written;
+        }
+
+        iOffset += CARD_RECORD_PAGE_BYTES;
+        if ( Data.size() <= iOffset )
+        {
+            iOffset = 0;
+        }
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool NFCWorker::transmitApdu( const SCARDHANDLE & hCard,
+                              const DWORD & ulProtocol,
+                              const QByteArray & Command,
+                              QByteArray & Response )
+{
+    unsigned char RxBuffer[ CARD_RECORD_READ_BYTES + 2 ];
+    DWORD ulRxLength = sizeof( RxBuffer );
+
+    Response.clear();
+    if ( SCARD_S_SUCCESS != pBackend->transmit( hCard,
+                                                ulProtocol,
+                                                reinterpret_cast<const unsigned char *>( Command.constData() ),
+                                                static_cast<DWORD>( Command.size() ),
+                                                RxBuffer,
+                                                &ulRxLength ) )
+    {
+        return false;
+    }
+
+    /* Keep the data, without the status word, only on success. */
+    if ( ( 2 > ulRxLength ) || ( 0x90 != RxBuffer[ ulRxLength - 2 ] ) || ( 0x00 != RxBuffer[ ulRxLength - 1 ] ) )
+    {
+        return false;
+    }
+
+    Response = QByteArray( reinterpret_cast<const char *>( RxBuffer ), static_cast<int>( ulRxLength - 2 ) );
+
+    return true;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void NFCWorker::insertPendingWrite( const QString & sId, const PendingWrite & Write )
+{
+    /* Called with WriteMutex held. Most cards never come back, so drop the records that have waited too long, then
+     * the oldest beyond the limit. */
+    while ( ( !PendingWriteOrder.isEmpty() )
+            && ( PendingWrites.value( PendingWriteOrder.first() ).Age.hasExpired( PENDING_WRITE_AGE_MS ) ) )
+    {
+        PendingWrites.remove( PendingWriteOrder.takeFirst() );
+    }
+
+    PendingWrites.insert( sId, Write );
+    PendingWriteOrder.removeOne( sId );
+    PendingWriteOrder.append( sId );
+
+    while ( PENDING_WRITES_MAX < PendingWriteOrder.size() )
+    {
+        PendingWrites.remove( PendingWriteOrder.takeFirst() );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool NFCWorker::takePendingWrite( const QString & sId, PendingWrite & Write )
+{
+    QMutexLocker Lock( &WriteMutex );
+    QHash<QString, PendingWrite>::iterator Iterator = PendingWrites.find( sId );
+
+    if ( PendingWrites.end() == Iterator )
+    {
+        return false;
+    }
+
+    Write = Iterator.value();
+    PendingWrites.erase( Iterator );
+    PendingWriteOrder.removeOne( sId );
+
+    return ( !Write.Age.hasExpired( PENDING_WRITE_AGE_MS ) );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void NFCWorker::requeueWrite( const QString & sId, const PendingWrite & Write )
+{
+    QMutexLocker Lock( &WriteMutex );
+
+    /* Retried on the card's next tap, unless a newer record has been queued since. The age is kept, so a card that
+     * keeps leaving the reader mid-write does not hold on to its record forever. */
+    if ( !PendingWrites.contains( sId ) )
+    {
+        insertPendingWrite( sId, Write );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void NFCWorker::flushWrites()
+{
+    QHash<QString, QString>::const_iterator Iterator;
+    DWORD ulActiveProtocol = 0;
+    SCARDHANDLE hCard;
+    PendingWrite Write;
+    QString sId;
+    RecordWrite eWritten = RecordWrite::Failed;
+    bool bNextTap = false;
+
+    WriteMutex.lock();
+    if ( PendingWrites.isEmpty() )
+    {
+        WriteMutex.unlock();
+        return;
+    }
+    WriteMutex.unlock();
+
+    /* Write to the cards still on a reader; the others get their record on their next tap. So does a card whose write
+     * already failed, or it would be retried, and the failure reported, on every wakeup for as long as it stays. */
+    for ( Iterator = CardsPresent.constBegin(); Iterator != CardsPresent.constEnd(); ++Iterator )
+    {
+        WriteMutex.lock();
+        bNextTap = PendingWrites.value( Iterator.value() ).bNextTap;
+        WriteMutex.unlock();
+        if ( ( bNextTap ) || ( !takePendingWrite( Iterator.value(), Write ) ) )
+        {
+            continue;
+        }
+
+        eWritten = RecordWrite::Failed;
+        if ( SCARD_S_SUCCESS == pBackend->connect( hContext, Iterator.key().toLocal8Bit().constData(), &hCard, &ulActiveProtocol ) )
+        {
+            /* Make sure it is still the same card. */
+            if ( ( readUid( hCard, ulActiveProtocol, sId ) ) && ( Iterator.value() == sId ) )
+            {
+                eWritten = writeRecord( hCard, ulActiveProtocol, Write.Record );
+            }
+            ( void )pBackend->disconnect( hCard );
+        }
+
+        if ( RecordWrite::Failed == eWritten )
+        {
+            Write.bNextTap = true;
+            requeueWrite( Iterator.value(), Write );
+        }
+        emit cardRecordWritten( Iterator.value(), RecordWrite::Written == eWritten );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -1,14 +1,40 @@
 #ifndef NFCMANAGER_H
 #define NFCMANAGER_H
 
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
 #include <QObject>
 #include <QThread>
+#include <QStringList>
 #include <QTimer>
-#include <PCSC/winscard.h>
-#include <PCSC/wintypes.h>
+#include <QVariantMap>
+#include <QVector>
+#include <QWaitCondition>
+#include <atomic>
 
-#define POLLING_INTERVAL_MS  1000
-#define EVENT_TIMEOUT_MS     1000
+#include "metrics.h"
+#include "pcscbackend.h"
+
+#define POLLING_INTERVAL_MS  1000       // Reader list refresh when plug-and-play notification is unsupported
+#define EVENT_TIMEOUT_MS     5000       // Upper bound on a wait that SCardCancel() missed; changes wake it at once
+#define CANCEL_RETRY_MS      50         // Interval between cancels while waiting for the worker to stop
+#define ERROR_BACKOFF_MS     1000       // Pause after a PC/SC error so a missing reader or service does not spin
+#define PENDING_WRITES_MAX   256        // Card records waiting for their card's next tap; the oldest are dropped
+#define PENDING_WRITE_AGE_MS 3600000    // A record not written by then is dropped rather than written stale
+
+class DataStore;
+
+class NFCStats
+{
+public:
+    LatencyHistogram ReadLatency;               // State change seen until the worker signalled the UID
+    LatencyHistogram DispatchLatency;           // State change seen until cardRead was emitted on the manager's thread
+    std::atomic<quint64> ulWakeups { 0 };       // Returns from SCardGetStatusChange()
+    std::atomic<quint64> ulSpuriousWakeups { 0 };   // Returns that carried no change
+    std::atomic<quint64> ulErrors { 0 };        // Unexpected PC/SC return codes
+    std::atomic<qint64> iLastChangeNs { 0 };    // When the most recent change was seen (Tracer::now())
+};
 
 class NFCWorker : public QThread
 {
@@ -17,55 +43,134 @@ class NFCWorker : public QThread
 public:
     void run() override;
 
+    void setBackend( PCSCBackend * pBackend );
     void setContext( const SCARDCONTEXT & hContext );
-    void setReaderName( const char * pcReaderName );
+    void setStats( NFCStats * pStats );
+    void setCardRecords( const bool & bEnabled );
+    void queueRecordWrite( const QString & sId, const QVariantMap & Record );
+    void stop();
 
 signals:
-    void cardInserted();
-    void cardRemoved();
-    void cardRead( QString sId );
+    void cardInserted( const QString & sReader );
+    void cardRemoved( const QString & sReader );
+    void cardRead( const QString & sReader, const QString & sId );
+    void cardDecoded( const QString & sReader, const QString & sId, const qint64 & iChangeNs );
+    void cardRecordRead( const QString & sReader, const QString & sId, const QVariantMap & Record );
+    void cardRecordWritten( const QString & sId, const bool & bWritten );
+    void readersChanged( const QStringList & Readers );
 
 public slots:
     void terminate();
 
 private:
-    bool bActive;
+    enum class RecordWrite
+    {
+        Written,
+        Failed,                             // Worth retrying on the next tap (i.e. the card left the reader)
+        Refused                             // The card holds data that is not a record
+    };
+
+    class PendingWrite
+    {
+    public:
+        QVariantMap Record;
+        QElapsedTimer Age;                  // Since the record was first queued, kept across retries
+        bool bNextTap = false;              // Failed once already, so only retried when the card is tapped again
+    };
+
+    std::atomic<bool> bActive { true };
+    PCSCBackend *pBackend = nullptr;
     SCARDCONTEXT hContext;
-    char *pcReaderName;
-    SCARD_READERSTATE *pxReaderState;
-
-    bool readId();
+    QList<QByteArray> ReaderNames;          // Backing storage for the reader names in ReaderStates
+    QVector<SCARD_READERSTATE> ReaderStates;    // One per reader, followed by the plug-and-play entry if supported
+    bool bPnPSupported = false;
+    NFCStats *pStats = nullptr;
+    QMutex BackoffMutex;
+    QWaitCondition BackoffCondition;
+    std::atomic<bool> bCardRecords { false };
+    QMutex WriteMutex;
+    QHash<QString, PendingWrite> PendingWrites; // Card UID to the record waiting to be written to it
+    QStringList PendingWriteOrder;          // The UIDs in PendingWrites, oldest first
+    QHash<QString, QString> CardsPresent;       // Reader name to the UID of the card on it
+
+    bool detectPnP();
+    void refreshReaders();
+    void handleReaderEvent( SCARD_READERSTATE & State, const qint64 & iChangeNs );
+    bool readId( const char * pcReaderName, const qint64 & iChangeNs );
+    bool readUid( const SCARDHANDLE & hCard, const DWORD & ulProtocol, QString & sId );
+    void exchangeRecord( const SCARDHANDLE & hCard, const DWORD & ulProtocol, const QString & sReader, const QString & sId );
+    bool readRecord( const SCARDHANDLE & hCard, const DWORD & ulProtocol, QVariantMap & Record );
+    RecordWrite writeRecord( const SCARDHANDLE & hCard, const DWORD & ulProtocol, const QVariantMap & Record );
+    bool transmitApdu( const SCARDHANDLE & hCard, const DWORD & ulProtocol, const QByteArray & Command, QByteArray & Response );
+    void insertPendingWrite( const QString & sId, const PendingWrite & Write );
+    bool takePendingWrite( const QString & sId, PendingWrite & Write );
+    void requeueWrite( const QString & sId, const PendingWrite & Write );
+    void flushWrites();
 };
 
 class NFCManager : public QObject
 {
     Q_OBJECT
 public:
+    explicit NFCManager( DataStore * pStore = nullptr, QObject * pParent = nullptr );
+    ~NFCManager();
+
+    /* The process-wide manager, publishing into DataStore::instance(). */
     static NFCManager * instance();
 
     bool nfcManagerInit();
 
-    QString getCurrentId();
+    QString getCurrentId( const QString & sReader = QString() );
+    QStringList getReaders() const;
+    const NFCStats & getStats() const;
+
+    void setBackend( PCSCBackend * pBackend );
+    void setCardRecords( const bool & bEnabled );
+    bool cardRecordsEnabled() const;
+    void writeCardRecord( const QString & sId, const QVariantMap & Record );
+
+    static QStringList listReaders( PCSCBackend * pBackend, const SCARDCONTEXT & hContext );
 
 signals:
     void cardInserted();
     void cardRemoved();
     void cardRead( const QString & sId );
 
+    /* The same events, identifying the reader, plus reader hot-plug. */
+    void readerCardInserted( const QString & sReader );
+    void readerCardRemoved( const QString & sReader );
+    void readerCardRead( const QString & sReader, const QString & sId );
+    void readersChanged( const QStringList & Readers );
+
+    /* Emitted on the worker's thread as soon as a UID is decoded, ahead of cardRead, with the time (Tracer::now())
+     * the tap was seen. Receivers must use a queued or auto connection. */
+    void cardDecoded( const QString & sReader, const QString & sId, const qint64 & iChangeNs );
+
+    /* The player record kept on a card, read in the same transaction as its UID, and the outcome of writing one. */
+    void cardRecordRead( const QString & sReader, const QString & sId, const QVariantMap & Record );
+    void cardRecordWritten( const QString & sId, const bool & bWritten );
+
 private slots:
-    void on_cardInserted();
-    void on_cardRemoved();
-    void on_cardRead( const QString & sId );
+    void on_cardInserted( const QString & sReader );
+    void on_cardRemoved( const QString & sReader );
+    void on_cardRead( const QString & sReader, const QString & sId );
+    void on_readersChanged( const QStringList & Readers );
+    void on_cardRecordRead( const QString & sReader, const QString & sId, const QVariantMap & Record );
     void cleanupBeforeQuit();
 
 private:
+    DataStore *pStore;
+    PCSCBackend *pBackend;
     SCARDCONTEXT hContext;
-    char *pcReaderName;
     NFCWorker *pWorkerThread;
     QString sCurrentId;
+    QHash<QString, QString> CurrentIds;     // Last UID read per reader
+    QStringList Readers;                    // Currently attached readers
+    QStringList KnownReaders;               // Every reader seen so far; the position is its tag index
+    NFCStats Stats;
+    std::atomic<bool> bCardRecords { false };
 
-    explicit NFCManager( QObject * pParent = nullptr );
-    bool getReaderName();
+    int readerIndex( const QString & sReader );
     bool startWorker();
 };
 
@@ -0,0 +1,98 @@
+#include "pcscbackend.h"
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/* Forwards every call to the PC/SC service. */
+class SystemPCSCBackend : public PCSCBackend
+{
+public:
+    LONG establishContext( SCARDCONTEXT * phContext ) override;
+    LONG releaseContext( const SCARDCONTEXT & hContext ) override;
+    LONG listReaders( const SCARDCONTEXT & hContext, char * pcReaders, DWORD * pulLength ) override;
+    LONG getStatusChange( const SCARDCONTEXT & hContext,
+                          const DWORD & ulTimeoutMs,
+                          SCARD_READERSTATE * pxStates,
+                          const DWORD & ulCount ) override;
+    LONG cancel( const SCARDCONTEXT & hContext ) override;
+    LONG connect( const SCARDCONTEXT & hContext, const char * pcReader, SCARDHANDLE * phCard, DWORD * pulProtocol ) override;
+    LONG transmit( const SCARDHANDLE & hCard,
+                   const DWORD & ulProtocol,
+                   const unsigned char * pucCommand,
+                   const DWORD & ulCommandLength,
+                   unsigned char * pucResponse,
+                   DWORD * pulResponseLength ) override;
+    LONG disconnect( const SCARDHANDLE & hCard ) override;
+};
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+PCSCBackend * PCSCBackend::system()
+{
+    static SystemPCSCBackend Backend;
+
+    return &Backend;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+LONG SystemPCSCBackend::establishContext( SCARDCONTEXT * phContext )
+{
+    return SCardEstablishContext( SCARD_SCOPE_SYSTEM, nullptr, nullptr, phContext );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+LONG SystemPCSCBackend::releaseContext( const SCARDCONTEXT & hContext )
+{
+    return SCardReleaseContext( hContext );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+LONG SystemPCSCBackend::listReaders( const SCARDCONTEXT & hContext, char * pcReaders, DWORD * pulLength )
+{
+    return SCardListReaders( hContext, nullptr, pcReaders, pulLength );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+LONG SystemPCSCBackend::getStatusChange( const SCARDCONTEXT & hContext,
+                                         const DWORD & ulTimeoutMs,
+                                         SCARD_READERSTATE * pxStates,
+                                         const DWORD & ulCount )
+{
+    return SCardGetStatusChange( hContext, ulTimeoutMs, pxStates, ulCount );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+LONG SystemPCSCBackend::cancel( const SCARDCONTEXT & hContext )
+{
+    return SCardCancel( hContext );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+LONG SystemPCSCBackend::connect( const SCARDCONTEXT & hContext,
+                                 const char * pcReader,
+                                 SCARDHANDLE * phCard,
+                                 DWORD * pulProtocol )
+{
+    return SCardConnect( hContext, pcReader, SCARD_SHARE_SHARED, SCARD_PROTOCOL_T0 | SCARD_PROTOCOL_T1, phCard, pulProtocol );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+LONG SystemPCSCBackend::transmit( const SCARDHANDLE & hCard,
+                                  const DWORD & ulProtocol,
+                                  const unsigned char * pucCommand,
+                                  const DWORD & ulCommandLength,
+                                  unsigned char * pucResponse,
+                                  DWORD * pulResponseLength )
+{
+    SCARD_IO_REQUEST ioRequest;
+
+    /* Set up the IO request. */
+    ioRequest.dwProtocol = ulProtocol;
+    ioRequest.cbPciLength = sizeof( ioRequest );
+
+    return SCardTransmit( hCard, &ioRequest, pucCommand, ulCommandLength, nullptr, pucResponse, pulResponseLength );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+LONG SystemPCSCBackend::disconnect( const SCARDHANDLE & hCard )
+{
+    return SCardDisconnect( hCard, SCARD_LEAVE_CARD );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
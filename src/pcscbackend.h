@@ -0,0 +1,41 @@
+#ifndef PCSCBACKEND_H
+#define PCSCBACKEND_H
+
+#include <PCSC/winscard.h>
+#include <PCSC/wintypes.h>
+
+#ifndef INFINITE
+#define INFINITE            0xFFFFFFFF
+#endif
+
+#define PNP_READER_NAME     "\\\\?PnP?\\Notification"
+
+/* The PC/SC calls made by the NFC manager and its worker. The system implementation forwards to the PC/SC service;
+ * others (i.e. SimulatedReader) stand in for it when no reader hardware is available. Implementations must allow
+ * cancel() to be called from another thread while getStatusChange() is blocked. */
+class PCSCBackend
+{
+public:
+    virtual ~PCSCBackend() = default;
+
+    virtual LONG establishContext( SCARDCONTEXT * phContext ) = 0;
+    virtual LONG releaseContext( const SCARDCONTEXT & hContext ) = 0;
+    virtual LONG listReaders( const SCARDCONTEXT & hContext, char * pcReaders, DWORD * pulLength ) = 0;
+    virtual LONG getStatusChange( const SCARDCONTEXT & hContext,
+                                  const DWORD & ulTimeoutMs,
+                                  SCARD_READERSTATE * pxStates,
+                                  const DWORD & ulCount ) = 0;
+    virtual LONG cancel( const SCARDCONTEXT & hContext ) = 0;
+    virtual LONG connect( const SCARDCONTEXT & hContext, const char * pcReader, SCARDHANDLE * phCard, DWORD * pulProtocol ) = 0;
+    virtual LONG transmit( const SCARDHANDLE & hCard,
+                           const DWORD & ulProtocol,
+                           const unsigned char * pucCommand,
+                           const DWORD & ulCommandLength,
+                           unsigned char * pucResponse,
+                           DWORD * pulResponseLength ) = 0;
+    virtual LONG disconnect( const SCARDHANDLE & hCard ) = 0;
+
+    static PCSCBackend * system();
+};
+
+#endif // PCSCBACKEND_H
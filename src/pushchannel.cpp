@@ -0,0 +1,261 @@
+#include <QDebug>
+#include <QNetworkRequest>
+
+#include "pushchannel.h"
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+PushChannel::PushChannel( QNetworkAccessManager * pNetworkManager, QObject * pParent ) : QObject( pParent )
+{
+    this->pNetworkManager = pNetworkManager;
+    pReply = nullptr;
+    iReconnectMs = PUSH_RECONNECT_MIN_MS;
+    iServerRetryMs = 0;
+    bConnected = false;
+
+    pReconnectTimer = new QTimer( this );
+    pReconnectTimer->setSingleShot( true );
+    connect( pReconnectTimer, SIGNAL( timeout() ), this, SLOT( reconnect() ) );
+
+    /* The server sends a comment line as a heartbeat, so a silent stream is a dead one. */
+    pIdleTimer = new QTimer( this );
+    pIdleTimer->setSingleShot( true );
+    pIdleTimer->setInterval( PUSH_IDLE_TIMEOUT_MS );
+    connect( pIdleTimer, SIGNAL( timeout() ), this, SLOT( handleIdleTimeout() ) );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+PushChannel::~PushChannel()
+{
+    close();
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void PushChannel::open( const QUrl & Source )
+{
+    close();
+
+    this->Source = Source;
+    LastEventId.clear();
+    iReconnectMs = PUSH_RECONNECT_MIN_MS;
+    reconnect();
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void PushChannel::close()
+{
+    pReconnectTimer->stop();
+    pIdleTimer->stop();
+    Source.clear();
+    releaseReply();
+
+    if ( bConnected )
+    {
+        bConnected = false;
+        emit disconnected();
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool PushChannel::isConnected() const
+{
+    return bConnected;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool PushChannel::owns( const QNetworkReply * pReply ) const
+{
+    return ( nullptr != pReply ) && ( this->pReply == pReply );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void PushChannel::reconnect()
+{
+    QNetworkRequest Request;
+
+    if ( ( !Source.isValid() ) || ( nullptr != pReply ) )
+    {
+        return;
+    }
+
+    Request.setUrl( Source );
+    Request.setRawHeader( "User-Agent", "BCON Network" );
+    Request.setRawHeader( "X-Custom-User-Agent", "BCON Network" );
+    Request.setRawHeader( "Accept", "text/event-stream" );
+    Request.setRawHeader( "Cache-Control", "no-cache" );
+    Request.setAttribute( QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork );
+
+    /* Let the server replay what was missed, if it can. */
+    if ( !LastEventId.isEmpty() )
+    {
+        Request.setRawHeader( "Last-Event-ID", LastEventId );
+    }
+
+    Buffer.clear();
+    sEventType.clear();
+    EventData.clear();
+
+    pReply = pNetworkManager->get( Request );
+    connect( pReply, SIGNAL( readyRead() ), this, SLOT( handleReadyRead() ) );
+    connect( pReply, SIGNAL( finished() ), this, SLOT( handleFinished() ) );
+    pIdleTimer->start();
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void PushChannel::handleReadyRead()
+{
+    int iLineEnd = 0;
+
+    if ( ( nullptr == pReply ) || ( sender() != pReply ) )
+    {
+        return;
+    }
+
+    /* The stream is only up once the server has accepted it. */
+    if ( !bConnected )
+    {
+        if ( ( 200 != pReply->attribute( QNetworkRequest::HttpStatusCodeAttribute ).toInt() )
+             || ( !pReply->header( QNetworkRequest::ContentTypeHeader ).toString().startsWith( "text/event-stream" ) ) )
+        {
+            qDebug() << "PushChannel::handleReadyRead the server did not open an event stream at" << Source;
+            pReply->abort();
+            return;
+        }
+
+        bConnected = true;
+        iReconnectMs = PUSH_RECONNECT_MIN_MS;
+        emit connected();
+    }
+
+    pIdleTimer->start();
+    Buffer.append( pReply->readAll() );
+
+    /* Events are made of lines and end at a blank line. */
+    while ( 0 <= ( iLineEnd = Buffer.indexOf( '\n' ) ) )
+    {
+        QByteArray Line = Buffer.left( iLineEnd );
+
+        Buffer.remove( 0, iLineEnd + 1 );
+        if ( Line.endsWith( '\r' ) )
+        {
+            Line.chop( 1 );
+        }
+        processLine( Line );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void PushChannel::processLine( const QByteArray & Line )
+{
+    const int iColon = Line.indexOf( ':' );
+    QByteArray Field = Line;
+    QByteArray Value;
+
+    if ( Line.isEmpty() )
+    {
+        /* Dispatch the event collected so far. */
+        if ( !EventData.isEmpty() )
+        {
+            EventData.chop( 1 );
+            emit eventReceived( sEventType.isEmpty() ? QString( "message" ) : sEventType, EventData );
+        }
+        sEventType.clear();
+        EventData.clear();
+        return;
+    }
+
+    if ( 0 == iColon )
+    {
+        /* Comment, i.e. a heartbeat. */
+        return;
+    }
+
+    if ( 0 < iColon )
+    {
+        Field = Line.left( iColon );
+        Value = Line.mid( iColon + 1 );
+        if ( Value.startsWith( ' ' ) )
+        {
+            Value.remove( 0, 1 );
+        }
+    }
+
+    if ( "event" == Field )
+    {
+        sEventType = QString::fromUtf8( Value );
+    }
+    else if ( "data" == Field )
+    {
+        EventData.append( Value ).append( '\n' );
+    }
+    else if ( "id" == Field )
+    {
+        LastEventId = Value;
+    }
+    else if ( "retry" == Field )
+    {
+        iServerRetryMs = Value.toInt();
+    }
+    else
+    {
+        /* Unknown field, ignore. */
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void PushChannel::handleFinished()
+{
+    if ( ( nullptr == pReply ) || ( sender() != pReply ) )
+    {
+        return;
+    }
+
+    qDebug() << "PushChannel::handleFinished event stream closed:" << pReply->errorString();
+
+    releaseReply();
+    pIdleTimer->stop();
+    if ( bConnected )
+    {
+        bConnected = false;
+        emit disconnected();
+    }
+
+    /* Back off exponentially while the server stays unreachable, starting from its requested delay if it sent one. */
+    if ( Source.isValid() )
+    {
+        pReconnectTimer->start( qMax( iReconnectMs, iServerRetryMs ) );
+        iReconnectMs = qMin( iReconnectMs * 2, PUSH_RECONNECT_MAX_MS );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void PushChannel::handleIdleTimeout()
+{
+    if ( nullptr != pReply )
+    {
+        qDebug() << "PushChannel::handleIdleTimeout no data or heartbeat from" << Source;
+
+        /* Finishes the reply, which schedules the reconnect. */
+        pReply->abort();
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void PushChannel::releaseReply()
+{
+    QNetworkReply *pFinished = pReply;
+
+    if ( nullptr == pFinished )
+    {
+        return;
+    }
+
+    /* Detach before aborting so the abort does not come back in as a dropped stream. */
+    pReply = nullptr;
+    disconnect( pFinished, nullptr, this, nullptr );
+    if ( pFinished->isRunning() )
+    {
+        pFinished->abort();
+    }
+    pFinished->deleteLater();
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
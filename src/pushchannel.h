@@ -0,0 +1,57 @@
+#ifndef PUSHCHANNEL_H
+#define PUSHCHANNEL_H
+
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QObject>
+#include <QTimer>
+#include <QUrl>
+
+#define PUSH_RECONNECT_MIN_MS   1000
+#define PUSH_RECONNECT_MAX_MS   30000
+#define PUSH_IDLE_TIMEOUT_MS    45000
+
+/* A Server-Sent Events stream that stays open, reconnecting with backoff whenever it drops. */
+class PushChannel : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PushChannel( QNetworkAccessManager * pNetworkManager, QObject * pParent = nullptr );
+    ~PushChannel();
+
+    void open( const QUrl & Source );
+    void close();
+    bool isConnected() const;
+    bool owns( const QNetworkReply * pReply ) const;
+
+signals:
+    void connected();
+    void disconnected();
+    void eventReceived( const QString & sEvent, const QByteArray & Data );
+
+private slots:
+    void handleReadyRead();
+    void handleFinished();
+    void handleIdleTimeout();
+    void reconnect();
+
+private:
+    QNetworkAccessManager *pNetworkManager;
+    QNetworkReply *pReply;
+    QUrl Source;
+    QByteArray Buffer;
+    QString sEventType;
+    QByteArray EventData;
+    QByteArray LastEventId;
+    QTimer *pReconnectTimer;
+    QTimer *pIdleTimer;
+    int iReconnectMs;
+    int iServerRetryMs;
+    bool bConnected;
+
+    void processLine( const QByteArray & Line );
+    void releaseReply();
+};
+
+#endif // PUSHCHANNEL_H
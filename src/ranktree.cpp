@@ -0,0 +1,299 @@
+#include "ranktree.h"
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+RankTree::RankTree()
+{
+    iRoot = -1;
+    uiSeed = 2463534242u;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void RankTree::insert( const double & dValue, const QString & sId )
+{
+    int iNew = -1;
+
+    /* Reuse a free node if there is one. */
+    if ( !FreeNodes.isEmpty() )
+    {
+        iNew = FreeNodes.takeLast();
+    }
+    else
+    {
+        iNew = Nodes.size();
+        Nodes.append( Node() );
+    }
+
+    /* A cheap xorshift is plenty for balancing priorities. */
+    uiSeed ^= uiSeed << 13;
+    uiSeed ^= uiSeed >> 17;
+    uiSeed ^= uiSeed << 5;
+
+    Node & Entry = Nodes[ iNew ];
+    Entry.dValue = dValue;
+    Entry.sId = sId;
+    Entry.uiPriority = uiSeed;
+    Entry.iLeft = -1;
+    Entry.iRight = -1;
+    Entry.iSize = 1;
+
+    iRoot = insertAt( iRoot, iNew );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool RankTree::remove( const double & dValue, const QString & sId )
+{
+    bool bRemoved = false;
+
+    iRoot = removeAt( iRoot, dValue, sId, bRemoved );
+
+    return bRemoved;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void RankTree::clear()
+{
+    Nodes.clear();
+    FreeNodes.clear();
+    iRoot = -1;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+int RankTree::size() const
+{
+    return subtreeSize( iRoot );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+int RankTree::rank( const double & dValue, const QString & sId ) const
+{
+    int iNode = iRoot;
+    int iRank = 0;
+
+    while ( 0 <= iNode )
+    {
+        const Node & Current = Nodes.at( iNode );
+
+        if ( ( dValue == Current.dValue ) && ( sId == Current.sId ) )
+        {
+            return iRank + subtreeSize( Current.iLeft );
+        }
+
+        if ( precedes( dValue, sId, Current ) )
+        {
+            iNode = Current.iLeft;
+        }
+        else
+        {
+            iRank += subtreeSize( Current.iLeft ) + 1;
+            iNode = Current.iRight;
+        }
+    }
+
+    return -1;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool RankTree::at( const int & iRank, RankedEntry & Entry ) const
+{
+    int iNode = iRoot;
+    int iRemaining = iRank;
+    int iLeftSize = 0;
+
+    if ( ( 0 > iRank ) || ( size() <= iRank ) )
+    {
+        return false;
+    }
+
+    while ( 0 <= iNode )
+    {
+        const Node & Current = Nodes.at( iNode );
+
+        iLeftSize = subtreeSize( Current.iLeft );
+        if ( iRemaining < iLeftSize )
+        {
+            iNode = Current.iLeft;
+        }
+        else if ( iRemaining == iLeftSize )
+        {
+            Entry.sId = Current.sId;
+            Entry.dValue = Current.dValue;
+            return true;
+        }
+        else
+        {
+            iRemaining -= iLeftSize + 1;
+            iNode = Current.iRight;
+        }
+    }
+
+    return false;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+QVector<RankedEntry> RankTree::first( const int & iCount ) const
+{
+    QVector<RankedEntry> Entries;
+    QVector<int> Path;
+    RankedEntry Entry;
+    int iNode = iRoot;
+
+    /* An in-order walk that stops after the requested number of entries. */
+    Entries.reserve( qMax( 0, qMin( iCount, size() ) ) );
+    while ( ( Entries.size() < iCount ) && ( ( 0 <= iNode ) || ( !Path.isEmpty() ) ) )
+    {
+        if ( 0 <= iNode )
+        {
+            Path.append( iNode );
+            iNode = Nodes.at( iNode ).iLeft;
+        }
+        else
+        {
+            iNode = Path.takeLast();
+            Entry.sId = Nodes.at( iNode ).sId;
+            Entry.dValue = Nodes.at( iNode ).dValue;
+            Entries.append( Entry );
+            iNode = Nodes.at( iNode ).iRight;
+        }
+    }
+
+    return Entries;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+int RankTree::subtreeSize( const int & iNode ) const
+{
+    return ( 0 <= iNode ) ? Nodes.at( iNode ).iSize : 0;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void RankTree::update( const int & iNode )
+{
+    Nodes[ iNode ].iSize = 1 + subtreeSize( Nodes.at( iNode ).iLeft ) + subtreeSize( Nodes.at( iNode ).iRight );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+int RankTree::rotateLeft( const int & iNode )
+{
+    const int iRight = Nodes.at( iNode ).iRight;
+
+    Nodes[ iNode ].iRight = Nodes.at( iRight ).iLeft;
+    Nodes[ iRight ].iLeft = iNode;
+    update( iNode );
+    update( iRight );
+
+    return iRight;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+int RankTree::rotateRight( const int & iNode )
+{
+    const int iLeft = Nodes.at( iNode ).iLeft;
+
+    Nodes[ iNode ].iLeft = Nodes.at( iLeft ).iRight;
+    Nodes[ iLeft ].iRight = iNode;
+    update( iNode );
+    update( iLeft );
+
+    return iLeft;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+int RankTree::insertAt( const int & iNode, const int & iNew )
+{
+    int iChild = -1;
+
+    if ( 0 > iNode )
+    {
+        return iNew;
+    }
+
+    /* Insert as in any binary search tree, then rotate the new node up while its priority is the higher one. */
+    if ( precedes( Nodes.at( iNew ).dValue, Nodes.at( iNew ).sId, Nodes.at( iNode ) ) )
+    {
+        iChild = insertAt( Nodes.at( iNode ).iLeft, iNew );
+        Nodes[ iNode ].iLeft = iChild;
+        update( iNode );
+        if ( Nodes.at( iChild ).uiPriority > Nodes.at( iNode ).uiPriority )
+        {
+            return rotateRight( iNode );
+        }
+    }
+    else
+    {
+        iChild = insertAt( Nodes.at( iNode ).iRight, iNew );
+        Nodes[ iNode ].iRight = iChild;
+        update( iNode );
+        if ( Nodes.at( iChild ).uiPriority > Nodes.at( iNode ).uiPriority )
+        {
+            return rotateLeft( iNode );
+        }
+    }
+
+    return iNode;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+int RankTree::removeAt( const int & iNode, const double & dValue, const QString & sId, bool & bRemoved )
+{
+    int iMerged = -1;
+
+    if ( 0 > iNode )
+    {
+        return -1;
+    }
+
+    /* The removed node's children take its place, merged by priority. */
+    if ( ( dValue == Nodes.at( iNode ).dValue ) && ( sId == Nodes.at( iNode ).sId ) )
+    {
+        iMerged = merge( Nodes.at( iNode ).iLeft, Nodes.at( iNode ).iRight );
+        Nodes[ iNode ].sId.clear();
+        FreeNodes.append( iNode );
+        bRemoved = true;
+        return iMerged;
+    }
+
+    if ( precedes( dValue, sId, Nodes.at( iNode ) ) )
+    {
+        Nodes[ iNode ].iLeft = removeAt( Nodes.at( iNode ).iLeft, dValue, sId, bRemoved );
+    }
+    else
+    {
+        Nodes[ iNode ].iRight = removeAt( Nodes.at( iNode ).iRight, dValue, sId, bRemoved );
+    }
+    update( iNode );
+
+    return iNode;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+int RankTree::merge( const int & iLeft, const int & iRight )
+{
+    if ( 0 > iLeft )
+    {
+        return iRight;
+    }
+    if ( 0 > iRight )
+    {
+        return iLeft;
+    }
+
+    if ( Nodes.at( iLeft ).uiPriority > Nodes.at( iRight ).uiPriority )
+    {
+        Nodes[ iLeft ].iRight = merge( Nodes.at( iLeft ).iRight, iRight );
+        update( iLeft );
+        return iLeft;
+    }
+
+    Nodes[ iRight ].iLeft = merge( iLeft, Nodes.at( iRight ).iLeft );
+    update( iRight );
+
+    return iRight;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool RankTree::precedes( const double & dValue, const QString & sId, const Node & Other )
+{
+    /* Highest value first; equal values in id order so every entry has a single place. */
+    return ( dValue > Other.dValue ) || ( ( dValue == Other.dValue ) && ( sId < Other.sId ) );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,59 @@
+#ifndef RANKTREE_H
+#define RANKTREE_H
+
+#include <QString>
+#include <QVector>
+
+class RankedEntry
+{
+public:
+    QString sId;
+    double dValue = 0.0;
+};
+
+/* An order-statistic tree (a treap whose nodes know the size of their subtree) over entities ranked by value,
+ * highest first and ties broken by id. Insertion, removal, rank and lookup by rank take O(log n); the first N entries
+ * take O(log n + N). Nodes are kept in a vector and reused, so updates in steady state do not allocate. */
+class RankTree
+{
+public:
+    RankTree();
+
+    void insert( const double & dValue, const QString & sId );
+    bool remove( const double & dValue, const QString & sId );
+    void clear();
+
+    int size() const;
+    int rank( const double & dValue, const QString & sId ) const;
+    bool at( const int & iRank, RankedEntry & Entry ) const;
+    QVector<RankedEntry> first( const int & iCount ) const;
+
+private:
+    class Node
+    {
+    public:
+        double dValue = 0.0;
+        QString sId;
+        quint32 uiPriority = 0;
+        int iLeft = -1;
+        int iRight = -1;
+        int iSize = 1;
+    };
+
+    QVector<Node> Nodes;
+    QVector<int> FreeNodes;
+    int iRoot;
+    quint32 uiSeed;
+
+    int subtreeSize( const int & iNode ) const;
+    void update( const int & iNode );
+    int rotateLeft( const int & iNode );
+    int rotateRight( const int & iNode );
+    int insertAt( const int & iNode, const int & iNew );
+    int removeAt( const int & iNode, const double & dValue, const QString & sId, bool & bRemoved );
+    int merge( const int & iLeft, const int & iRight );
+
+    static bool precedes( const double & dValue, const QString & sId, const Node & Other );
+};
+
+#endif // RANKTREE_H
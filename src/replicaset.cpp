@@ -0,0 +1,231 @@
+#include <QDebug>
+
+#include "replicaset.h"
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+ReplicaSet::ReplicaSet()
+{
+    iPrimary = 0;
+    ulSelections = 0;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void ReplicaSet::setReplicas( const QStringList & Addresses, const int & iPrimary )
+{
+    Replica Entry;
+
+    Replicas.clear();
+    for ( const QString & sAddress : Addresses )
+    {
+        /* Parse each address once; every request only appends its path to it. */
+        Entry.BaseUrl = QUrl( sAddress );
+        Entry.sBasePath = Entry.BaseUrl.path( QUrl::FullyEncoded );
+        if ( !Entry.BaseUrl.isValid() )
+        {
+            qDebug() << "ReplicaSet::setReplicas: The server URL is invalid:" << sAddress;
+        }
+        Replicas.append( Entry );
+    }
+
+    this->iPrimary = ( ( 0 <= iPrimary ) && ( iPrimary < Replicas.size() ) ) ? iPrimary : 0;
+    ulSelections = 0;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+int ReplicaSet::count() const
+{
+    return Replicas.size();
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+int ReplicaSet::select( const bool & bRead, const int & iExclude )
+{
+    int iSelected = -1;
+
+    if ( Replicas.isEmpty() )
+    {
+        return -1;
+    }
+
+    ulSelections++;
+    if ( !bRead )
+    {
+        /* Writes stay on the primary unless it is out of rotation. */
+        iSelected = ( ( iExclude != iPrimary ) && ( isAvailable( Replicas[ iPrimary ] ) ) )
+                ? iPrimary
+                : fastest( iPrimary );
+    }
+    else if ( 0 == ( ulSelections % REPLICA_PROBE_INTERVAL ) )
+    {
+        /* Now and then refresh the latency of a replica that has not been used lately, so a slow replica that has
+         * recovered is noticed. */
+        for ( int i = 0; i < Replicas.size(); i++ )
+        {
+            if ( ( iExclude != i )
+                 && ( isAvailable( Replicas[ i ] ) )
+                 && ( ( 0 > iSelected ) || ( Replicas[ i ].ulLastUsed < Replicas[ iSelected ].ulLastUsed ) ) )
+            {
+                iSelected = i;
+            }
+        }
+    }
+    else
+    {
+        iSelected = fastest( iExclude );
+    }
+
+    /* With nothing available, keep using the primary; its replies decide when it is back. */
+    if ( 0 > iSelected )
+    {
+        if ( iExclude == iPrimary )
+        {
+            return -1;
+        }
+        iSelected = iPrimary;
+    }
+
+    Replicas[ iSelected ].ulLastUsed = ulSelections;
+    Replicas[ iSelected ].ulRequests++;
+
+    return iSelected;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool ReplicaSet::isAvailable( const int & iReplica )
+{
+    return ( 0 <= iReplica ) && ( iReplica < Replicas.size() ) && ( isAvailable( Replicas[ iReplica ] ) );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+QUrl ReplicaSet::url( const int & iReplica, const QString & sPath ) const
+{
+    QUrl Destination;
+
+    if ( ( 0 > iReplica ) || ( Replicas.size() <= iReplica ) )
+    {
+        return QUrl();
+    }
+
+    /* Only the path component is parsed; the scheme, host and port are reused as-is. */
+    Destination = Replicas.at( iReplica ).BaseUrl;
+    Destination.setPath( Replicas.at( iReplica ).sBasePath + sPath, QUrl::TolerantMode );
+
+    return Destination;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void ReplicaSet::recordSuccess( const int & iReplica, const qint64 & iLatencyNs )
+{
+    if ( ( 0 > iReplica ) || ( Replicas.size() <= iReplica ) )
+    {
+        return;
+    }
+
+    Replica & Entry = Replicas[ iReplica ];
+
+    /* The first sample seeds the rolling latency. */
+    Entry.dLatencyNs = ( 0.0 == Entry.dLatencyNs )
+            ? static_cast<double>( iLatencyNs )
+            : ( ( 1.0 - REPLICA_LATENCY_WEIGHT ) * Entry.dLatencyNs ) + ( REPLICA_LATENCY_WEIGHT * iLatencyNs );
+    Entry.dHealth = ( ( 1.0 - REPLICA_LATENCY_WEIGHT ) * Entry.dHealth ) + REPLICA_LATENCY_WEIGHT;
+    Entry.iConsecutiveFailures = 0;
+    Entry.bDown = false;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void ReplicaSet::recordFailure( const int & iReplica, const bool & bUnreachable )
+{
+    if ( ( 0 > iReplica ) || ( Replicas.size() <= iReplica ) )
+    {
+        return;
+    }
+
+    Replica & Entry = Replicas[ iReplica ];
+
+    Entry.ulFailures++;
+    Entry.iConsecutiveFailures++;
+    Entry.dHealth = ( 1.0 - REPLICA_LATENCY_WEIGHT ) * Entry.dHealth;
+
+    /* A replica that cannot be reached at all is taken out right away, one that answers with errors after a few. */
+    if ( ( bUnreachable ) || ( REPLICA_FAILURE_LIMIT <= Entry.iConsecutiveFailures ) )
+    {
+        if ( !Entry.bDown )
+        {
+            qDebug() << "ReplicaSet::recordFailure: Taking" << Entry.BaseUrl.toString() << "out of rotation.";
+        }
+        Entry.bDown = true;
+        Entry.DownTimer.start();
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void ReplicaSet::recordFailover( const int & iReplica )
+{
+    if ( ( 0 <= iReplica ) && ( iReplica < Replicas.size() ) )
+    {
+        Replicas[ iReplica ].ulFailovers++;
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+QVector<ReplicaStats> ReplicaSet::stats() const
+{
+    QVector<ReplicaStats> Stats;
+    ReplicaStats Entry;
+
+    for ( int i = 0; i < Replicas.size(); i++ )
+    {
+        Entry.sAddress = Replicas.at( i ).BaseUrl.toString();
+        Entry.bPrimary = ( iPrimary == i );
+        Entry.bHealthy = !Replicas.at( i ).bDown;
+        Entry.dLatencyMs = Replicas.at( i ).dLatencyNs / 1e6;
+        Entry.dHealth = Replicas.at( i ).dHealth;
+        Entry.ulRequests = Replicas.at( i ).ulRequests;
+        Entry.ulFailures = Replicas.at( i ).ulFailures;
+        Entry.ulFailovers = Replicas.at( i ).ulFailovers;
+        Stats.append( Entry );
+    }
+
+    return Stats;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool ReplicaSet::isAvailable( Replica & Candidate )
+{
+    /* Once the retry time has passed, a replica gets requests again until it fails once more. */
+    if ( ( Candidate.bDown ) && ( Candidate.DownTimer.hasExpired( REPLICA_RETRY_MS ) ) )
+    {
+        Candidate.bDown = false;
+        Candidate.iConsecutiveFailures = REPLICA_FAILURE_LIMIT - 1;
+    }
+
+    return !Candidate.bDown;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+int ReplicaSet::fastest( const int & iExclude )
+{
+    int iSelected = -1;
+    double dBest = 0.0;
+    double dScore = 0.0;
+
+    /* Replicas without a sample yet go first, so every replica gets measured. The score favours healthy replicas,
+     * so one that has started failing loses its place before it is taken out. */
+    for ( int i = 0; i < Replicas.size(); i++ )
+    {
+        if ( ( iExclude == i ) || ( !isAvailable( Replicas[ i ] ) ) )
+        {
+            continue;
+        }
+
+        dScore = Replicas.at( i ).dLatencyNs / qMax( 0.05, Replicas.at( i ).dHealth );
+        if ( ( 0 > iSelected ) || ( dScore < dBest ) )
+        {
+            iSelected = i;
+            dBest = dScore;
+        }
+    }
+
+    return iSelected;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,73 @@
+#ifndef REPLICASET_H
+#define REPLICASET_H
+
+#include <QElapsedTimer>
+#include <QString>
+#include <QStringList>
+#include <QUrl>
+#include <QVector>
+
+#define REPLICA_LATENCY_WEIGHT      0.2     // Weight of the newest sample in a replica's rolling latency
+#define REPLICA_FAILURE_LIMIT       3       // Consecutive failed replies before a replica is taken out of rotation
+#define REPLICA_RETRY_MS            5000    // Time a replica stays out of rotation before it is tried again
+#define REPLICA_PROBE_INTERVAL      50      // Every this many reads, one goes to the least recently used replica
+
+class ReplicaStats
+{
+public:
+    QString sAddress;
+    bool bPrimary = false;
+    bool bHealthy = true;
+    double dLatencyMs = 0.0;        // Rolling time to first byte; zero until the first reply
+    double dHealth = 1.0;           // Share of recent replies that succeeded
+    quint64 ulRequests = 0;
+    quint64 ulFailures = 0;
+    quint64 ulFailovers = 0;        // Requests sent elsewhere because this replica was out of rotation or failed
+};
+
+/* The backend replicas, with a rolling latency and health score each. Reads go to the fastest healthy replica and
+ * writes to the primary, or the fastest healthy replica while the primary is out of rotation. */
+class ReplicaSet
+{
+public:
+    ReplicaSet();
+
+    void setReplicas( const QStringList & Addresses, const int & iPrimary = 0 );
+
+    int count() const;
+    int select( const bool & bRead, const int & iExclude = -1 );
+    bool isAvailable( const int & iReplica );
+    QUrl url( const int & iReplica, const QString & sPath ) const;
+
+    void recordSuccess( const int & iReplica, const qint64 & iLatencyNs );
+    void recordFailure( const int & iReplica, const bool & bUnreachable );
+    void recordFailover( const int & iReplica );
+
+    QVector<ReplicaStats> stats() const;
+
+private:
+    class Replica
+    {
+    public:
+        QUrl BaseUrl;
+        QString sBasePath;
+        double dLatencyNs = 0.0;
+        double dHealth = 1.0;
+        int iConsecutiveFailures = 0;
+        bool bDown = false;
+        QElapsedTimer DownTimer;
+        quint64 ulLastUsed = 0;
+        quint64 ulRequests = 0;
+        quint64 ulFailures = 0;
+        quint64 ulFailovers = 0;
+    };
+
+    QVector<Replica> Replicas;
+    int iPrimary;
+    quint64 ulSelections;
+
+    bool isAvailable( Replica & Candidate );
+    int fastest( const int & iExclude );
+};
+
+#endif // REPLICASET_H
@@ -0,0 +1,448 @@
+#include <QDeadlineTimer>
+#include <QMutexLocker>
+#include <QThread>
+#include <cstring>
+
+#include "simulatedreader.h"
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+SimulatedReader::SimulatedReader()
+{
+    hNextCard = 1;
+    ulNextCard = 1;
+    iWaiting = 0;
+    ulCancels = 0;
+    iConnectUs = 0;
+    iTransmitUs = 0;
+    ulTransmits.store( 0, std::memory_order_relaxed );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void SimulatedReader::attachReader( const QString & sReader )
+{
+    QMutexLocker Lock( &Mutex );
+
+    if ( !Readers.contains( sReader ) )
+    {
+        Readers.insert( sReader, Reader() );
+        Changed.wakeAll();
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void SimulatedReader::detachReader( const QString & sReader )
+{
+    QMutexLocker Lock( &Mutex );
+
+    if ( 0 < Readers.remove( sReader ) )
+    {
+        Changed.wakeAll();
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void SimulatedReader::insertCard( const QString & sReader, const QByteArray & Uid )
+{
+    QMutexLocker Lock( &Mutex );
+    QMap<QString, Reader>::iterator Iterator = Readers.find( sReader );
+
+    if ( Readers.end() != Iterator )
+    {
+        Iterator->bPresent = true;
+        Iterator->Uid = Uid;
+        Iterator->ulCard = ulNextCard++;
+        Iterator->ulEvents++;
+        Changed.wakeAll();
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void SimulatedReader::removeCard( const QString & sReader )
+{
+    QMutexLocker Lock( &Mutex );
+    QMap<QString, Reader>::iterator Iterator = Readers.find( sReader );
+
+    if ( ( Readers.end() != Iterator ) && ( Iterator->bPresent ) )
+    {
+        Iterator->bPresent = false;
+        Iterator->Uid.clear();
+        Iterator->ulCard = 0;
+        Iterator->ulEvents++;
+        Changed.wakeAll();
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void SimulatedReader::play( const QList<SimulatedEvent> & Script )
+{
+    /* Runs on the calling thread until the script is done. */
+    for ( const SimulatedEvent & Event : Script )
+    {
+        if ( 0 < Event.iDelayUs )
+        {
+            QThread::usleep( static_cast<unsigned long>( Event.iDelayUs ) );
+        }
+
+        switch ( Event.eType )
+        {
+        case SimulatedEvent::Type::Attach:
+            attachReader( Event.sReader );
+            break;
+
+        case SimulatedEvent::Type::Detach:
+            detachReader( Event.sReader );
+            break;
+
+        case SimulatedEvent::Type::Insert:
+            insertCard( Event.sReader, Event.Uid );
+            break;
+
+        case SimulatedEvent::Type::Remove:
+            removeCard( Event.sReader );
+            break;
+        }
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void SimulatedReader::setResponse( const QByteArray & Command, const QByteArray & Response )
+{
+    QMutexLocker Lock( &Mutex );
+
+    /* The response includes its status word, i.e. "90 00". */
+    Responses.insert( Command, Response );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void SimulatedReader::writeCardMemory( const QByteArray & Uid, const int & iOffset, const QByteArray & Data )
+{
+    QMutexLocker Lock( &Mutex );
+    QByteArray & Memory = Memories[ Uid ];
+
+    /* Prepare what a card holds before it is first tapped, i.e. a player record. */
+    if ( Memory.isEmpty() )
+    {
+        Memory.fill( '\0', SIMULATED_CARD_BYTES );
+    }
+    if ( ( 0 <= iOffset ) && ( SIMULATED_CARD_BYTES >= iOffset + Data.size() ) )
+    {
+        Memory.replace( iOffset, Data.size(), Data );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void SimulatedReader::setLatency( const int & iConnectUs, const int & iTransmitUs )
+{
+    QMutexLocker Lock( &Mutex );
+
+    /* Time taken by every connect() and transmit(), standing in for the reader's RF and USB round trips. */
+    this->iConnectUs = qMax( 0, iConnectUs );
+    this->iTransmitUs = qMax( 0, iTransmitUs );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+quint64 SimulatedReader::transmitCount() const
+{
+    return ulTransmits.load( std::memory_order_relaxed );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+LONG SimulatedReader::establishContext( SCARDCONTEXT * phContext )
+{
+    *phContext = 1;
+
+    return SCARD_S_SUCCESS;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+LONG SimulatedReader::releaseContext( const SCARDCONTEXT & hContext )
+{
+    Q_UNUSED( hContext )
+
+    return SCARD_S_SUCCESS;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+LONG SimulatedReader::listReaders( const SCARDCONTEXT & hContext, char * pcReaders, DWORD * pulLength )
+{
+    QMutexLocker Lock( &Mutex );
+    QByteArray Names;
+
+    Q_UNUSED( hContext )
+
+    if ( Readers.isEmpty() )
+    {
+        return SCARD_E_NO_READERS_AVAILABLE;
+    }
+
+    /* Each name null-terminated, followed by an empty name. */
+    for ( QMap<QString, Reader>::const_iterator Iterator = Readers.begin(); Iterator != Readers.end(); ++Iterator )
+    {
+        Names.append( Iterator.key().toLocal8Bit() );
+        Names.append( '\0' );
+    }
+    Names.append( '\0' );
+
+    if ( nullptr == pcReaders )
+    {
+        *pulLength = static_cast<DWORD>( Names.size() );
+        return SCARD_S_SUCCESS;
+    }
+
+    if ( *pulLength < static_cast<DWORD>( Names.size() ) )
+    {
+        *pulLength = static_cast<DWORD>( Names.size() );
+        return SCARD_E_INSUFFICIENT_BUFFER;
+    }
+
+    memcpy( pcReaders, Names.constData(), static_cast<size_t>( Names.size() ) );
+    *pulLength = static_cast<DWORD>( Names.size() );
+
+    return SCARD_S_SUCCESS;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+LONG SimulatedReader::getStatusChange( const SCARDCONTEXT & hContext,
+                                       const DWORD & ulTimeoutMs,
+                                       SCARD_READERSTATE * pxStates,
+                                       const DWORD & ulCount )
+{
+    QMutexLocker Lock( &Mutex );
+    QDeadlineTimer Deadline( ( INFINITE == ulTimeoutMs ) ? QDeadlineTimer( QDeadlineTimer::Forever )
+                                                         : QDeadlineTimer( static_cast<qint64>( ulTimeoutMs ) ) );
+    const quint64 ulCancelsAtStart = ulCancels;
+    bool bChanged = false;
+    DWORD ulState = 0;
+    LONG lResult = SCARD_S_SUCCESS;
+
+    Q_UNUSED( hContext )
+
+    while ( true )
+    {
+        /* Report the state of every entry, flagging those that differ from what the caller knows. */
+        bChanged = false;
+        for ( DWORD i = 0; i < ulCount; i++ )
+        {
+            SCARD_READERSTATE & State = pxStates[ i ];
+
+            if ( 0 == strcmp( State.szReader, PNP_READER_NAME ) )
+            {
+                /* The plug-and-play entry only carries the number of readers. */
+                ulState = static_cast<DWORD>( Readers.size() ) << 16;
+                State.dwEventState = ulState;
+                if ( ( State.dwCurrentState >> 16 ) != ( ulState >> 16 ) )
+                {
+                    State.dwEventState |= SCARD_STATE_CHANGED;
+                    bChanged = true;
+                }
+                continue;
+            }
+
+            ulState = readerState( QString::fromLocal8Bit( State.szReader ) );
+            State.dwEventState = ulState;
+            if ( ( SCARD_STATE_UNAWARE == State.dwCurrentState )
+                 || ( ( State.dwCurrentState & ~static_cast<DWORD>( SCARD_STATE_CHANGED ) ) != ulState ) )
+            {
+                State.dwEventState |= SCARD_STATE_CHANGED;
+                bChanged = true;
+            }
+        }
+
+        if ( bChanged )
+        {
+            return SCARD_S_SUCCESS;
+        }
+
+        /* Like PC/SC, a cancel only ends a wait that is in progress; it is not remembered for the next call. */
+        iWaiting++;
+        lResult = Changed.wait( &Mutex, Deadline ) ? SCARD_S_SUCCESS : SCARD_E_TIMEOUT;
+        iWaiting--;
+
+        if ( ulCancelsAtStart != ulCancels )
+        {
+            return SCARD_E_CANCELLED;
+        }
+
+        if ( SCARD_E_TIMEOUT == lResult )
+        {
+            return lResult;
+        }
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+LONG SimulatedReader::cancel( const SCARDCONTEXT & hContext )
+{
+    QMutexLocker Lock( &Mutex );
+
+    Q_UNUSED( hContext )
+
+    if ( 0 < iWaiting )
+    {
+        ulCancels++;
+        Changed.wakeAll();
+    }
+
+    return SCARD_S_SUCCESS;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+LONG SimulatedReader::connect( const SCARDCONTEXT & hContext, const char * pcReader, SCARDHANDLE * phCard, DWORD * pulProtocol )
+{
+    QMutexLocker Lock( &Mutex );
+    QMap<QString, Reader>::const_iterator Iterator = Readers.constFind( QString::fromLocal8Bit( pcReader ) );
+    Connection Card;
+    int iDelayUs = iConnectUs;
+
+    Q_UNUSED( hContext )
+
+    if ( Readers.constEnd() == Iterator )
+    {
+        return SCARD_E_UNKNOWN_READER;
+    }
+
+    if ( !Iterator->bPresent )
+    {
+        return SCARD_E_NO_SMARTCARD;
+    }
+
+    Card.sReader = Iterator.key();
+    Card.ulCard = Iterator->ulCard;
+    *phCard = hNextCard++;
+    *pulProtocol = SCARD_PROTOCOL_T1;
+    Connections.insert( *phCard, Card );
+
+    /* Take the time outside the lock, so events can still be applied meanwhile. */
+    Lock.unlock();
+    if ( 0 < iDelayUs )
+    {
+        QThread::usleep( static_cast<unsigned long>( iDelayUs ) );
+    }
+
+    return SCARD_S_SUCCESS;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+LONG SimulatedReader::transmit( const SCARDHANDLE & hCard,
+                                const DWORD & ulProtocol,
+                                const unsigned char * pucCommand,
+                                const DWORD & ulCommandLength,
+                                unsigned char * pucResponse,
+                                DWORD * pulResponseLength )
+{
+    static const QByteArray GetUidCommand( "\xFF\xCA\x00\x00\x00", 5 );
+    QMutexLocker Lock( &Mutex );
+    const QByteArray Command( reinterpret_cast<const char *>( pucCommand ), static_cast<int>( ulCommandLength ) );
+    QHash<SCARDHANDLE, Connection>::const_iterator Connected = Connections.constFind( hCard );
+    QMap<QString, Reader>::const_iterator Iterator;
+    QByteArray Response;
+    int iDelayUs = iTransmitUs;
+
+    Q_UNUSED( ulProtocol )
+
+    if ( Connections.constEnd() == Connected )
+    {
+        return SCARD_E_INVALID_HANDLE;
+    }
+
+    /* The card may have been taken away, or replaced by another, since the connection was made. */
+    Iterator = Readers.constFind( Connected->sReader );
+    if ( ( Readers.constEnd() == Iterator ) || ( Iterator->ulCard != Connected->ulCard ) )
+    {
+        return SCARD_W_REMOVED_CARD;
+    }
+
+    if ( Responses.contains( Command ) )
+    {
+        Response = Responses.value( Command );
+    }
+    else if ( GetUidCommand == Command )
+    {
+        Response = Iterator->Uid;
+        Response.append( "\x90\x00", 2 );
+    }
+    else if ( ( 5 <= Command.size() ) && ( '\xFF' == Command.at( 0 ) ) && ( '\x00' == Command.at( 2 ) )
+              && ( ( '\xB0' == Command.at( 1 ) ) || ( '\xD6' == Command.at( 1 ) ) ) )
+    {
+        Response = accessMemory( Iterator->Uid, Command );
+    }
+    else
+    {
+        Response = QByteArray( "\x6A\x81", 2 );
+    }
+    Lock.unlock();
+
+    if ( 0 < iDelayUs )
+    {
+        QThread::usleep( static_cast<unsigned long>( iDelayUs ) );
+    }
+    ulTransmits.fetch_add( 1, std::memory_order_relaxed );
+
+    if ( *pulResponseLength < static_cast<DWORD>( Response.size() ) )
+    {
+        return SCARD_E_INSUFFICIENT_BUFFER;
+    }
+
+    memcpy( pucResponse, Response.constData(), static_cast<size_t>( Response.size() ) );
+    *pulResponseLength = static_cast<DWORD>( Response.size() );
+
+    return SCARD_S_SUCCESS;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+LONG SimulatedReader::disconnect( const SCARDHANDLE & hCard )
+{
+    QMutexLocker Lock( &Mutex );
+
+    return ( 0 < Connections.remove( hCard ) ) ? SCARD_S_SUCCESS : SCARD_E_INVALID_HANDLE;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+QByteArray SimulatedReader::accessMemory( const QByteArray & Uid, const QByteArray & Command )
+{
+    QByteArray & Memory = Memories[ Uid ];
+    const int iOffset = static_cast<unsigned char>( Command.at( 3 ) ) * 4;
+    const int iLength = static_cast<unsigned char>( Command.at( 4 ) );
+    QByteArray Response;
+
+    if ( Memory.isEmpty() )
+    {
+        Memory.fill( '\0', SIMULATED_CARD_BYTES );
+    }
+
+    if ( '\xB0' == Command.at( 1 ) )
+    {
+        /* Read binary: the requested number of bytes from the page on. */
+        if ( SIMULATED_CARD_BYTES < iOffset + iLength )
+        {
+            return QByteArray( "\x6A\x82", 2 );
+        }
+        Response = Memory.mid( iOffset, iLength );
+    }
+    else
+    {
+        /* Update binary: the data following the length, written from the page on. */
+        if ( ( Command.size() != 5 + iLength ) || ( SIMULATED_CARD_BYTES < iOffset + iLength ) )
+        {
+            return QByteArray( "\x6A\x82", 2 );
+        }
+        Memory.replace( iOffset, iLength, Command.mid( 5 ) );
+    }
+    Response.append( "\x90\x00", 2 );
+
+    return Response;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+DWORD SimulatedReader::readerState( const QString & sReader ) const
+{
+    QMap<QString, Reader>::const_iterator Iterator = Readers.constFind( sReader );
+
+    if ( Readers.constEnd() == Iterator )
+    {
+        return SCARD_STATE_UNKNOWN | SCARD_STATE_IGNORE;
+    }
+
+    return ( Iterator->bPresent ? SCARD_STATE_PRESENT : SCARD_STATE_EMPTY ) | ( Iterator->ulEvents << 16 );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
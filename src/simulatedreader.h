@@ -0,0 +1,106 @@
+#ifndef SIMULATEDREADER_H
+#define SIMULATEDREADER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+#include <QWaitCondition>
+#include <atomic>
+
+#include "pcscbackend.h"
+
+#define SIMULATED_CARD_BYTES    180     // Memory of an NTAG213, 45 pages of four bytes
+
+class SimulatedEvent
+{
+public:
+    enum class Type
+    {
+        Attach,     // Plug a reader in
+        Detach,     // Unplug a reader, taking any card with it
+        Insert,     // Place a card with the given UID on a reader
+        Remove      // Take the card off a reader
+    };
+
+    Type eType = Type::Insert;
+    QString sReader;
+    QByteArray Uid;
+    int iDelayUs = 0;       // Pause before the event, counted from the previous one
+};
+
+/* A PC/SC backend with scripted readers and cards instead of hardware. Events can be applied directly or played from
+ * a script with the given timing, from any thread. Reading the UID (FF CA 00 00 00) answers with the card's UID, and
+ * reading (FF B0) and updating (FF D6) pages work on memory kept per UID, so it persists across taps. Other commands
+ * answer with responses registered through setResponse() or "6A 81" (not supported). */
+class SimulatedReader : public PCSCBackend
+{
+public:
+    SimulatedReader();
+
+    void attachReader( const QString & sReader );
+    void detachReader( const QString & sReader );
+    void insertCard( const QString & sReader, const QByteArray & Uid );
+    void removeCard( const QString & sReader );
+    void play( const QList<SimulatedEvent> & Script );
+
+    void setResponse( const QByteArray & Command, const QByteArray & Response );
+    void writeCardMemory( const QByteArray & Uid, const int & iOffset, const QByteArray & Data );
+    void setLatency( const int & iConnectUs, const int & iTransmitUs );
+    quint64 transmitCount() const;
+
+    LONG establishContext( SCARDCONTEXT * phContext ) override;
+    LONG releaseContext( const SCARDCONTEXT & hContext ) override;
+    LONG listReaders( const SCARDCONTEXT & hContext, char * pcReaders, DWORD * pulLength ) override;
+    LONG getStatusChange( const SCARDCONTEXT & hContext,
+                          const DWORD & ulTimeoutMs,
+                          SCARD_READERSTATE * pxStates,
+                          const DWORD & ulCount ) override;
+    LONG cancel( const SCARDCONTEXT & hContext ) override;
+    LONG connect( const SCARDCONTEXT & hContext, const char * pcReader, SCARDHANDLE * phCard, DWORD * pulProtocol ) override;
+    LONG transmit( const SCARDHANDLE & hCard,
+                   const DWORD & ulProtocol,
+                   const unsigned char * pucCommand,
+                   const DWORD & ulCommandLength,
+                   unsigned char * pucResponse,
+                   DWORD * pulResponseLength ) override;
+    LONG disconnect( const SCARDHANDLE & hCard ) override;
+
+private:
+    class Reader
+    {
+    public:
+        bool bPresent = false;
+        QByteArray Uid;
+        DWORD ulEvents = 0;     // Reported in the high word of the state, as PC/SC does
+        quint64 ulCard = 0;     // Identifies the card currently present, so handles to a replaced card go stale
+    };
+
+    class Connection
+    {
+    public:
+        QString sReader;
+        quint64 ulCard = 0;
+    };
+
+    mutable QMutex Mutex;
+    QWaitCondition Changed;
+    QMap<QString, Reader> Readers;
+    QHash<SCARDHANDLE, Connection> Connections;
+    QHash<QByteArray, QByteArray> Responses;
+    QHash<QByteArray, QByteArray> Memories;     // Card UID to the card's memory
+    SCARDHANDLE hNextCard;
+    quint64 ulNextCard;
+    int iWaiting;                               // Calls blocked in getStatusChange()
+    quint64 ulCancels;                          // Bumped by cancel() while a call is blocked
+    int iConnectUs;
+    int iTransmitUs;
+    std::atomic<quint64> ulTransmits;
+
+    DWORD readerState( const QString & sReader ) const;
+    QByteArray accessMemory( const QByteArray & Uid, const QByteArray & Command );
+};
+
+#endif // SIMULATEDREADER_H
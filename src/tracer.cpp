@@ -0,0 +1,348 @@
+#include "tracer.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QMutex>
+#include <QSaveFile>
+#include <QThread>
+#include <QVector>
+#include <algorithm>
+#include <chrono>
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+class ThreadBuffer
+{
+public:
+    QVector<TraceEvent> Events;
+    std::atomic<int> iCount;
+    int iGeneration = 0;
+    int iThread = 0;
+    QString sThreadName;
+};
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+std::atomic<bool> Tracer::bEnabled( false );
+
+static QMutex RegistryMutex;
+static QList<ThreadBuffer *> Registry;          // Buffers are never freed, threads may still hold them
+static QString sTraceFile;
+static int iTraceCapacity = TRACE_EVENTS_PER_THREAD;
+static qint64 iTraceOriginNs = 0;
+static std::atomic<int> iTraceGeneration( 0 );
+static std::atomic<quint64> ulDroppedEvents( 0 );
+static std::atomic<quint64> ulNextCorrelation( 1 );
+
+static QMutex CorrelationMutex;
+static QHash<QString, quint64> BoundCorrelations;
+
+static thread_local ThreadBuffer *pThreadBuffer = nullptr;
+static thread_local quint64 ulThreadCorrelation = 0;
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static ThreadBuffer * threadBuffer()
+{
+    QMutexLocker Lock( &RegistryMutex );
+    QThread *pThread = QThread::currentThread();
+
+    if ( nullptr == pThreadBuffer )
+    {
+        pThreadBuffer = new ThreadBuffer();
+        pThreadBuffer->iCount.store( 0 );
+        pThreadBuffer->iThread = Registry.size() + 1;
+        if ( ( nullptr != QCoreApplication::instance() ) && ( QCoreApplication::instance()->thread() == pThread ) )
+        {
+            pThreadBuffer->sThreadName = "Main";
+        }
+        else if ( ( nullptr != pThread ) && ( !pThread->objectName().isEmpty() ) )
+        {
+            pThreadBuffer->sThreadName = pThread->objectName();
+        }
+        else
+        {
+            pThreadBuffer->sThreadName = QString( "Thread %1" ).arg( pThreadBuffer->iThread );
+        }
+        Registry.append( pThreadBuffer );
+    }
+
+    /* Only the owning thread resets its buffer, so a writer never races a reset. */
+    if ( iTraceGeneration.load( std::memory_order_acquire ) != pThreadBuffer->iGeneration )
+    {
+        pThreadBuffer->Events.resize( iTraceCapacity );
+        pThreadBuffer->iCount.store( 0, std::memory_order_release );
+        pThreadBuffer->iGeneration = iTraceGeneration.load( std::memory_order_acquire );
+    }
+
+    return pThreadBuffer;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static QString jsonString( const QString & sValue )
+{
+    QByteArray Quoted = QJsonDocument( QJsonArray { sValue } ).toJson( QJsonDocument::Compact );
+
+    /* Strip the surrounding brackets, keeping the quotes and escaping. */
+    return QString::fromUtf8( Quoted.mid( 1, Quoted.size() - 2 ) );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static QString microseconds( const qint64 & iNs )
+{
+    return QString::number( static_cast<double>( iNs ) / 1000.0, 'f', 3 );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool Tracer::start( const QString & sFile, const int & iEventsPerThread )
+{
+    QMutexLocker Lock( &RegistryMutex );
+
+    if ( ( isEnabled() ) || ( sFile.isEmpty() ) || ( 0 >= iEventsPerThread ) )
+    {
+        return false;
+    }
+
+    /* Each thread allocates its whole buffer on its first event, so recording itself never allocates. */
+    sTraceFile = sFile;
+    iTraceCapacity = iEventsPerThread;
+    iTraceOriginNs = now();
+    ulDroppedEvents.store( 0 );
+    iTraceGeneration.fetch_add( 1, std::memory_order_release );
+    bEnabled.store( true );
+
+    return true;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool Tracer::stop()
+{
+    class FlowStep
+    {
+    public:
+        const TraceEvent *pEvent;
+        int iThread;
+    };
+
+    QMutexLocker Lock( &RegistryMutex );
+    QSaveFile File;
+    QString sEvents;
+    QHash<quint64, QVector<FlowStep>> Flows;
+    quint64 ulAsyncId = 0;
+    const int iGeneration = iTraceGeneration.load( std::memory_order_acquire );
+
+    if ( !isEnabled() )
+    {
+        return false;
+    }
+
+    bEnabled.store( false );
+
+    /* Write the Chrome trace-event format, loadable in chrome://tracing or Perfetto. */
+    for ( const ThreadBuffer * pBuffer : Registry )
+    {
+        const int iCount = ( iGeneration == pBuffer->iGeneration ) ? pBuffer->iCount.load( std::memory_order_acquire ) : 0;
+
+        if ( 0 == iCount )
+        {
+            continue;
+        }
+
+        sEvents.append( QString( "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%1,\"args\":{\"name\":%2}},\n" )
+                        .arg( pBuffer->iThread )
+                        .arg( jsonString( pBuffer->sThreadName ) ) );
+
+        for ( int i = 0; i < iCount; i++ )
+        {
+            const TraceEvent & Event = pBuffer->Events[ i ];
+            const QString sCommon = QString( "\"name\":\"%1\",\"cat\":\"%2\",\"pid\":1,\"tid\":%3" )
+                                    .arg( Event.pcName, Event.pcCategory )
+                                    .arg( pBuffer->iThread );
+            const QString sArgs = QString( "\"args\":{\"correlation\":%1%2}" )
+                                  .arg( Event.ulCorrelation )
+                                  .arg( Event.sDetail.isEmpty() ? QString() : ",\"detail\":" + jsonString( Event.sDetail ) );
+
+            if ( Event.bAsync )
+            {
+                /* Async spans are matched by id rather than nesting, so concurrent requests do not overlap. Each gets
+                 * an id of its own, as the requests of one correlation (i.e. the pages of a collection) overlap too;
+                 * the correlation is still in the arguments. */
+                ulAsyncId++;
+                sEvents.append( QString( "{%1,\"ph\":\"b\",\"id\":%2,\"ts\":%3,%4},\n" )
+                                .arg( sCommon )
+                                .arg( ulAsyncId )
+                                .arg( microseconds( Event.iStartNs - iTraceOriginNs ) )
+                                .arg( sArgs ) );
+                sEvents.append( QString( "{%1,\"ph\":\"e\",\"id\":%2,\"ts\":%3},\n" )
+                                .arg( sCommon )
+                                .arg( ulAsyncId )
+                                .arg( microseconds( Event.iStartNs + Event.iDurationNs - iTraceOriginNs ) ) );
+            }
+            else
+            {
+                sEvents.append( QString( "{%1,\"ph\":\"X\",\"ts\":%2,\"dur\":%3,%4},\n" )
+                                .arg( sCommon )
+                                .arg( microseconds( Event.iStartNs - iTraceOriginNs ) )
+                                .arg( microseconds( Event.iDurationNs ) )
+                                .arg( sArgs ) );
+
+                if ( 0 != Event.ulCorrelation )
+                {
+                    Flows[ Event.ulCorrelation ].append( FlowStep { &Event, pBuffer->iThread } );
+                }
+            }
+        }
+    }
+
+    /* Draw arrows between the spans of each correlation, in the order they started. */
+    for ( QHash<quint64, QVector<FlowStep>>::iterator Iterator = Flows.begin(); Iterator != Flows.end(); ++Iterator )
+    {
+        QVector<FlowStep> & Steps = Iterator.value();
+
+        if ( 2 > Steps.size() )
+        {
+            continue;
+        }
+
+        std::sort( Steps.begin(), Steps.end(), []( const FlowStep & First, const FlowStep & Second )
+        {
+            return First.pEvent->iStartNs < Second.pEvent->iStartNs;
+        } );
+
+        for ( int i = 0; i < Steps.size(); i++ )
+        {
+            const char *pcPhase = ( 0 == i ) ? "s" : ( ( Steps.size() - 1 == i ) ? "f" : "t" );
+
+            sEvents.append( QString( "{\"name\":\"correlation\",\"cat\":\"flow\",\"ph\":\"%1\",\"bp\":\"e\",\"id\":%2,"
+                                     "\"pid\":1,\"tid\":%3,\"ts\":%4},\n" )
+                            .arg( pcPhase )
+                            .arg( Iterator.key() )
+                            .arg( Steps[ i ].iThread )
+                            .arg( microseconds( Steps[ i ].pEvent->iStartNs - iTraceOriginNs ) ) );
+        }
+    }
+
+    sEvents.chop( 2 );
+
+    File.setFileName( sTraceFile );
+    if ( ( !File.open( QIODevice::WriteOnly | QIODevice::Text ) )
+         || ( -1 == File.write( QString( "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":%1},\"traceEvents\":[\n%2\n]}\n" )
+                                .arg( ulDroppedEvents.load() )
+                                .arg( sEvents )
+                                .toUtf8() ) )
+         || ( !File.commit() ) )
+    {
+        qDebug() << "Tracer::stop failed to write" << sTraceFile;
+        return false;
+    }
+
+    return true;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+qint64 Tracer::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void Tracer::record( const char * pcName,
+                     const char * pcCategory,
+                     const qint64 & iStartNs,
+                     const qint64 & iEndNs,
+                     const quint64 & ulCorrelation,
+                     const QString & sDetail,
+                     const bool & bAsync )
+{
+    ThreadBuffer *pBuffer = pThreadBuffer;
+    int iIndex = 0;
+
+    if ( !isEnabled() )
+    {
+        return;
+    }
+
+    /* The registry lock is only taken for a thread's first event of each trace. */
+    if ( ( nullptr == pBuffer ) || ( iTraceGeneration.load( std::memory_order_acquire ) != pBuffer->iGeneration ) )
+    {
+        pBuffer = threadBuffer();
+    }
+
+    iIndex = pBuffer->iCount.load( std::memory_order_relaxed );
+    if ( pBuffer->Events.size() <= iIndex )
+    {
+        ulDroppedEvents.fetch_add( 1, std::memory_order_relaxed );
+        return;
+    }
+
+    TraceEvent & Event = pBuffer->Events[ iIndex ];
+    Event.pcName = pcName;
+    Event.pcCategory = pcCategory;
+    Event.iStartNs = iStartNs;
+    Event.iDurationNs = iEndNs - iStartNs;
+    Event.ulCorrelation = ulCorrelation;
+    Event.sDetail = sDetail;
+    Event.bAsync = bAsync;
+
+    /* Publish the event to the writer in stop(). */
+    pBuffer->iCount.store( iIndex + 1, std::memory_order_release );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+quint64 Tracer::newCorrelation()
+{
+    return ulNextCorrelation.fetch_add( 1, std::memory_order_relaxed );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+quint64 Tracer::continueCorrelation()
+{
+    /* Keep the correlation of whatever caused this work, or start a new one when tracing. */
+    if ( ( 0 == ulThreadCorrelation ) && ( isEnabled() ) )
+    {
+        return newCorrelation();
+    }
+
+    return ulThreadCorrelation;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+quint64 Tracer::currentCorrelation()
+{
+    return ulThreadCorrelation;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void Tracer::setCurrentCorrelation( const quint64 & ulCorrelation )
+{
+    ulThreadCorrelation = ulCorrelation;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void Tracer::bindCorrelation( const QString & sKey, const quint64 & ulCorrelation )
+{
+    /* Hands a correlation across a queued signal, keyed by a value both sides see (i.e. the card UID). */
+    if ( !isEnabled() )
+    {
+        return;
+    }
+
+    QMutexLocker Lock( &CorrelationMutex );
+
+    BoundCorrelations.insert( sKey, ulCorrelation );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+quint64 Tracer::takeCorrelation( const QString & sKey )
+{
+    if ( !isEnabled() )
+    {
+        return 0;
+    }
+
+    QMutexLocker Lock( &CorrelationMutex );
+
+    return BoundCorrelations.take( sKey );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
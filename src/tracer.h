@@ -0,0 +1,105 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QString>
+#include <atomic>
+
+#define TRACE_EVENTS_PER_THREAD     65536
+
+class TraceEvent
+{
+public:
+    const char *pcName = nullptr;       // String literals only, so recording never copies them
+    const char *pcCategory = nullptr;
+    qint64 iStartNs = 0;
+    qint64 iDurationNs = 0;
+    quint64 ulCorrelation = 0;          // Links every span caused by the same card tap or request
+    QString sDetail;                    // Optional, i.e. the tag handed to a subscriber
+    bool bAsync = false;                // Spans that overlap others on the same thread, i.e. HTTP round trips
+};
+
+class Tracer
+{
+public:
+    static bool start( const QString & sFile, const int & iEventsPerThread = TRACE_EVENTS_PER_THREAD );
+    static bool stop();
+
+    static inline bool isEnabled()
+    {
+        return bEnabled.load( std::memory_order_relaxed );
+    }
+
+    static qint64 now();
+    static void record( const char * pcName,
+                        const char * pcCategory,
+                        const qint64 & iStartNs,
+                        const qint64 & iEndNs,
+                        const quint64 & ulCorrelation,
+                        const QString & sDetail = QString(),
+                        const bool & bAsync = false );
+
+    static quint64 newCorrelation();
+    static quint64 continueCorrelation();
+    static quint64 currentCorrelation();
+    static void setCurrentCorrelation( const quint64 & ulCorrelation );
+    static void bindCorrelation( const QString & sKey, const quint64 & ulCorrelation );
+    static quint64 takeCorrelation( const QString & sKey );
+
+private:
+    static std::atomic<bool> bEnabled;
+};
+
+/* Records the enclosing scope as a span; does nothing beyond a single load when tracing is off. */
+class TraceSpan
+{
+public:
+    TraceSpan( const char * pcName, const char * pcCategory, const QString & sDetail = QString() )
+    {
+        if ( Tracer::isEnabled() )
+        {
+            this->pcName = pcName;
+            this->pcCategory = pcCategory;
+            this->sDetail = sDetail;
+            iStartNs = Tracer::now();
+        }
+    }
+
+    ~TraceSpan()
+    {
+        if ( nullptr != pcName )
+        {
+            Tracer::record( pcName, pcCategory, iStartNs, Tracer::now(), Tracer::currentCorrelation(), sDetail );
+        }
+    }
+
+private:
+    Q_DISABLE_COPY( TraceSpan )
+
+    const char *pcName = nullptr;
+    const char *pcCategory = nullptr;
+    QString sDetail;
+    qint64 iStartNs = 0;
+};
+
+/* Makes a correlation id current on this thread for the enclosing scope. */
+class CorrelationScope
+{
+public:
+    explicit CorrelationScope( const quint64 & ulCorrelation )
+    {
+        ulPrevious = Tracer::currentCorrelation();
+        Tracer::setCurrentCorrelation( ulCorrelation );
+    }
+
+    ~CorrelationScope()
+    {
+        Tracer::setCurrentCorrelation( ulPrevious );
+    }
+
+private:
+    Q_DISABLE_COPY( CorrelationScope )
+
+    quint64 ulPrevious;
+};
+
+#endif // TRACER_H
@@ -0,0 +1,947 @@
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QNetworkAccessManager>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QtTest>
+#include <algorithm>
+#include <limits>
+
+#include "bconnetwork.h"
+#include "cardrecord.h"
+#include "compression.h"
+#include "datastore.h"
+#include "endpoints.h"
+#include "mockbackend.h"
+#include "pushchannel.h"
+#include "ranktree.h"
+#include "replicaset.h"
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+class TagRecorder : public DataSubscriber
+{
+public:
+    QStringList Tags;
+
+    void handleData( const DataPoint & Data ) override
+    {
+        Tags.append( Data.sTag );
+    }
+};
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+class LibraryTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void streamDecoderRoundTrip();
+    void streamDecoderDeflate();
+    void streamDecoderTruncated();
+    void streamDecoderCorrupt();
+
+    void pagedCollection_data();
+    void pagedCollection();
+
+    void endpointWriterRoute();
+    void endpointWriterStrings();
+    void endpointSlots();
+
+    void pushChannelEvents();
+
+    void replicaSetSelection();
+    void replicaSetFailover();
+
+    void rankTreeOrder();
+    void rankTreeAgainstSort();
+
+    void indexRanking();
+    void indexBuiltFromModel();
+    void indexReorder();
+    void indexGroupMove();
+    void indexNonFiniteValues();
+
+    void evictLeastRecentlyUsed();
+    void expireTimeToLive();
+    void pruneCollection();
+    void frozenStore();
+
+    void cardRecordRoundTrip();
+    void cardRecordChecksum();
+    void cardRecordWritable();
+
+private:
+    static DataPoint point( const QString & sTag, const QVariant & Value );
+    static QStringList ids( const QVector<RankedEntry> & Entries );
+    static QByteArray payload();
+};
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+DataPoint LibraryTest::point( const QString & sTag, const QVariant & Value )
+{
+    return DataPoint( sTag, Value, QDateTime::currentDateTimeUtc() );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+QStringList LibraryTest::ids( const QVector<RankedEntry> & Entries )
+{
+    QStringList Ids;
+
+    for ( const RankedEntry & Entry : Entries )
+    {
+        Ids.append( Entry.sId );
+    }
+
+    return Ids;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+QByteArray LibraryTest::payload()
+{
+    QByteArray Data;
+
+    /* Several decode chunks' worth of a players reply. */
+    for ( int i = 0; i < 2000; i++ )
+    {
+        Data.append( QString( "{\"playerId\":\"p%1\",\"tickets\":%2}," ).arg( i ).arg( i * 7 % 1000 ).toUtf8() );
+    }
+
+    return Data;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void LibraryTest::streamDecoderRoundTrip()
+{
+    QByteArray Raw = payload();
+    QByteArray Compressed;
+    QByteArray Output;
+    QList<int> ChunkSizes = { 1, 7, 512, DECODE_CHUNK_BYTES + 1 };
+
+    QVERIFY( Raw.size() > 2 * DECODE_CHUNK_BYTES );
+    QVERIFY( StreamDecoder::gzipCompress( Raw, Compressed ) );
+    QVERIFY( Compressed.size() < Raw.size() );
+
+    /* The body arrives in whatever pieces the network hands over, down to single bytes. */
+    for ( int iChunk : ChunkSizes )
+    {
+        StreamDecoder Decoder;
+
+        Output.clear();
+        QVERIFY( !Decoder.isValid() );
+        for ( int i = 0; i < Compressed.size(); i += iChunk )
+        {
+            QVERIFY( Decoder.decode( Compressed.mid( i, iChunk ), Output ) );
+        }
+        QVERIFY2( Decoder.isValid(), qPrintable( QString( "chunk %1" ).arg( iChunk ) ) );
+        QCOMPARE( Output, Raw );
+    }
+
+    /* Trailing data after the end of the stream is ignored. */
+    {
+        StreamDecoder Decoder;
+
+        Output.clear();
+        QVERIFY( Decoder.decode( Compressed + QByteArray( "garbage" ), Output ) );
+        QVERIFY( Decoder.decode( QByteArray( "more garbage" ), Output ) );
+        QVERIFY( Decoder.isValid() );
+        QCOMPARE( Output, Raw );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void LibraryTest::streamDecoderDeflate()
+{
+    StreamDecoder Decoder;
+    QByteArray Raw = payload();
+    QByteArray Output;
+
+    /* HTTP "deflate" is a zlib stream, which is what qCompress() produces after its four byte length prefix. */
+    QVERIFY( Decoder.decode( qCompress( Raw ).mid( 4 ), Output ) );
+    QVERIFY( Decoder.isValid() );
+    QCOMPARE( Output, Raw );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void LibraryTest::streamDecoderTruncated()
+{
+    StreamDecoder Decoder;
+    QByteArray Raw = payload();
+    QByteArray Compressed;
+    QByteArray Output;
+
+    QVERIFY( StreamDecoder::gzipCompress( Raw, Compressed ) );
+
+    /* A body cut off by a dropped connection decodes without error so far, but never becomes valid. */
+    QVERIFY( Decoder.decode( Compressed.left( Compressed.size() / 2 ), Output ) );
+    QVERIFY( !Decoder.isValid() );
+    QVERIFY( Output.size() < Raw.size() );
+    QVERIFY( Decoder.decode( Compressed.mid( Compressed.size() / 2, Compressed.size() / 2 - 4 ), Output ) );
+    QVERIFY( !Decoder.isValid() );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void LibraryTest::streamDecoderCorrupt()
+{
+    QByteArray Raw = payload();
+    QByteArray Compressed;
+    QByteArray Corrupt;
+    QByteArray Output;
+
+    QVERIFY( StreamDecoder::gzipCompress( Raw, Compressed ) );
+
+    /* Neither a gzip nor a zlib header. */
+    {
+        StreamDecoder Decoder;
+
+        Corrupt = Compressed;
+        Corrupt[ 0 ] = '\0';
+        QVERIFY( !Decoder.decode( Corrupt, Output ) );
+        QVERIFY( !Decoder.isValid() );
+
+        /* Once failed, the decoder stays failed. */
+        QVERIFY( !Decoder.decode( Compressed, Output ) );
+        QVERIFY( !Decoder.isValid() );
+    }
+
+    /* A flipped bit in the gzip trailer's CRC, which inflates fine until the check at the end. */
+    {
+        StreamDecoder Decoder;
+
+        Corrupt = Compressed;
+        Corrupt[ Corrupt.size() - 8 ] = static_cast<char>( Corrupt.at( Corrupt.size() - 8 ) ^ 0x01 );
+        Output.clear();
+        QVERIFY( !Decoder.decode( Corrupt, Output ) );
+        QVERIFY( !Decoder.isValid() );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void LibraryTest::pagedCollection_data()
+{
+    QTest::addColumn<bool>( "bOffset" );
+    QTest::addColumn<bool>( "bLimit" );
+
+    QTest::newRow( "paged" ) << true << true;
+    QTest::newRow( "offset ignored" ) << false << true;
+    QTest::newRow( "limit ignored" ) << true << false;
+    QTest::newRow( "both ignored" ) << false << false;
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void LibraryTest::pagedCollection()
+{
+    QFETCH( bool, bOffset );
+    QFETCH( bool, bLimit );
+    MockBackend Backend;
+    TagRecorder Markers;
+    DataStore Store;
+    BCONNetwork Network( "http://127.0.0.1", false, false, false, &Store );
+    quint16 uiPort = 0;
+
+    Backend.setDatasetSize( 2, 25, 0 );
+    Backend.setPagingSupport( bOffset, bLimit );
+    uiPort = Backend.start( 0 );
+    QVERIFY( 0 != uiPort );
+
+    Network.setReplicas( QStringList { QString( "http://127.0.0.1:%1" ).arg( uiPort ) } );
+    Network.setListPaging( 10 );
+    Store.addSubscriber( "players.^", &Markers );
+    Store.addSubscriber( "players.length", &Markers );
+    Store.addSubscriber( "players.$", &Markers );
+    Network.getAllPlayers();
+
+    /* Opened once and closed once, after every element is in, however the server treats the paging parameters. A
+     * second fetch asked for while the first is under way joins it. */
+    Network.getAllPlayers();
+    QTRY_COMPARE( Markers.Tags.size(), 3 );
+    QTest::qWait( 200 );
+    QCOMPARE( Markers.Tags, QStringList( { "players.^", "players.length", "players.$" } ) );
+    QCOMPARE( Store.value( "players.length" ).Value.toInt(), 25 );
+    QCOMPARE( Store.value( "players.0.playerId" ).Value.toString(), MockBackend::playerId( 0 ) );
+    QCOMPARE( Store.value( "players.24.playerId" ).Value.toString(), MockBackend::playerId( 24 ) );
+    QVERIFY( !Store.value( "players.25.playerId" ).Value.isValid() );
+
+    /* Once closed, the collection can be fetched again. */
+    Network.getAllPlayers();
+    QTRY_COMPARE( Markers.Tags.size(), 6 );
+    QCOMPARE( Markers.Tags.mid( 3 ), QStringList( { "players.^", "players.length", "players.$" } ) );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void LibraryTest::endpointWriterRoute()
+{
+    EndpointWriter Stats( endpointSpec( Endpoint::PublishPlayerStats ), QByteArray() );
+    EndpointWriter Games( endpointSpec( Endpoint::GetAllGames ), QByteArray() );
+    EndpointWriter Delete( endpointSpec( Endpoint::DeletePrize ), QByteArray() );
+
+    /* Path arguments fill the placeholders as single escaped segments, the rest become the typed body fields. */
+    Stats.append( QString( "04 a/b?" ) );
+    Stats.append( QString( "g1" ) );
+    Stats.append( 12 );
+    Stats.append( std::numeric_limits<int>::min() );
+    QCOMPARE( Stats.takePath(), QString( "/players/04%20a%2Fb%3F/publishstats" ) );
+    QCOMPARE( Stats.takeBody(), QByteArray( "{\"gameId\":\"g1\",\"ticketsEarned\":12,\"highScore\":-2147483648}" ) );
+
+    /* No arguments, or only path ones, leave the body empty. */
+    QCOMPARE( Games.takePath(), QString( "/games" ) );
+    QVERIFY( Games.takeBody().isEmpty() );
+    Delete.append( QString( "7b01" ) );
+    QCOMPARE( Delete.takePath(), QString( "/prizes/7b01/delete" ) );
+    QVERIFY( Delete.takeBody().isEmpty() );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void LibraryTest::endpointWriterStrings()
+{
+    EndpointWriter Writer( endpointSpec( Endpoint::UpdatePlayerScreenName ), QByteArray() );
+    QString sValue( "q\"\\\n" );
+    QString sExpected;
+    QByteArray Body;
+
+    /* Quotes, backslashes and control characters are escaped, the rest is UTF-8 with surrogate pairs combined and
+     * unpaired surrogates replaced by U+FFFD. */
+    sValue.append( QChar( 0x0001 ) );
+    sValue.append( QChar( 0x00e9 ) );
+    sValue.append( QChar( 0x20ac ) );
+    sValue.append( QChar( 0xd83d ) );
+    sValue.append( QChar( 0xde00 ) );
+    sValue.append( QChar( 0xd83d ) );
+    sValue.append( QChar( 'x' ) );
+    sValue.append( QChar( 0xde00 ) );
+
+    Writer.append( QString( "04a1" ) );
+    Writer.append( sValue );
+    QCOMPARE( Writer.takePath(), QString( "/players/04a1/update" ) );
+    Body = Writer.takeBody();
+    QCOMPARE( Body, QByteArray( "{\"screenName\":\"q\\\"\\\\\\u000a\\u0001"
+                                "\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80\xef\xbf\xbd" "x" "\xef\xbf\xbd\"}" ) );
+
+    /* And reads back as the same text, bar the unpaired surrogates. */
+    sExpected = sValue;
+    sExpected[ 9 ] = QChar( 0xfffd );
+    sExpected[ 11 ] = QChar( 0xfffd );
+    QCOMPARE( QJsonDocument::fromJson( Body ).object().value( "screenName" ).toString(), sExpected );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void LibraryTest::endpointSlots()
+{
+    const QMetaObject & Meta = BCONNetwork::staticMetaObject;
+    QStringList Types;
+    QByteArray Signature;
+    int iIndex = -1;
+
+    /* moc does not expand ENDPOINT_LIST, so check every endpoint has a public slot that can be connected to by name,
+     * taking a string for each path argument and the declared type for each body field. */
+    for ( const EndpointSpec & Spec : EndpointTable )
+    {
+        Types.clear();
+        for ( int i = 0; i < endpointPathCount( Spec.eId ) + endpointFieldCount( Spec.eId ); i++ )
+        {
+            Types.append( ( FieldType::String == endpointArgumentType( Spec.eId, i ) ) ? "QString" : "int" );
+        }
+
+        Signature = QByteArray( Spec.pcName ) + "(" + Types.join( ',' ).toLatin1() + ")";
+        iIndex = Meta.indexOfSlot( Signature.constData() );
+        QVERIFY2( 0 <= iIndex, Signature.constData() );
+        QCOMPARE( Meta.method( iIndex ).access(), QMetaMethod::Public );
+    }
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void LibraryTest::pushChannelEvents()
+{
+    QList<QByteArray> Requests;
+    QTcpSocket *pSocket = nullptr;
+    QTcpServer Server;
+    QNetworkAccessManager Manager;
+    PushChannel Channel( &Manager );
+    QSignalSpy Connected( &Channel, SIGNAL( connected() ) );
+    QSignalSpy Disconnected( &Channel, SIGNAL( disconnected() ) );
+    QSignalSpy Events( &Channel, SIGNAL( eventReceived( const QString &, const QByteArray & ) ) );
+    QElapsedTimer Reconnect;
+
+    /* A bare server that records each request and lets the test write the stream by hand. */
+    QVERIFY( Server.listen( QHostAddress::LocalHost ) );
+    connect( &Server, &QTcpServer::newConnection, [ & ]()
+    {
+        QTcpSocket *pClient = Server.nextPendingConnection();
+
+        Requests.append( QByteArray() );
+        connect( pClient, &QTcpSocket::readyRead, [ &, pClient ]() { Requests.last().append( pClient->readAll() ); } );
+        pSocket = pClient;
+    } );
+
+    Channel.open( QUrl( QString( "http://127.0.0.1:%1/events" ).arg( Server.serverPort() ) ) );
+    QTRY_VERIFY( ( 1 == Requests.size() ) && ( Requests.first().contains( "\r\n\r\n" ) ) );
+    QVERIFY( Requests.first().contains( "Accept: text/event-stream" ) );
+
+    /* Comments, multi-line data, named events, CRLF line ends and a line split across reads. */
+    pSocket->write( "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nConnection: close\r\n\r\n"
+                    ": heartbeat\n"
+                    "retry: 1500\n"
+                    "id: 7\n"
+                    "event: players\n"
+                    "data: {\"a\":1}\n"
+                    "data: {\"b\":2}\n"
+                    "\n"
+                    "data:no space\r\n"
+                    "\r\n"
+                    "data: spl" );
+    QTRY_COMPARE( Events.count(), 2 );
+    QCOMPARE( Connected.count(), 1 );
+    QVERIFY( Channel.isConnected() );
+
+    /* A field without a colon has an empty value, an event without data is not dispatched and only the first space
+     * after the colon is dropped. */
+    pSocket->write( "it\n"
+                    "\n"
+                    "data\n"
+                    "\n"
+                    "event: ignored\n"
+                    "\n"
+                    "data:  two spaces\n"
+                    "unknown: x\n"
+                    "\n" );
+    QTRY_COMPARE( Events.count(), 5 );
+    QCOMPARE( Events.at( 0 ).at( 0 ).toString(), QString( "players" ) );
+    QCOMPARE( Events.at( 0 ).at( 1 ).toByteArray(), QByteArray( "{\"a\":1}\n{\"b\":2}" ) );
+    QCOMPARE( Events.at( 1 ).at( 0 ).toString(), QString( "message" ) );
+    QCOMPARE( Events.at( 1 ).at( 1 ).toByteArray(), QByteArray( "no space" ) );
+    QCOMPARE( Events.at( 2 ).at( 1 ).toByteArray(), QByteArray( "split" ) );
+    QCOMPARE( Events.at( 3 ).at( 1 ).toByteArray(), QByteArray( "" ) );
+    QCOMPARE( Events.at( 4 ).at( 0 ).toString(), QString( "message" ) );
+    QCOMPARE( Events.at( 4 ).at( 1 ).toByteArray(), QByteArray( " two spaces" ) );
+
+    /* A dropped stream reconnects after the server's retry delay, asking to resume from the last id. */
+    Reconnect.start();
+    pSocket->disconnectFromHost();
+    QTRY_COMPARE( Disconnected.count(), 1 );
+    QVERIFY( !Channel.isConnected() );
+    QTRY_VERIFY_WITH_TIMEOUT( ( 2 == Requests.size() ) && ( Requests.last().contains( "\r\n\r\n" ) ), 5000 );
+    QVERIFY( 1500 <= Reconnect.elapsed() );
+    QVERIFY( Requests.last().toLower().contains( "last-event-id: 7" ) );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void LibraryTest::replicaSetSelection()
+{
+    ReplicaSet Replicas;
+    QVector<ReplicaStats> Stats;
+    int iRead = 0;
+
+    Replicas.setReplicas( { "http://a.example:8080/api", "http://b.example", "http://c.example" }, 1 );
+    QCOMPARE( Replicas.count(), 3 );
+    QCOMPARE( Replicas.url( 0, "/games/1" ), QUrl( "http://a.example:8080/api/games/1" ) );
+    QVERIFY( !Replicas.url( 3, "/games/1" ).isValid() );
+
+    /* Replicas without a sample go first, then reads go to the fastest. */
+    QCOMPARE( Replicas.select( true ), 0 );
+    Replicas.recordSuccess( 0, 10000000 );
+    QCOMPARE( Replicas.select( true ), 1 );
+    Replicas.recordSuccess( 1, 5000000 );
+    QCOMPARE( Replicas.select( true ), 2 );
+    Replicas.recordSuccess( 2, 20000000 );
+    QCOMPARE( Replicas.select( true ), 1 );
+    QCOMPARE( Replicas.select( true, 1 ), 0 );
+
+    /* Writes go to the primary, even when it is not the fastest. */
+    Replicas.recordSuccess( 1, 50000000 );
+    QCOMPARE( Replicas.select( false ), 1 );
+    QCOMPARE( Replicas.select( true ), 0 );
+    QCOMPARE( Replicas.select( false, 1 ), 0 );
+
+    Stats = Replicas.stats();
+    QCOMPARE( Stats.size(), 3 );
+    QVERIFY( Stats.at( 1 ).bPrimary );
+    QVERIFY( !Stats.at( 0 ).bPrimary );
+    QCOMPARE( Stats.at( 2 ).dLatencyMs, 20.0 );
+    QCOMPARE( Stats.at( 1 ).dLatencyMs, 14.0 );
+    QCOMPARE( Stats.at( 0 ).ulRequests, quint64( 4 ) );
+
+    /* Every REPLICA_PROBE_INTERVAL selections, a read goes to the replica used least recently instead. */
+    Replicas.setReplicas( { "http://a.example", "http://b.example", "http://c.example" } );
+    for ( int i = 0; i < 3; i++ )
+    {
+        QCOMPARE( Replicas.select( true ), i );
+        Replicas.recordSuccess( i, ( 2 == i ) ? 1000000 : 10000000 );
+    }
+    for ( iRead = 3; iRead < REPLICA_PROBE_INTERVAL - 1; iRead++ )
+    {
+        QCOMPARE( Replicas.select( true ), 2 );
+    }
+    QCOMPARE( Replicas.select( true ), 0 );
+    QCOMPARE( Replicas.select( true ), 2 );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void LibraryTest::replicaSetFailover()
+{
+    ReplicaSet Replicas;
+    QVector<ReplicaStats> Stats;
+
+    Replicas.setReplicas( { "http://a.example", "http://b.example" } );
+    QCOMPARE( Replicas.select( true ), 0 );
+    Replicas.recordSuccess( 0, 1000000 );
+    QCOMPARE( Replicas.select( true ), 1 );
+    Replicas.recordSuccess( 1, 10000000 );
+
+    /* Error replies take a replica out of rotation after REPLICA_FAILURE_LIMIT in a row. */
+    for ( int i = 1; i < REPLICA_FAILURE_LIMIT; i++ )
+    {
+        Replicas.recordFailure( 0, false );
+        QVERIFY( Replicas.isAvailable( 0 ) );
+    }
+    Replicas.recordFailure( 0, false );
+    QVERIFY( !Replicas.isAvailable( 0 ) );
+    QCOMPARE( Replicas.select( true ), 1 );
+    QCOMPARE( Replicas.select( false ), 1 );
+    Replicas.recordFailover( 0 );
+
+    Stats = Replicas.stats();
+    QVERIFY( !Stats.at( 0 ).bHealthy );
+    QCOMPARE( Stats.at( 0 ).ulFailures, quint64( REPLICA_FAILURE_LIMIT ) );
+    QCOMPARE( Stats.at( 0 ).ulFailovers, quint64( 1 ) );
+    QVERIFY( Stats.at( 0 ).dHealth < Stats.at( 1 ).dHealth );
+
+    /* An unreachable replica is taken out at once. With nothing left, requests fall back to the primary, unless it is
+     * the one being failed over from. */
+    Replicas.recordFailure( 1, true );
+    QVERIFY( !Replicas.isAvailable( 1 ) );
+    QCOMPARE( Replicas.select( true ), 0 );
+    QCOMPARE( Replicas.select( false ), 0 );
+    QCOMPARE( Replicas.select( true, 0 ), -1 );
+
+    /* A reply brings a replica back right away, the retry time otherwise; after that one failure is enough. */
+    Replicas.recordSuccess( 1, 10000000 );
+    QVERIFY( Replicas.isAvailable( 1 ) );
+    QCOMPARE( Replicas.select( true, 0 ), 1 );
+
+    QTest::qWait( REPLICA_RETRY_MS + 100 );
+    QVERIFY( Replicas.isAvailable( 0 ) );
+    QCOMPARE( Replicas.select( false ), 0 );
+    Replicas.recordFailure( 0, false );
+    QVERIFY( !Replicas.isAvailable( 0 ) );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void LibraryTest::rankTreeOrder()
+{
+    RankTree Tree;
+    RankedEntry Entry;
+
+    /* Highest value first, ties in id order. */
+    Tree.insert( 5.0, "c" );
+    Tree.insert( 9.0, "a" );
+    Tree.insert( 5.0, "b" );
+    Tree.insert( 1.0, "d" );
+
+    QCOMPARE( Tree.size(), 4 );
+    QCOMPARE( Tree.rank( 9.0, "a" ), 0 );
+    QCOMPARE( Tree.rank( 5.0, "b" ), 1 );
+    QCOMPARE( Tree.rank( 5.0, "c" ), 2 );
+    QCOMPARE( Tree.rank( 1.0, "d" ), 3 );
+    QCOMPARE( Tree.rank( 5.0, "x" ), -1 );
+
+    QVERIFY( Tree.at( 2, Entry ) );
+    QCOMPARE( Entry.sId, QString( "c" ) );
+    QCOMPARE( Entry.dValue, 5.0 );
+    QVERIFY( !Tree.at( 4, Entry ) );
+
+    QCOMPARE( ids( Tree.first( 2 ) ), QStringList( { "a", "b" } ) );
+    QCOMPARE( ids( Tree.first( 10 ) ), QStringList( { "a", "b", "c", "d" } ) );
+
+    /* Removal needs the value the entry was ranked at. */
+    QVERIFY( !Tree.remove( 6.0, "c" ) );
+    QVERIFY( Tree.remove( 5.0, "b" ) );
+    QVERIFY( !Tree.remove( 5.0, "b" ) );
+    QCOMPARE( Tree.size(), 3 );
+    QCOMPARE( Tree.rank( 5.0, "c" ), 1 );
+    QCOMPARE( ids( Tree.first( 10 ) ), QStringList( { "a", "c", "d" } ) );
+
+    Tree.clear();
+    QCOMPARE( Tree.size(), 0 );
+    QVERIFY( Tree.first( 3 ).isEmpty() );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void LibraryTest::rankTreeAgainstSort()
+{
+    RankTree Tree;
+    QHash<QString, double> Values;
+    QVector<RankedEntry> Expected;
+    QVector<RankedEntry> Top;
+    RankedEntry Entry;
+    quint32 uiState = 12345;
+    QString sId;
+
+    /* Random updates with plenty of ties, checked against a plain sort. */
+    for ( int i = 0; i < 5000; i++ )
+    {
+        uiState = uiState * 1103515245u + 12345u;
+        sId = QString( "p%1" ).arg( ( uiState >> 8 ) % 300 );
+        if ( Values.contains( sId ) )
+        {
+            QVERIFY( Tree.remove( Values.value( sId ), sId ) );
+            Values.remove( sId );
+        }
+        if ( 0 != ( uiState >> 20 ) % 4 )
+        {
+            Values.insert( sId, static_cast<double>( ( uiState >> 12 ) % 50 ) );
+            Tree.insert( Values.value( sId ), sId );
+        }
+    }
+
+    for ( QHash<QString, double>::const_iterator Iterator = Values.constBegin();
+          Iterator != Values.constEnd();
+          ++Iterator )
+    {
+        Entry.sId = Iterator.key();
+        Entry.dValue = Iterator.value();
+        Expected.append( Entry );
+    }
+    std::sort( Expected.begin(), Expected.end(), []( const RankedEntry & First, const RankedEntry & Second )
+    {
+        return ( First.dValue > Second.dValue ) || ( ( First.dValue == Second.dValue ) && ( First.sId < Second.sId ) );
+    } );
+
+    QCOMPARE( Tree.size(), Expected.size() );
+    for ( int i = 0; i < Expected.size(); i++ )
+    {
+        QCOMPARE( Tree.rank( Expected.at( i ).dValue, Expected.at( i ).sId ), i );
+        QVERIFY( Tree.at( i, Entry ) );
+        QCOMPARE( Entry.sId, Expected.at( i ).sId );
+    }
+
+    Top = Tree.first( 20 );
+    QCOMPARE( ids( Top ), ids( Expected.mid( 0, 20 ) ) );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void LibraryTest::indexRanking()
+{
+    DataStore Store;
+
+    Store.addIndex( "tickets", { "players.*", "player" }, "playerId", "tickets" );
+    Store.insertBatch( { point( "players.length", 3 ),
+                         point( "players.0.playerId", "a" ),
+                         point( "players.0.tickets", 5 ),
+                         point( "players.1.playerId", "b" ),
+                         point( "players.1.tickets", 7 ),
+                         point( "players.2.playerId", "c" ),
+                         point( "players.2.tickets", 5 ) } );
+
+    QCOMPARE( Store.getIndexSize( "tickets" ), 3 );
+    QCOMPARE( ids( Store.getTop( "tickets", 10 ) ), QStringList( { "b", "a", "c" } ) );
+    QCOMPARE( Store.getRank( "tickets", "c" ), 2 );
+    QCOMPARE( Store.getRank( "tickets", "x" ), -1 );
+    QCOMPARE( Store.getRank( "missing", "a" ), -1 );
+
+    /* The single player root holds an entity already ranked, so it moves it rather than adding another. */
+    Store.insertBatch( { point( "player.playerId", "c" ), point( "player.tickets", 8 ) } );
+    QCOMPARE( Store.getIndexSize( "tickets" ), 3 );
+    QCOMPARE( Store.getRank( "tickets", "c" ), 0 );
+
+    /* Separate inserts, id first, as from the application. */
+    Store.insert( point( "player.playerId", "b" ) );
+    Store.insert( point( "player.tickets", 1 ) );
+    QCOMPARE( ids( Store.getTop( "tickets", 10 ) ), QStringList( { "c", "a", "b" } ) );
+
+    /* Shrinking the collection removes the entities only it held: c goes, b stays as the single player. */
+    Store.insert( point( "players.length", 1 ) );
+    QCOMPARE( ids( Store.getTop( "tickets", 10 ) ), QStringList( { "a", "b" } ) );
+    QCOMPARE( Store.getRank( "tickets", "c" ), -1 );
+    QCOMPARE( Store.getIndexSize( "tickets" ), 2 );
+
+    Store.removeIndex( "tickets" );
+    QCOMPARE( Store.getIndexSize( "tickets" ), 0 );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void LibraryTest::indexBuiltFromModel()
+{
+    DataStore Store;
+
+    /* Values ahead of their id, in one batch or in separate inserts, are ranked once the id is known. */
+    Store.insertBatch( { point( "players.0.highScore", 20 ), point( "players.0.playerId", "a" ) } );
+    Store.insert( point( "players.1.highScore", 30 ) );
+    Store.insert( point( "players.1.playerId", "b" ) );
+
+    Store.addIndex( "highScore", { "players.*" }, "playerId", "highScore" );
+    QCOMPARE( ids( Store.getTop( "highScore", 10 ) ), QStringList( { "b", "a" } ) );
+
+    Store.insert( point( "players.2.highScore", 25 ) );
+    QCOMPARE( Store.getIndexSize( "highScore" ), 2 );
+    Store.insert( point( "players.2.playerId", "c" ) );
+    QCOMPARE( ids( Store.getTop( "highScore", 10 ) ), QStringList( { "b", "c", "a" } ) );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void LibraryTest::indexReorder()
+{
+    DataStore Store;
+    QVector<RankedEntry> Top;
+
+    /* highScore sorts ahead of playerId, so a flattened reply publishes each value before the id it belongs to. */
+    Store.addIndex( "highScore", { "players.*" }, "playerId", "highScore" );
+    Store.insertBatch( { point( "players.0.highScore", 20 ),
+                         point( "players.0.playerId", "a" ),
+                         point( "players.1.highScore", 10 ),
+                         point( "players.1.playerId", "b" ) } );
+    QCOMPARE( ids( Store.getTop( "highScore", 10 ) ), QStringList( { "a", "b" } ) );
+
+    /* The same players in the other order, with a new score for a. */
+    Store.insertBatch( { point( "players.0.highScore", 10 ),
+                         point( "players.0.playerId", "b" ),
+                         point( "players.1.highScore", 25 ),
+                         point( "players.1.playerId", "a" ) } );
+    Top = Store.getTop( "highScore", 10 );
+    QCOMPARE( ids( Top ), QStringList( { "a", "b" } ) );
+    QCOMPARE( Top.at( 0 ).dValue, 25.0 );
+    QCOMPARE( Top.at( 1 ).dValue, 10.0 );
+
+    /* Another player takes a's place: a leaves the ranking and the newcomer does not inherit its score. */
+    Store.insertBatch( { point( "players.1.playerId", "c" ) } );
+    QCOMPARE( Store.getRank( "highScore", "a" ), -1 );
+    QCOMPARE( Store.getRank( "highScore", "c" ), -1 );
+    QCOMPARE( Store.getIndexSize( "highScore" ), 1 );
+
+    Store.insertBatch( { point( "players.1.highScore", 3 ) } );
+    QCOMPARE( ids( Store.getTop( "highScore", 10 ) ), QStringList( { "b", "c" } ) );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void LibraryTest::indexGroupMove()
+{
+    DataStore Store;
+    QVector<RankedEntry> Top;
+
+    Store.addIndex( "highScore", { "players.*" }, "playerId", "stats.*.highScore", "stats.*.gameId" );
+    Store.insertBatch( { point( "players.0.playerId", "a" ),
+                         point( "players.0.stats.0.gameId", "g1" ),
+                         point( "players.0.stats.0.highScore", 100 ),
+                         point( "players.0.stats.1.gameId", "g2" ),
+                         point( "players.0.stats.1.highScore", 50 ),
+                         point( "players.1.playerId", "b" ),
+                         point( "players.1.stats.0.gameId", "g1" ),
+                         point( "players.1.stats.0.highScore", 200 ) } );
+
+    QCOMPARE( ids( Store.getTop( "highScore", 10, "g1" ) ), QStringList( { "b", "a" } ) );
+    QCOMPARE( Store.getRank( "highScore", "a", "g2" ), 0 );
+    QCOMPARE( Store.getIndexSize( "highScore" ), 0 );
+
+    /* Moving a value to another game takes it out of the first game's ranking. */
+    Store.insert( point( "players.0.stats.0.gameId", "g3" ) );
+    QCOMPARE( ids( Store.getTop( "highScore", 10, "g1" ) ), QStringList( { "b" } ) );
+    Top = Store.getTop( "highScore", 10, "g3" );
+    QCOMPARE( ids( Top ), QStringList( { "a" } ) );
+    QCOMPARE( Top.at( 0 ).dValue, 100.0 );
+    QCOMPARE( Store.getRank( "highScore", "a", "g2" ), 0 );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void LibraryTest::indexNonFiniteValues()
+{
+    DataStore Store;
+    QVector<RankedEntry> Top;
+
+    Store.addIndex( "tickets", { "players.*" }, "playerId", "tickets" );
+    Store.insertBatch( { point( "players.0.playerId", "a" ), point( "players.0.tickets", 5 ) } );
+
+    /* NaN does not compare, so it would break the ordering; the last finite value stands. */
+    Store.insert( point( "players.0.tickets", qQNaN() ) );
+    Store.insert( point( "players.0.tickets", qInf() ) );
+    Top = Store.getTop( "tickets", 10 );
+    QCOMPARE( Top.size(), 1 );
+    QCOMPARE( Top.at( 0 ).dValue, 5.0 );
+
+    Store.insertBatch( { point( "players.1.playerId", "b" ), point( "players.1.tickets", qQNaN() ) } );
+    QCOMPARE( Store.getRank( "tickets", "b" ), -1 );
+    QCOMPARE( Store.getIndexSize( "tickets" ), 1 );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void LibraryTest::evictLeastRecentlyUsed()
+{
+    DataStore Store;
+
+    Store.setCapacity( 3 );
+    Store.insert( point( "a", 1 ) );
+    Store.insert( point( "b", 2 ) );
+    Store.insert( point( "c", 3 ) );
+
+    /* Reading a counts as use, which leaves b as the least recently used. */
+    QVERIFY( Store.value( "a" ).Value.isValid() );
+    Store.insert( point( "d", 4 ) );
+
+    QVERIFY( Store.value( "a" ).Value.isValid() );
+    QVERIFY( !Store.value( "b" ).Value.isValid() );
+    QVERIFY( Store.value( "c" ).Value.isValid() );
+    QVERIFY( Store.value( "d" ).Value.isValid() );
+    QCOMPARE( Store.getModelStats().ulEntries, Q_UINT64_C( 3 ) );
+    QCOMPARE( Store.getModelStats().ulEvicted, Q_UINT64_C( 1 ) );
+
+    /* Lowering the capacity evicts right away. */
+    Store.setCapacity( 1 );
+    QCOMPARE( Store.getModelStats().ulEntries, Q_UINT64_C( 1 ) );
+    QVERIFY( Store.value( "d" ).Value.isValid() );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void LibraryTest::expireTimeToLive()
+{
+    DataStore Store;
+
+    Store.setTimeToLive( "session.", 50 );
+    Store.insert( point( "session.token", "secret" ) );
+    Store.insert( point( "config.name", "cabinet" ) );
+
+    /* Expired tags read as absent at once and are dropped by the next sweep. */
+    QTest::qWait( 100 );
+    QVERIFY( !Store.value( "session.token" ).Value.isValid() );
+    QVERIFY( Store.value( "config.name" ).Value.isValid() );
+    QTRY_COMPARE_WITH_TIMEOUT( Store.getModelStats().ulExpired, Q_UINT64_C( 1 ), 3 * DATASTORE_SWEEP_MS );
+    QCOMPARE( Store.getModelStats().ulEntries, Q_UINT64_C( 1 ) );
+
+    /* An update starts the time to live afresh. */
+    Store.insert( point( "session.token", "secret" ) );
+    QVERIFY( Store.value( "session.token" ).Value.isValid() );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void LibraryTest::pruneCollection()
+{
+    DataStore Store;
+
+    Store.insertBatch( { point( "players.length", 3 ),
+                         point( "players.0.playerId", "a" ),
+                         point( "players.1.playerId", "b" ),
+                         point( "players.2.playerId", "c" ),
+                         point( "players.2.tickets", 5 ) } );
+
+    /* The former tail goes when the collection gets shorter. */
+    Store.insert( point( "players.length", 1 ) );
+    QVERIFY( Store.value( "players.0.playerId" ).Value.isValid() );
+    QVERIFY( !Store.value( "players.1.playerId" ).Value.isValid() );
+    QVERIFY( !Store.value( "players.2.tickets" ).Value.isValid() );
+    QVERIFY( Store.value( "players.length" ).Value.isValid() );
+    QCOMPARE( Store.getModelStats().ulPruned, Q_UINT64_C( 3 ) );
+
+    Store.truncate( "players", 0 );
+    QVERIFY( !Store.value( "players.0.playerId" ).Value.isValid() );
+    QCOMPARE( Store.getModelStats().ulPruned, Q_UINT64_C( 4 ) );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void LibraryTest::frozenStore()
+{
+    DataStore Store;
+
+    Store.insert( point( "config.name", "cabinet" ) );
+    Store.freeze();
+    QVERIFY( Store.isFrozen() );
+
+    /* Nothing changes a frozen store, so it may be read from any thread. */
+    Store.insert( point( "config.name", "other" ) );
+    Store.setCapacity( 1 );
+    Store.setTimeToLive( "config.", 1 );
+    Store.truncate( "config", 0 );
+    QTest::qWait( 10 );
+    QCOMPARE( Store.value( "config.name" ).Value.toString(), QString( "cabinet" ) );
+    QCOMPARE( Store.getModelStats().ulEntries, Q_UINT64_C( 1 ) );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void LibraryTest::cardRecordRoundTrip()
+{
+    QVariantMap Record;
+    QVariantMap Decoded;
+    QByteArray Data;
+
+    Record.insert( "screenName", "Player One" );
+    Record.insert( "tokens", 120 );
+    Record.insert( "tickets", 4500 );
+    Data = CardRecord::encode( Record );
+
+    QCOMPARE( Data.size() % CARD_RECORD_PAGE_BYTES, 0 );
+    QVERIFY( CARD_RECORD_MAX_BYTES >= Data.size() );
+    QVERIFY( Data.size() >= CardRecord::encodedLength( Data ) );
+    QVERIFY( CardRecord::decode( Data, Decoded ) );
+    QCOMPARE( Decoded.value( "screenName" ).toString(), QString( "Player One" ) );
+    QCOMPARE( Decoded.value( "tokens" ).toInt(), 120 );
+    QCOMPARE( Decoded.value( "tickets" ).toInt(), 4500 );
+    QVERIFY( Decoded.value( "written" ).toDateTime().isValid() );
+
+    /* Long names are cut to fit, on a character boundary. */
+    Record.insert( "screenName", QString( 40, QChar( 0x00e9 ) ) );
+    QVERIFY( CardRecord::decode( CardRecord::encode( Record ), Decoded ) );
+    QCOMPARE( Decoded.value( "screenName" ).toString(), QString( CARD_RECORD_MAX_NAME_BYTES / 2, QChar( 0x00e9 ) ) );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void LibraryTest::cardRecordChecksum()
+{
+    QVariantMap Record;
+    QVariantMap Decoded;
+    QByteArray Data;
+    QByteArray Corrupt;
+    int iLength = 0;
+
+    Record.insert( "screenName", "Player One" );
+    Record.insert( "tokens", 120 );
+    Record.insert( "tickets", 4500 );
+    Data = CardRecord::encode( Record );
+    iLength = CardRecord::encodedLength( Data );
+
+    /* A single flipped bit in the payload or the checksum is caught. */
+    for ( int i = CARD_RECORD_PAGE_BYTES; i < iLength; i++ )
+    {
+        Corrupt = Data;
+        Corrupt[ i ] = static_cast<char>( Corrupt.at( i ) ^ 0x01 );
+        QVERIFY2( !CardRecord::decode( Corrupt, Decoded ), qPrintable( QString( "byte %1" ).arg( i ) ) );
+    }
+
+    /* As is a record cut short by the card leaving the reader. */
+    QVERIFY( !CardRecord::decode( Data.left( Data.size() - CARD_RECORD_PAGE_BYTES ), Decoded ) );
+
+    /* Anything else on the card is not a record. */
+    QCOMPARE( CardRecord::encodedLength( QByteArray( "\x03\x00\xFE\x00", 4 ) ), -1 );
+    QCOMPARE( CardRecord::encodedLength( QByteArray( CARD_RECORD_READ_BYTES, '\0' ) ), -1 );
+    QVERIFY( !CardRecord::decode( QByteArray( CARD_RECORD_READ_BYTES, '\0' ), Decoded ) );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void LibraryTest::cardRecordWritable()
+{
+    QVariantMap Record;
+    QByteArray Existing( CARD_RECORD_MAX_BYTES, '\0' );
+
+    /* Blank memory, the empty NDEF message of a factory-fresh card and an earlier record may be written over; an NDEF
+     * message with content may not. */
+    Record.insert( "screenName", "Player One" );
+    QVERIFY( CardRecord::isWritable( Existing ) );
+    QVERIFY( CardRecord::isWritable( CardRecord::encode( Record ) ) );
+
+    Existing[ 0 ] = '\x03';
+    Existing[ 2 ] = '\xFE';
+    QVERIFY( CardRecord::isWritable( Existing ) );
+
+    Existing[ 1 ] = '\x0A';
+    Existing[ 2 ] = '\xD1';
+    QVERIFY( !CardRecord::isWritable( Existing ) );
+
+    /* Anything after the terminator, or anywhere in blank memory, is kept. */
+    Existing[ 1 ] = '\0';
+    Existing[ 2 ] = '\xFE';
+    Existing[ 3 ] = '\x01';
+    QVERIFY( !CardRecord::isWritable( Existing ) );
+
+    Existing.fill( '\0' );
+    Existing[ Existing.size() - 1 ] = '\x01';
+    QVERIFY( !CardRecord::isWritable( Existing ) );
+}
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+QTEST_GUILESS_MAIN( LibraryTest )
+
+#include "librarytest.moc"
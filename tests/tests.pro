@@ -0,0 +1,18 @@
+# Unit tests for the library. Build and run with "qmake tests.pro && make && ./librarytest" from this directory.
+
+QT -= gui
+QT += network testlib
+
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+TARGET = librarytest
+TEMPLATE = app
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+SOURCES += \
+    librarytest.cpp
+
+include( ../libBCONNetwork.pri )
+include( ../bench/common/mockbackend.pri )